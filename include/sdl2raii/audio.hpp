@@ -0,0 +1,274 @@
+#ifndef SDLRAII_AUDIO_INCLUDE_GUARD
+#define SDLRAII_AUDIO_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+#define SDLRAII_THE_PREFIX SDL
+#include "wrapgen_macros.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+namespace sdl {
+
+// https://wiki.libsdl.org/CategoryAudio
+SDLRAII_WRAP_TYPE(AudioSpec);
+SDLRAII_WRAP_TYPE(AudioCVT);
+SDLRAII_WRAP_TYPE(AudioFormat);
+SDLRAII_WRAP_TYPE(AudioDeviceID);
+
+namespace audio {
+enum allow : int {
+  allow_frequency_change = SDL_AUDIO_ALLOW_FREQUENCY_CHANGE,
+  allow_format_change    = SDL_AUDIO_ALLOW_FORMAT_CHANGE,
+  allow_channels_change  = SDL_AUDIO_ALLOW_CHANNELS_CHANGE,
+  allow_any_change       = SDL_AUDIO_ALLOW_ANY_CHANGE
+};
+} // namespace audio
+
+/**
+ * Sample data allocated by SDL. Freed with ~SDL_FreeWAV~.
+ *
+ * This also owns buffers produced by ~ConvertWAV~: ~SDL_FreeWAV~ is
+ * ~SDL_free~, so anything from ~SDL_malloc~ can live here.
+ */
+struct WAVBuffer {
+  Uint8* data = nullptr;
+  Uint32 size = 0;
+
+  WAVBuffer() = default;
+  WAVBuffer(Uint8* const data, Uint32 const size) noexcept
+      : data{data}, size{size} {}
+
+  WAVBuffer(WAVBuffer const&) = delete;
+  WAVBuffer(WAVBuffer&& other) noexcept
+      : data{std::exchange(other.data, nullptr)},
+        size{std::exchange(other.size, 0)} {}
+  WAVBuffer& operator=(WAVBuffer other) noexcept {
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+    return *this;
+  }
+
+  ~WAVBuffer() { SDL_FreeWAV(data); }
+
+  Uint8* release() noexcept {
+    size = 0;
+    return std::exchange(data, nullptr);
+  }
+};
+
+/**
+ * The result of ~SDL_LoadWAV_RW~: the spec and the samples it describes.
+ */
+struct WAV {
+  AudioSpec spec{};
+  WAVBuffer buffer;
+};
+
+inline MayError<WAV> LoadWAV_RW(RWops* const src) noexcept {
+  WAV wav;
+  SDLRAII_COLD_IF(SDL_LoadWAV_RW(src,
+                                 false,
+                                 &wav.spec,
+                                 &wav.buffer.data,
+                                 &wav.buffer.size)
+                  == nullptr)
+    return sdl::GetError();
+  return wav;
+}
+inline auto LoadWAV_RW(UniqueRWops src)
+    SDLRAII_BODY_EXP(LoadWAV_RW(src.get()))
+
+inline MayError<WAV> LoadWAV(char const* const file) noexcept {
+  auto rw = RWFromFile(file, "rb");
+  SDLRAII_BAIL_ERROR(rw);
+  return LoadWAV_RW(rw.success().get());
+}
+
+/**
+ * Converts ~wav~ to the format, channel count and rate of ~target~.
+ * Returns ~wav~ untouched if no conversion is needed. The converted samples
+ * are trimmed to their final length, so the result never holds the
+ * ~len_mult~ scratch space ~SDL_ConvertAudio~ needs.
+ */
+inline MayError<WAV> ConvertWAV(WAV wav, AudioSpec const& target) noexcept {
+  AudioCVT cvt;
+  auto const needed = SDL_BuildAudioCVT(&cvt,
+                                        wav.spec.format,
+                                        wav.spec.channels,
+                                        wav.spec.freq,
+                                        target.format,
+                                        target.channels,
+                                        target.freq);
+  SDLRAII_COLD_IF(needed < 0)
+    return sdl::GetError();
+  if(needed == 0) return wav;
+
+  auto const len = static_cast<int>(wav.buffer.size);
+  auto* const buf =
+      static_cast<Uint8*>(SDL_malloc(static_cast<size_t>(len) * cvt.len_mult));
+  SDLRAII_COLD_IF(buf == nullptr) {
+    SDL_OutOfMemory();
+    return sdl::GetError();
+  }
+  std::memcpy(buf, wav.buffer.data, static_cast<size_t>(len));
+  cvt.buf = buf;
+  cvt.len = len;
+  SDLRAII_COLD_IF(SDL_ConvertAudio(&cvt) != 0) {
+    SDL_free(buf);
+    return sdl::GetError();
+  }
+
+  WAV result;
+  result.spec          = wav.spec;
+  result.spec.format   = target.format;
+  result.spec.channels = target.channels;
+  result.spec.freq     = target.freq;
+  // an empty or very short clip can convert to nothing, and realloc to 0
+  // bytes may free the block
+  if(cvt.len_cvt == 0) {
+    SDL_free(buf);
+    return result;
+  }
+  // shrinking can't fail in practice; keep the larger block if it does
+  auto* const trimmed = static_cast<Uint8*>(
+      SDL_realloc(buf, static_cast<size_t>(cvt.len_cvt)));
+  result.buffer =
+      WAVBuffer{trimmed ? trimmed : buf, static_cast<Uint32>(cvt.len_cvt)};
+  return result;
+}
+
+/**
+ * Owns an audio device ID. Closed with ~SDL_CloseAudioDevice~.
+ * Device IDs are integers, not pointers, so this can't be a ~DEFUNIQUE~.
+ */
+class UniqueAudioDevice {
+ public:
+  UniqueAudioDevice() = default;
+  explicit UniqueAudioDevice(AudioDeviceID const id) noexcept : id_{id} {}
+  UniqueAudioDevice(UniqueAudioDevice&& other) noexcept
+      : id_{std::exchange(other.id_, 0)} {}
+  UniqueAudioDevice& operator=(UniqueAudioDevice other) noexcept {
+    std::swap(id_, other.id_);
+    return *this;
+  }
+  ~UniqueAudioDevice() {
+    if(id_ != 0) SDL_CloseAudioDevice(id_);
+  }
+
+  AudioDeviceID get() const noexcept { return id_; }
+  AudioDeviceID release() noexcept { return std::exchange(id_, 0); }
+  explicit operator bool() const noexcept { return id_ != 0; }
+
+ private:
+  AudioDeviceID id_ = 0;
+};
+
+/**
+ * Opens an audio device. Returns the device and the obtained spec instead of
+ * using an out parameter.
+ */
+inline MayError<std::tuple<UniqueAudioDevice, AudioSpec>>
+    OpenAudioDevice(char const* const device,
+                    bool const iscapture,
+                    AudioSpec const& desired,
+                    int const allowed_changes = 0) noexcept {
+  AudioSpec obtained{};
+  auto const id = SDL_OpenAudioDevice(
+      device, iscapture, &desired, &obtained, allowed_changes);
+  SDLRAII_COLD_IF(id == 0)
+    return sdl::GetError();
+  return std::tuple{UniqueAudioDevice{id}, obtained};
+}
+
+SDLRAII_WRAP_FN(PauseAudioDevice, );
+SDLRAII_WRAP_FN(QueueAudio, nonzero_error);
+SDLRAII_WRAP_FN(GetQueuedAudioSize, );
+SDLRAII_WRAP_FN(ClearQueuedAudio, );
+
+inline auto QueueAudio(AudioDeviceID const dev, WAV const& wav)
+    SDLRAII_BODY_EXP(QueueAudio(dev, wav.buffer.data, wav.buffer.size))
+
+/**
+ * Sound effects converted once, at load, to the format of an opened device.
+ *
+ * Entries are deduplicated by key (the path for files), so loading the same
+ * effect twice returns the same samples. Returned pointers stay valid until
+ * the entry is erased or the cache is destroyed.
+ */
+class SoundCache {
+ public:
+  explicit SoundCache(AudioSpec const& device_spec) noexcept
+      : spec_{device_spec} {}
+
+  AudioSpec const& spec() const noexcept { return spec_; }
+
+  MayError<WAV const*> load(char const* const file) {
+    if(auto const* hit = find(file)) return hit;
+    auto rw = RWFromFile(file, "rb");
+    SDLRAII_BAIL_ERROR(rw);
+    return insert(file, rw.success().get());
+  }
+
+  /**
+   * Loads from any RWops, e.g. ~RWFromConstMem~ over an embedded asset.
+   * ~src~ is only read on a miss.
+   */
+  MayError<WAV const*> load(std::string key, RWops* const src) {
+    if(auto const* hit = find(key)) return hit;
+    return insert(std::move(key), src);
+  }
+  MayError<WAV const*> load(std::string key, UniqueRWops src) {
+    return load(std::move(key), src.get());
+  }
+
+  WAV const* find(std::string const& key) const noexcept {
+    auto const it = sounds_.find(key);
+    return it == sounds_.end() ? nullptr : &it->second;
+  }
+
+  bool erase(std::string const& key) {
+    auto const it = sounds_.find(key);
+    if(it == sounds_.end()) return false;
+    bytes_ -= it->second.buffer.size;
+    sounds_.erase(it);
+    return true;
+  }
+  void clear() noexcept {
+    sounds_.clear();
+    bytes_ = 0;
+  }
+
+  std::size_t size() const noexcept { return sounds_.size(); }
+  /** Total bytes of resident, converted samples. */
+  std::size_t bytes() const noexcept { return bytes_; }
+
+ private:
+  MayError<WAV const*> insert(std::string key, RWops* const src) {
+    auto loaded = LoadWAV_RW(src);
+    SDLRAII_BAIL_ERROR(loaded);
+    auto converted = ConvertWAV(std::move(loaded).success(), spec_);
+    SDLRAII_BAIL_ERROR(converted);
+    auto const [it, _] =
+        sounds_.emplace(std::move(key), std::move(converted).success());
+    bytes_ += it->second.buffer.size;
+    return &it->second;
+  }
+
+  AudioSpec spec_;
+  std::unordered_map<std::string, WAV> sounds_;
+  std::size_t bytes_ = 0;
+};
+
+} // namespace sdl
+#undef SDLRAII_THE_PREFIX
+
+#endif // SDLRAII_AUDIO_INCLUDE_GUARD
@@ -0,0 +1,486 @@
+#ifndef SDLRAII_BLIT_INCLUDE_GUARD
+#define SDLRAII_BLIT_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "thread.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)              \
+    || defined(_M_IX86)
+#  define SDLRAII_BLIT_X86 1
+#  include <immintrin.h>
+// the kernels are built for their instruction sets whatever the baseline,
+// and only called once the CPU is known to have them
+#  if defined(__GNUC__) || defined(__clang__)
+#    define SDLRAII_BLIT_TARGET(isa) __attribute__((target(isa)))
+#  else
+#    define SDLRAII_BLIT_TARGET(isa)
+#  endif
+#endif
+
+namespace sdl {
+
+namespace impl {
+/**
+ * ~x / 255~, truncated as SDL's blitters do, for ~x~ up to ~255 * 255~.
+ */
+inline Uint32 div255(Uint32 x) noexcept {
+  x += 1;
+  return (x + (x >> 8)) >> 8;
+}
+/** ~a * b / 255~, truncated. */
+inline Uint32 mul255(Uint32 const a, Uint32 const b) noexcept {
+  return div255(a * b);
+}
+
+inline Uint32 pack_argb(Uint32 const a,
+                        Uint32 const r,
+                        Uint32 const g,
+                        Uint32 const b) noexcept {
+  return a << 24 | r << 16 | g << 8 | b;
+}
+
+/** Each byte of ~p~ times the matching one of ~q~. */
+inline Uint32 modulate_argb(Uint32 const p, Uint32 const q) noexcept {
+  return pack_argb(mul255(p >> 24, q >> 24),
+                   mul255(p >> 16 & 0xff, q >> 16 & 0xff),
+                   mul255(p >> 8 & 0xff, q >> 8 & 0xff),
+                   mul255(p & 0xff, q & 0xff));
+}
+
+inline Uint32 swap_red_blue(Uint32 const p) noexcept {
+  return (p & 0xff00ff00) | (p >> 16 & 0xff) | (p & 0xff) << 16;
+}
+
+/**
+ * Source ~s~ onto destination ~d~ by SDL's rule for ~mode~, with the
+ * truncating arithmetic of its general blitters. Alpha is the top byte; the
+ * other three are treated alike, so this serves ARGB8888 and ABGR8888.
+ */
+template<BlendMode::type mode>
+inline Uint32 compose(Uint32 const d, Uint32 const s) noexcept {
+  if constexpr(mode == BlendMode::none) {
+    return s;
+  } else {
+    auto const sa = s >> 24, da = d >> 24;
+    auto const channel = [&](int const shift) {
+      auto const sc = s >> shift & 0xff, dc = d >> shift & 0xff;
+      if constexpr(mode == BlendMode::blend)
+        return mul255(sc, sa) + mul255(dc, 255 - sa);
+      else if constexpr(mode == BlendMode::add)
+        return std::min<Uint32>(mul255(sc, sa) + dc, 255);
+      else
+        return mul255(sc, dc);
+    };
+    auto const a = mode == BlendMode::blend ? sa + mul255(da, 255 - sa) : da;
+    return pack_argb(a, channel(16), channel(8), channel(0));
+  }
+}
+
+/**
+ * SDL's blend for a source with no color or alpha mod, which it sends to
+ * dedicated blitters that divide by 256: one for matching formats and one,
+ * rounding differently, for formats with red and blue swapped.
+ */
+template<bool swapped>
+inline Uint32 compose_pixel_alpha(Uint32 const d, Uint32 const s) noexcept {
+  auto const sa = s >> 24;
+  if(sa == 0) return d;
+  if(sa == 255) return s;
+  auto const channel = [&](int const shift) {
+    auto const sc = s >> shift & 0xff, dc = d >> shift & 0xff;
+    if constexpr(swapped)
+      return (sc * sa + dc * (256 - sa)) >> 8;
+    else
+      return (sc * sa >> 8) + (dc * (255 - sa) >> 8);
+  };
+  auto const a = sa + ((d >> 24) * (255 - sa) >> 8);
+  return pack_argb(a, channel(16), channel(8), channel(0));
+}
+
+/** Calls ~fn~ with ~mode~ as an ~std::integral_constant~. */
+template<class Fn>
+inline void with_blend_mode(BlendMode::type const mode, Fn&& fn) {
+  using M = BlendMode::type;
+  switch(mode) {
+    case BlendMode::none:
+      fn(std::integral_constant<M, BlendMode::none>{});
+      break;
+    case BlendMode::add: fn(std::integral_constant<M, BlendMode::add>{}); break;
+    case BlendMode::mod: fn(std::integral_constant<M, BlendMode::mod>{}); break;
+    default: fn(std::integral_constant<M, BlendMode::blend>{}); break;
+  }
+}
+
+inline Uint32* pixel_row(Surface* const surface, int const y) noexcept {
+  return reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels)
+                                   + y * surface->pitch);
+}
+
+/** How a row of source pixels goes onto the destination, as SDL would. */
+struct BlitRow {
+  Uint32 mod   = 0xffffffff; // per byte multipliers, in destination order
+  bool swap_rb = false;      // red and blue trade places first
+
+  bool modulated() const noexcept { return mod != 0xffffffff; }
+};
+
+template<BlendMode::type mode>
+inline void blit_row_scalar(Uint32 const* const src,
+                            Uint32* const dst,
+                            std::size_t const n,
+                            BlitRow const& row) noexcept {
+  for(std::size_t i = 0; i < n; ++i) {
+    auto s = row.swap_rb ? swap_red_blue(src[i]) : src[i];
+    if(row.modulated())
+      s = modulate_argb(s, row.mod);
+    else if constexpr(mode == BlendMode::blend) {
+      dst[i] = row.swap_rb ? compose_pixel_alpha<true>(dst[i], s)
+                           : compose_pixel_alpha<false>(dst[i], s);
+      continue;
+    }
+    dst[i] = compose<mode>(dst[i], s);
+  }
+}
+
+#ifdef SDLRAII_BLIT_X86
+// Pixels are widened to 16 bits a channel, two per SSE register and four per
+// AVX2 one, where the arithmetic is exactly that of the scalar path. No
+// intermediate goes past 255 * 256, so all of it fits a 16-bit lane.
+
+SDLRAII_BLIT_TARGET("sse2")
+inline __m128i div255_sse2(__m128i x) noexcept {
+  x = _mm_add_epi16(x, _mm_set1_epi16(1));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+SDLRAII_BLIT_TARGET("sse2")
+inline __m128i mul255_sse2(__m128i const a, __m128i const b) noexcept {
+  return div255_sse2(_mm_mullo_epi16(a, b));
+}
+
+/** ~compose_pixel_alpha~ with ~sa~ the source alpha in every lane. */
+SDLRAII_BLIT_TARGET("sse2")
+inline __m128i compose_pixel_alpha_sse2(__m128i const d,
+                                        __m128i const s,
+                                        __m128i const sa,
+                                        __m128i const alpha,
+                                        bool const swapped) noexcept {
+  auto const full = _mm_set1_epi16(255);
+  auto const inv  = _mm_sub_epi16(full, sa);
+  // the alpha channel keeps all of the source's alpha
+  auto const a = _mm_or_si128(_mm_andnot_si128(alpha, sa),
+                              _mm_and_si128(alpha, _mm_set1_epi16(256)));
+  __m128i blended;
+  if(swapped) {
+    auto const dinv = _mm_add_epi16(
+        inv, _mm_andnot_si128(alpha, _mm_set1_epi16(1)));
+    blended = _mm_srli_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, dinv)), 8);
+  } else {
+    blended = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(s, a), 8),
+                            _mm_srli_epi16(_mm_mullo_epi16(d, inv), 8));
+  }
+  auto const opaque = _mm_cmpeq_epi16(sa, full);
+  auto const clear  = _mm_cmpeq_epi16(sa, _mm_setzero_si128());
+  blended = _mm_or_si128(_mm_andnot_si128(opaque, blended),
+                         _mm_and_si128(opaque, s));
+  return _mm_or_si128(_mm_andnot_si128(clear, blended),
+                      _mm_and_si128(clear, d));
+}
+
+template<BlendMode::type mode>
+SDLRAII_BLIT_TARGET("sse2")
+inline __m128i compose_sse2(__m128i const d,
+                            __m128i s,
+                            __m128i const mod,
+                            BlitRow const& row) noexcept {
+  constexpr auto bgra = _MM_SHUFFLE(3, 0, 1, 2);
+  constexpr auto aaaa = _MM_SHUFFLE(3, 3, 3, 3);
+  if(row.swap_rb)
+    s = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, bgra), bgra);
+  if(row.modulated()) s = mul255_sse2(s, mod);
+  if constexpr(mode == BlendMode::none) {
+    return s;
+  } else {
+    auto const alpha = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    auto const sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, aaaa), aaaa);
+    if constexpr(mode == BlendMode::blend) {
+      if(!row.modulated())
+        return compose_pixel_alpha_sse2(d, s, sa, alpha, row.swap_rb);
+      auto const full = _mm_set1_epi16(255);
+      auto const inv  = _mm_sub_epi16(full, sa);
+      auto const a    = _mm_or_si128(sa, _mm_and_si128(alpha, full));
+      return _mm_add_epi16(mul255_sse2(s, a), mul255_sse2(d, inv));
+    } else {
+      auto const color =
+          mode == BlendMode::add
+              ? _mm_min_epi16(_mm_add_epi16(mul255_sse2(s, sa), d),
+                              _mm_set1_epi16(255))
+              : mul255_sse2(s, d);
+      return _mm_or_si128(_mm_andnot_si128(alpha, color),
+                          _mm_and_si128(alpha, d));
+    }
+  }
+}
+
+/** Four pixels a step; returns how many it did. */
+template<BlendMode::type mode>
+SDLRAII_BLIT_TARGET("sse2")
+inline std::size_t blit_row_sse2(Uint32 const* const src,
+                                 Uint32* const dst,
+                                 std::size_t const n,
+                                 BlitRow const& row) noexcept {
+  auto const zero = _mm_setzero_si128();
+  auto const mod =
+      _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(row.mod)), zero);
+  std::size_t i = 0;
+  for(; i + 4 <= n; i += 4) {
+    auto* const out = reinterpret_cast<__m128i*>(dst + i);
+    auto const s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+    auto const d = _mm_loadu_si128(out);
+    auto const lo = compose_sse2<mode>(
+        _mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), mod, row);
+    auto const hi = compose_sse2<mode>(
+        _mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), mod, row);
+    _mm_storeu_si128(out, _mm_packus_epi16(lo, hi));
+  }
+  return i;
+}
+
+SDLRAII_BLIT_TARGET("avx2")
+inline __m256i div255_avx2(__m256i x) noexcept {
+  x = _mm256_add_epi16(x, _mm256_set1_epi16(1));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+SDLRAII_BLIT_TARGET("avx2")
+inline __m256i mul255_avx2(__m256i const a, __m256i const b) noexcept {
+  return div255_avx2(_mm256_mullo_epi16(a, b));
+}
+
+SDLRAII_BLIT_TARGET("avx2")
+inline __m256i compose_pixel_alpha_avx2(__m256i const d,
+                                        __m256i const s,
+                                        __m256i const sa,
+                                        __m256i const alpha,
+                                        bool const swapped) noexcept {
+  auto const full = _mm256_set1_epi16(255);
+  auto const inv  = _mm256_sub_epi16(full, sa);
+  auto const a =
+      _mm256_or_si256(_mm256_andnot_si256(alpha, sa),
+                      _mm256_and_si256(alpha, _mm256_set1_epi16(256)));
+  __m256i blended;
+  if(swapped) {
+    auto const dinv = _mm256_add_epi16(
+        inv, _mm256_andnot_si256(alpha, _mm256_set1_epi16(1)));
+    blended = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s, a),
+                                                 _mm256_mullo_epi16(d, dinv)),
+                                8);
+  } else {
+    blended =
+        _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(s, a), 8),
+                         _mm256_srli_epi16(_mm256_mullo_epi16(d, inv), 8));
+  }
+  auto const opaque = _mm256_cmpeq_epi16(sa, full);
+  auto const clear  = _mm256_cmpeq_epi16(sa, _mm256_setzero_si256());
+  blended = _mm256_blendv_epi8(blended, s, opaque);
+  return _mm256_blendv_epi8(blended, d, clear);
+}
+
+template<BlendMode::type mode>
+SDLRAII_BLIT_TARGET("avx2")
+inline __m256i compose_avx2(__m256i const d,
+                            __m256i s,
+                            __m256i const mod,
+                            BlitRow const& row) noexcept {
+  constexpr auto bgra = _MM_SHUFFLE(3, 0, 1, 2);
+  constexpr auto aaaa = _MM_SHUFFLE(3, 3, 3, 3);
+  if(row.swap_rb)
+    s = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, bgra), bgra);
+  if(row.modulated()) s = mul255_avx2(s, mod);
+  if constexpr(mode == BlendMode::none) {
+    return s;
+  } else {
+    auto const alpha = _mm256_set_epi16(
+        -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+    auto const sa =
+        _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, aaaa), aaaa);
+    if constexpr(mode == BlendMode::blend) {
+      if(!row.modulated())
+        return compose_pixel_alpha_avx2(d, s, sa, alpha, row.swap_rb);
+      auto const full = _mm256_set1_epi16(255);
+      auto const inv  = _mm256_sub_epi16(full, sa);
+      auto const a    = _mm256_or_si256(sa, _mm256_and_si256(alpha, full));
+      return _mm256_add_epi16(mul255_avx2(s, a), mul255_avx2(d, inv));
+    } else {
+      auto const color =
+          mode == BlendMode::add
+              ? _mm256_min_epi16(_mm256_add_epi16(mul255_avx2(s, sa), d),
+                                 _mm256_set1_epi16(255))
+              : mul255_avx2(s, d);
+      return _mm256_or_si256(_mm256_andnot_si256(alpha, color),
+                             _mm256_and_si256(alpha, d));
+    }
+  }
+}
+
+/** Eight pixels a step; returns how many it did. */
+template<BlendMode::type mode>
+SDLRAII_BLIT_TARGET("avx2")
+inline std::size_t blit_row_avx2(Uint32 const* const src,
+                                 Uint32* const dst,
+                                 std::size_t const n,
+                                 BlitRow const& row) noexcept {
+  auto const zero = _mm256_setzero_si256();
+  auto const mod =
+      _mm256_unpacklo_epi8(_mm256_set1_epi32(static_cast<int>(row.mod)), zero);
+  std::size_t i = 0;
+  for(; i + 8 <= n; i += 8) {
+    auto* const out = reinterpret_cast<__m256i*>(dst + i);
+    auto const s =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+    auto const d = _mm256_loadu_si256(out);
+    // unpacking and packing both work within 128-bit lanes, so they undo
+    // each other and the pixels keep their order
+    auto const lo = compose_avx2<mode>(
+        _mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero), mod, row);
+    auto const hi = compose_avx2<mode>(
+        _mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero), mod, row);
+    _mm256_storeu_si256(out, _mm256_packus_epi16(lo, hi));
+  }
+  return i;
+}
+#endif
+
+enum class simd_level { scalar, sse2, avx2 };
+
+/** The widest kernels this CPU runs, asked of SDL once. */
+inline simd_level blit_simd_level() noexcept {
+#ifdef SDLRAII_BLIT_X86
+  static auto const level = HasAVX2() == SDL_TRUE ? simd_level::avx2
+                            : HasSSE2() == SDL_TRUE ? simd_level::sse2
+                                                    : simd_level::scalar;
+  return level;
+#else
+  return simd_level::scalar;
+#endif
+}
+
+/** ~n~ pixels of ~src~ onto ~dst~ with the best kernel available. */
+template<BlendMode::type mode>
+inline void blit_row(Uint32 const* const src,
+                     Uint32* const dst,
+                     std::size_t const n,
+                     BlitRow const& row) noexcept {
+  std::size_t i = 0;
+#ifdef SDLRAII_BLIT_X86
+  switch(blit_simd_level()) {
+    case simd_level::avx2: i = blit_row_avx2<mode>(src, dst, n, row); break;
+    case simd_level::sse2: i = blit_row_sse2<mode>(src, dst, n, row); break;
+    case simd_level::scalar: break;
+  }
+#endif
+  blit_row_scalar<mode>(src + i, dst + i, n - i, row);
+}
+
+inline bool blendable_format(Surface const* const surface) noexcept {
+  return surface->format != nullptr
+         && (surface->format->format == SDL_PIXELFORMAT_ARGB8888
+             || surface->format->format == SDL_PIXELFORMAT_ABGR8888);
+}
+} // namespace impl
+
+/**
+ * ~BlitSurface~ with SIMD kernels for the common case: ARGB8888 or ABGR8888
+ * on both sides, in any pairing, with no color key, and blend mode none,
+ * blend, add or mod. The source's color and alpha mods apply as in SDL, and
+ * the arithmetic follows the SDL 2.28 blitter SDL would pick, truncation
+ * included, so results match it exactly; other SDL versions may round their
+ * fast paths differently. Clipping, to the source and to ~dst~'s clip
+ * rectangle, is SDL's too, and ~dstrect~, if given, is likewise set to the
+ * area drawn.
+ *
+ * The AVX2 or SSE2 kernels are picked at run time with ~HasAVX2~ and
+ * ~HasSSE2~. Anything else goes to ~BlitSurface~.
+ */
+inline MayError<void> BlendBlit(Surface* const src,
+                                Rect const* const srcrect,
+                                Surface* const dst,
+                                Rect* const dstrect = nullptr) {
+  SDLRAII_COLD_IF(src == nullptr || dst == nullptr)
+    return sdl::Error{"BlendBlit: null surface"};
+  auto const blend = GetSurfaceBlendMode(src);
+  SDLRAII_BAIL_ERROR(blend);
+  auto const mode = blend.get();
+  if(!impl::blendable_format(src) || !impl::blendable_format(dst)
+     || SDL_MUSTLOCK(src) || HasColorKey(src) == SDL_TRUE
+     || (mode != BlendMode::none && mode != BlendMode::blend
+         && mode != BlendMode::add && mode != BlendMode::mod)) {
+    auto const blitted = BlitSurface(src, srcrect, dst, dstrect);
+    SDLRAII_BAIL_ERROR(blitted);
+    return {};
+  }
+  auto const color = GetSurfaceColorMod(src);
+  SDLRAII_BAIL_ERROR(color);
+  auto const alpha = GetSurfaceAlphaMod(src);
+  SDLRAII_BAIL_ERROR(alpha);
+
+  // clip to the source, moving the destination along, as SDL_UpperBlit does
+  auto from = srcrect != nullptr ? *srcrect : Rect{0, 0, src->w, src->h};
+  Rect to{dstrect != nullptr ? dstrect->x : 0,
+          dstrect != nullptr ? dstrect->y : 0,
+          0,
+          0};
+  if(from.x < 0) {
+    to.x -= from.x;
+    from.w += from.x;
+    from.x = 0;
+  }
+  if(from.y < 0) {
+    to.y -= from.y;
+    from.h += from.y;
+    from.y = 0;
+  }
+  to.w = std::min(from.w, src->w - from.x);
+  to.h = std::min(from.h, src->h - from.y);
+  auto const area = to.w > 0 && to.h > 0
+                        ? IntersectRect(to, dst->clip_rect)
+                        : std::nullopt;
+  if(dstrect != nullptr) *dstrect = area.value_or(Rect{to.x, to.y, 0, 0});
+  if(!area) return {};
+  from.x += area->x - to.x;
+  from.y += area->y - to.y;
+
+  auto const [r, g, b] = color.get();
+  auto const to_argb   = dst->format->format == SDL_PIXELFORMAT_ARGB8888;
+  impl::BlitRow const row{
+      to_argb ? impl::pack_argb(alpha.get(), r, g, b)
+              : impl::pack_argb(alpha.get(), b, g, r),
+      src->format->format != dst->format->format};
+  auto const must_lock = SDL_MUSTLOCK(dst);
+  if(must_lock) {
+    auto const locked = LockSurface(dst);
+    SDLRAII_BAIL_ERROR(locked);
+  }
+  impl::with_blend_mode(mode, [&](auto const m) {
+    for(int y = 0; y < area->h; ++y)
+      impl::blit_row<decltype(m)::value>(
+          impl::pixel_row(src, from.y + y) + from.x,
+          impl::pixel_row(dst, area->y + y) + area->x,
+          static_cast<std::size_t>(area->w),
+          row);
+  });
+  if(must_lock) UnlockSurface(dst);
+  return {};
+}
+
+} // namespace sdl
+
+#endif // SDLRAII_BLIT_INCLUDE_GUARD
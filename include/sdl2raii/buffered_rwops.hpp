@@ -0,0 +1,273 @@
+#ifndef SDLRAII_BUFFERED_RWOPS_INCLUDE_GUARD
+#define SDLRAII_BUFFERED_RWOPS_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sdl {
+
+/**
+ * Buffers reads and writes to an ~RWops~, so reading a file value by value
+ * costs one call into the stream per buffer instead of one per value.
+ *
+ * Reads fill the buffer ahead of the caller and writes collect in it until it
+ * is full, on ~flush~, or on destruction. Seeking within the data already read
+ * ahead is free; any other seek flushes and moves the underlying stream.
+ * Requests larger than the buffer bypass it.
+ *
+ * ~ReadU8~ through ~WriteBE64~ have overloads taking a ~BufferedRWops~, with
+ * the buffered case inlined. As with SDL, reads past the end return 0 and
+ * writes return the number of values written. Write errors can surface late,
+ * so check ~flush~ before trusting a file.
+ */
+class BufferedRWops {
+ public:
+  static constexpr std::size_t default_capacity = 64 * 1024;
+
+  explicit BufferedRWops(UniqueRWops inner,
+                         std::size_t const capacity = default_capacity)
+      : inner_{std::move(inner)},
+        buffer_{new Uint8[std::max<std::size_t>(capacity, 16)]},
+        capacity_{std::max<std::size_t>(capacity, 16)} {
+    auto const at = SDL_RWtell(inner_.get());
+    base_         = at < 0 ? 0 : at;
+  }
+  BufferedRWops(BufferedRWops&& other) noexcept
+      : inner_{std::move(other.inner_)},
+        buffer_{std::move(other.buffer_)},
+        capacity_{other.capacity_},
+        base_{other.base_},
+        cur_{other.cur_},
+        end_{other.end_},
+        mode_{std::exchange(other.mode_, mode::idle)} {}
+  BufferedRWops(BufferedRWops const&) = delete;
+  BufferedRWops& operator=(BufferedRWops const&) = delete;
+  ~BufferedRWops() {
+    if(inner_) static_cast<void>(flush());
+  }
+
+  /** Like ~SDL_RWread~: returns the number of whole objects read. */
+  std::size_t
+      read(void* const dst, std::size_t const size, std::size_t const n) {
+    if(size == 0 || n == 0) return 0;
+    SDLRAII_COLD_IF(mode_ != mode::reading && !begin_reading()) return 0;
+    auto const want = size * n;
+    auto* const out = static_cast<Uint8*>(dst);
+    std::size_t got = 0;
+    while(got < want) {
+      if(auto const k = std::min(end_ - cur_, want - got); k > 0) {
+        std::memcpy(out + got, buffer_.get() + cur_, k);
+        cur_ += k;
+        got += k;
+        continue;
+      }
+      base_ += static_cast<Sint64>(end_);
+      cur_ = end_ = 0;
+      if(want - got >= capacity_) {
+        auto const k = SDL_RWread(inner_.get(), out + got, 1, want - got);
+        base_ += static_cast<Sint64>(k);
+        got += k;
+        break;
+      }
+      end_ = SDL_RWread(inner_.get(), buffer_.get(), 1, capacity_);
+      if(end_ == 0) break;
+    }
+    return got / size;
+  }
+
+  /** Like ~SDL_RWwrite~: returns the number of whole objects accepted. */
+  std::size_t write(void const* const src,
+                    std::size_t const size,
+                    std::size_t const n) {
+    if(size == 0 || n == 0) return 0;
+    SDLRAII_COLD_IF(mode_ != mode::writing && !begin_writing()) return 0;
+    auto const want = size * n;
+    if(want > capacity_ - cur_ && !flush_buffer()) return 0;
+    if(want >= capacity_) {
+      auto const k = SDL_RWwrite(inner_.get(), src, 1, want);
+      base_ += static_cast<Sint64>(k);
+      return k / size;
+    }
+    std::memcpy(buffer_.get() + cur_, src, want);
+    cur_ += want;
+    return n;
+  }
+
+  /** Like ~SDL_RWseek~. Returns the new position, or -1 on error. */
+  Sint64 seek(Sint64 const offset, int const whence) {
+    Sint64 target;
+    switch(whence) {
+      case RW_SEEK_SET: target = offset; break;
+      case RW_SEEK_CUR: target = tell() + offset; break;
+      default: return reposition(offset, whence);
+    }
+    SDLRAII_COLD_IF(target < 0) return SDL_SetError("seek before start");
+    if(mode_ == mode::reading && target >= base_
+       && target <= base_ + static_cast<Sint64>(end_)) {
+      cur_ = static_cast<std::size_t>(target - base_);
+      return target;
+    }
+    return reposition(target, RW_SEEK_SET);
+  }
+  Sint64 tell() const noexcept { return base_ + static_cast<Sint64>(cur_); }
+  Sint64 size() {
+    static_cast<void>(flush());
+    return SDL_RWsize(inner_.get());
+  }
+
+  /** Write out buffered data. Read-ahead is kept. */
+  MayError<void> flush() noexcept {
+    SDLRAII_COLD_IF(mode_ == mode::writing && !flush_buffer())
+      return sdl::GetError();
+    return {};
+  }
+
+  RWops* get() const noexcept { return inner_.get(); }
+  std::size_t capacity() const noexcept { return capacity_; }
+
+  /** Flush and give back the stream, positioned at ~tell()~. */
+  UniqueRWops release() {
+    reposition(tell(), RW_SEEK_SET);
+    return std::move(inner_);
+  }
+
+  /** One native-endian value. The common case is a copy out of the buffer. */
+  template<class T>
+  requires std::is_trivially_copyable_v<T>
+  T read_value() {
+    T value{};
+    SDLRAII_HOT_IF(mode_ == mode::reading && end_ - cur_ >= sizeof value) {
+      std::memcpy(&value, buffer_.get() + cur_, sizeof value);
+      cur_ += sizeof value;
+      return value;
+    }
+    return read(&value, sizeof value, 1) == 1 ? value : T{};
+  }
+  template<class T>
+  requires std::is_trivially_copyable_v<T>
+  std::size_t write_value(T const value) {
+    SDLRAII_HOT_IF(mode_ == mode::writing && capacity_ - cur_ >= sizeof value) {
+      std::memcpy(buffer_.get() + cur_, &value, sizeof value);
+      cur_ += sizeof value;
+      return 1;
+    }
+    return write(&value, sizeof value, 1);
+  }
+
+ private:
+  // reading: the stream is at ~base_ + end_~ and ~buffer_[cur_, end_)~ is
+  //          read-ahead
+  // writing: the stream is at ~base_~ and ~buffer_[0, cur_)~ is unwritten
+  // idle:    the stream is at ~base_~ and the buffer is empty
+  enum class mode : Uint8 { idle, reading, writing };
+
+  bool begin_reading() {
+    if(mode_ == mode::writing) {
+      // stdio wants a seek between writing and reading
+      if(!flush_buffer() || SDL_RWseek(inner_.get(), base_, RW_SEEK_SET) < 0)
+        return false;
+    }
+    cur_ = end_ = 0;
+    mode_       = mode::reading;
+    return true;
+  }
+
+  bool begin_writing() {
+    if(mode_ == mode::reading) {
+      // unread read-ahead means the stream is past the logical position
+      auto const at = tell();
+      if(cur_ != end_ && SDL_RWseek(inner_.get(), at, RW_SEEK_SET) < 0)
+        return false;
+      base_ = at;
+    }
+    cur_ = end_ = 0;
+    mode_       = mode::writing;
+    return true;
+  }
+
+  /** In writing mode, write the buffer out. Drops it on failure. */
+  bool flush_buffer() {
+    auto const pending = std::exchange(cur_, 0);
+    if(pending == 0) return true;
+    auto const written = SDL_RWwrite(inner_.get(), buffer_.get(), 1, pending);
+    base_ += static_cast<Sint64>(written);
+    return written == pending;
+  }
+
+  Sint64 reposition(Sint64 const offset, int const whence) {
+    if(mode_ == mode::writing) flush_buffer();
+    cur_ = end_ = 0;
+    mode_       = mode::idle;
+    auto const at = SDL_RWseek(inner_.get(), offset, whence);
+    if(at >= 0)
+      base_ = at;
+    else if(auto const now = SDL_RWtell(inner_.get()); now >= 0)
+      base_ = now;
+    return at;
+  }
+
+  UniqueRWops inner_;
+  std::unique_ptr<Uint8[]> buffer_;
+  std::size_t capacity_;
+  Sint64 base_     = 0; // stream offset of ~buffer_[0]~
+  std::size_t cur_ = 0;
+  std::size_t end_ = 0;
+  mode mode_       = mode::idle;
+};
+
+inline Uint8 ReadU8(BufferedRWops& rw) { return rw.read_value<Uint8>(); }
+inline Uint16 ReadLE16(BufferedRWops& rw) {
+  return SDL_SwapLE16(rw.read_value<Uint16>());
+}
+inline Uint16 ReadBE16(BufferedRWops& rw) {
+  return SDL_SwapBE16(rw.read_value<Uint16>());
+}
+inline Uint32 ReadLE32(BufferedRWops& rw) {
+  return SDL_SwapLE32(rw.read_value<Uint32>());
+}
+inline Uint32 ReadBE32(BufferedRWops& rw) {
+  return SDL_SwapBE32(rw.read_value<Uint32>());
+}
+inline Uint64 ReadLE64(BufferedRWops& rw) {
+  return SDL_SwapLE64(rw.read_value<Uint64>());
+}
+inline Uint64 ReadBE64(BufferedRWops& rw) {
+  return SDL_SwapBE64(rw.read_value<Uint64>());
+}
+
+inline std::size_t WriteU8(BufferedRWops& rw, Uint8 const value) {
+  return rw.write_value(value);
+}
+inline std::size_t WriteLE16(BufferedRWops& rw, Uint16 const value) {
+  return rw.write_value<Uint16>(SDL_SwapLE16(value));
+}
+inline std::size_t WriteBE16(BufferedRWops& rw, Uint16 const value) {
+  return rw.write_value<Uint16>(SDL_SwapBE16(value));
+}
+inline std::size_t WriteLE32(BufferedRWops& rw, Uint32 const value) {
+  return rw.write_value<Uint32>(SDL_SwapLE32(value));
+}
+inline std::size_t WriteBE32(BufferedRWops& rw, Uint32 const value) {
+  return rw.write_value<Uint32>(SDL_SwapBE32(value));
+}
+inline std::size_t WriteLE64(BufferedRWops& rw, Uint64 const value) {
+  return rw.write_value<Uint64>(SDL_SwapLE64(value));
+}
+inline std::size_t WriteBE64(BufferedRWops& rw, Uint64 const value) {
+  return rw.write_value<Uint64>(SDL_SwapBE64(value));
+}
+
+} // namespace sdl
+
+#endif // SDLRAII_BUFFERED_RWOPS_INCLUDE_GUARD
@@ -0,0 +1,656 @@
+#ifndef SDLRAII_COMPOSITOR_INCLUDE_GUARD
+#define SDLRAII_COMPOSITOR_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "blit.hpp"
+#include "jobs.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace sdl {
+
+/**
+ * A software renderer that splits the screen into tiles and draws them in
+ * parallel on a ~JobSystem~, straight into a window's surface.
+ *
+ * Drawing calls only record commands. ~render~ bins each command into the
+ * ~tile_size~ squares it overlaps, then rasterizes every tile as its own job,
+ * running the tile's commands in the order they were recorded; tiles share
+ * no pixels, so the jobs need no locking and the result is the same as
+ * drawing serially. ~present~ renders into ~GetWindowSurface~ and shows it
+ * with ~UpdateWindowSurface~; to draw offscreen, ~render~ into any surface,
+ * e.g. one from a ~SurfacePool~.
+ *
+ * ~geometry~ takes the same vertices and indices as ~RenderGeometry~, and
+ * ~line~, ~lines~, ~outline~ and ~points~ stand in for SDL's draw calls, so
+ * the batching APIs can target a compositor instead of a renderer:
+ * ~ShapeBatch~, ~TextRenderer~, ~ParticleSystem~ and ~DebugDraw~ each have
+ * overloads taking a ~Compositor&~, and surfaces where they take textures.
+ * Triangles follow the top-left fill rule, so a mesh blends each pixel once.
+ * As in SDL's software renderer, two triangles making an axis-aligned
+ * rectangle in one color are drawn as a fill, or as a copy if the texture
+ * maps onto it unflipped and unscaled, as text and particle quads do. Lines
+ * are one pixel wide and strips draw the pixel where segments meet once.
+ *
+ * Targets are ARGB8888 or RGB888, as window surfaces are on most platforms,
+ * and sources ARGB8888; convert others with ~ConvertSurfaceFormat~ first.
+ * Sampling is nearest, and the blend modes are SDL's none, blend, add and
+ * mod. Sources are read during ~render~ and must outlive it.
+ */
+class Compositor {
+ public:
+  static constexpr int tile_size = 64;
+
+  struct Stats {
+    std::size_t commands  = 0;
+    std::size_t triangles = 0;
+    std::size_t binned    = 0; // commands summed over the tiles they touch
+    std::size_t tiles     = 0; // with something to draw
+  };
+
+  explicit Compositor(JobSystem& jobs) : jobs_{&jobs} {}
+
+  std::size_t size() const noexcept { return commands_.size(); }
+  bool empty() const noexcept { return commands_.empty(); }
+
+  /** Drop the recorded commands without drawing them. */
+  void clear() noexcept {
+    commands_.clear();
+    triangles_.clear();
+    lines_.clear();
+  }
+
+  void fill(Rect const dst,
+            rgba const color,
+            BlendMode::type const mode = BlendMode::blend) {
+    if(dst.w <= 0 || dst.h <= 0) return;
+    commands_.push_back({kind::fill, mode, dst, argb(color), nullptr, {}, 0});
+  }
+
+  /** A one-pixel border just inside ~dst~. */
+  void outline(Rect const dst,
+               rgba const color,
+               BlendMode::type const mode = BlendMode::blend) {
+    if(dst.w <= 0 || dst.h <= 0) return;
+    fill({dst.x, dst.y, dst.w, 1}, color, mode);
+    if(dst.h == 1) return;
+    fill({dst.x, dst.y + dst.h - 1, dst.w, 1}, color, mode);
+    fill({dst.x, dst.y + 1, 1, dst.h - 2}, color, mode);
+    if(dst.w == 1) return;
+    fill({dst.x + dst.w - 1, dst.y + 1, 1, dst.h - 2}, color, mode);
+  }
+
+  /** The pixel each point falls in. */
+  void points(std::span<FPoint const> const points,
+              rgba const color,
+              BlendMode::type const mode = BlendMode::blend) {
+    for(auto const p : points)
+      if(auto const at = pixel(p)) fill({at->x, at->y, 1, 1}, color, mode);
+  }
+
+  /** A one-pixel line from ~a~ to ~b~, both ends included. */
+  void line(FPoint const a,
+            FPoint const b,
+            rgba const color,
+            BlendMode::type const mode = BlendMode::blend) {
+    FPoint const ends[] = {a, b};
+    lines(ends, color, mode);
+  }
+
+  /**
+   * Connected one-pixel lines through ~points~, as ~RenderDrawLines~. Where
+   * segments meet the pixel is drawn once, and a strip ending where it began
+   * doesn't draw its first pixel again.
+   */
+  void lines(std::span<FPoint const> const points,
+             rgba const color,
+             BlendMode::type const mode = BlendMode::blend) {
+    if(points.size() < 2) return;
+    auto const start = pixel(points.front());
+    for(std::size_t i = 0; i + 1 < points.size(); ++i) {
+      auto const from = pixel(points[i]);
+      auto const to   = pixel(points[i + 1]);
+      if(!from || !to) continue;
+      auto const closes = start && to->x == start->x && to->y == start->y;
+      auto const last   = i + 2 == points.size() && !(i > 0 && closes);
+      Rect const bounds{std::min(from->x, to->x),
+                        std::min(from->y, to->y),
+                        std::abs(to->x - from->x) + 1,
+                        std::abs(to->y - from->y) + 1};
+      commands_.push_back(
+          {kind::line, mode, bounds, argb(color), nullptr, {}, lines_.size()});
+      lines_.push_back({*from, *to, last});
+    }
+  }
+
+  /**
+   * ~src_rect~ of ~source~, or all of it, scaled to ~dst~ and tinted. A
+   * ~src_rect~ reaching past ~source~ is cut to it, still filling ~dst~.
+   */
+  MayError<void> copy(Surface* const source,
+                      std::optional<Rect> const src_rect,
+                      Rect const dst,
+                      rgba const tint            = {255, 255, 255, 255},
+                      BlendMode::type const mode = BlendMode::blend) {
+    auto const readable = check_source(source);
+    SDLRAII_BAIL_ERROR(readable);
+    auto const src = src_rect.value_or(Rect{0, 0, source->w, source->h});
+    auto const clipped = overlap(src, Rect{0, 0, source->w, source->h});
+    if(!clipped || dst.w <= 0 || dst.h <= 0) return {};
+    commands_.push_back(
+        {kind::copy, mode, dst, argb(tint), source, *clipped, 0});
+    return {};
+  }
+
+  /**
+   * Triangles as for ~RenderGeometry~: every three ~indices~, or every three
+   * ~vertices~ if there are none, textured with ~texture~ if given.
+   */
+  MayError<void> geometry(Surface* const texture,
+                          std::span<Vertex const> const vertices,
+                          std::span<int const> const indices = {},
+                          BlendMode::type const mode = BlendMode::blend) {
+    if(texture != nullptr) {
+      auto const readable = check_source(texture);
+      SDLRAII_BAIL_ERROR(readable);
+    }
+    auto const n = indices.empty() ? vertices.size() : indices.size();
+    auto const at = [&](std::size_t const i) -> Vertex const* {
+      if(indices.empty()) return &vertices[i];
+      auto const k = static_cast<std::size_t>(indices[i]);
+      return k < vertices.size() ? &vertices[k] : nullptr;
+    };
+    for(std::size_t i = 0; i + 3 <= n; i += 3) {
+      if(i + 6 <= n) {
+        std::array<Vertex const*, 6> pair;
+        for(std::size_t k = 0; k < 6; ++k) pair[k] = at(i + k);
+        if(auto const quad = as_quad(pair, texture)) {
+          if(quad->dst.w > 0 && quad->dst.h > 0)
+            commands_.push_back({texture ? kind::copy : kind::fill,
+                                 mode,
+                                 quad->dst,
+                                 argb(quad->color),
+                                 texture,
+                                 quad->src,
+                                 0});
+          i += 3;
+          continue;
+        }
+      }
+      auto const* a = at(i);
+      auto const* b = at(i + 1);
+      auto const* c = at(i + 2);
+      SDLRAII_COLD_IF(a == nullptr || b == nullptr || c == nullptr)
+        return sdl::Error{"Compositor: vertex index out of range"};
+      auto const x0 = std::min({a->position.x, b->position.x, c->position.x});
+      auto const y0 = std::min({a->position.y, b->position.y, c->position.y});
+      auto const x1 = std::max({a->position.x, b->position.x, c->position.x});
+      auto const y1 = std::max({a->position.y, b->position.y, c->position.y});
+      // far off or non-finite corners would overflow the bounds
+      auto const sane = [](float const v) { return std::abs(v) < 1e7f; };
+      if(!sane(x0) || !sane(y0) || !sane(x1) || !sane(y1)) continue;
+      Rect const bounds{static_cast<int>(std::floor(x0)),
+                        static_cast<int>(std::floor(y0)),
+                        static_cast<int>(std::ceil(x1) - std::floor(x0)) + 1,
+                        static_cast<int>(std::ceil(y1) - std::floor(y0)) + 1};
+      commands_.push_back(
+          {kind::triangle, mode, bounds, 0, texture, {}, triangles_.size()});
+      triangles_.push_back({*a, *b, *c});
+    }
+    return {};
+  }
+
+  /** Draw everything recorded into ~target~, within its clip rectangle. */
+  MayError<void> render(Surface* const target) {
+    SDLRAII_COLD_IF(target == nullptr || target->format == nullptr
+                    || (target->format->format != SDL_PIXELFORMAT_ARGB8888
+                        && target->format->format != SDL_PIXELFORMAT_RGB888)) {
+      clear();
+      return sdl::Error{"Compositor: target must be ARGB8888 or RGB888"};
+    }
+    auto const must_lock = SDL_MUSTLOCK(target);
+    if(must_lock) {
+      auto const locked = LockSurface(target);
+      SDLRAII_COLD_IF(!locked.ok()) {
+        clear();
+        return locked.error();
+      }
+    }
+    stats_ = {commands_.size(), triangles_.size(), 0, 0};
+    auto const clip  = target->clip_rect;
+    auto const cols  = (clip.w + tile_size - 1) / tile_size;
+    auto const rows  = (clip.h + tile_size - 1) / tile_size;
+    auto const tiles = static_cast<std::size_t>(std::max(cols * rows, 0));
+    bin(clip, cols, tiles);
+    busy_.clear();
+    for(std::size_t t = 0; t < tiles; ++t)
+      if(!bins_[t].empty()) busy_.push_back(static_cast<Uint32>(t));
+    stats_.tiles = busy_.size();
+    auto const draw_tiles = [&](std::size_t t, std::size_t const last) {
+      for(; t < last; ++t) {
+        auto const b   = busy_[t];
+        auto const col = static_cast<int>(b) % cols;
+        auto const row = static_cast<int>(b) / cols;
+        Rect const tile{clip.x + col * tile_size,
+                        clip.y + row * tile_size,
+                        std::min(tile_size, clip.w - col * tile_size),
+                        std::min(tile_size, clip.h - row * tile_size)};
+        for(auto const i : bins_[b]) draw(target, tile, commands_[i]);
+      }
+    };
+    jobs_->parallel_for(0, busy_.size(), 1, draw_tiles);
+    if(must_lock) UnlockSurface(target);
+    clear();
+    return {};
+  }
+
+  /** ~render~ into ~window~'s surface and show it. */
+  MayError<void> present(Window* const window) {
+    auto* const surface = GetWindowSurface(window);
+    SDLRAII_COLD_IF(surface == nullptr) {
+      clear();
+      return sdl::GetError();
+    }
+    auto const rendered = render(surface);
+    SDLRAII_BAIL_ERROR(rendered);
+    auto const shown = UpdateWindowSurface(window);
+    SDLRAII_BAIL_ERROR(shown);
+    return {};
+  }
+
+  /** Counts from the last ~render~. */
+  Stats const& stats() const noexcept { return stats_; }
+
+ private:
+  enum class kind : Uint8 { fill, copy, triangle, line };
+
+  struct Command {
+    kind type;
+    BlendMode::type mode;
+    Rect bounds;         // the pixels it may touch
+    Uint32 color;        // ARGB8888: the fill, or the tint of a copy
+    Surface* source;     // of a copy, or the texture of a triangle
+    Rect src;            // of a copy
+    std::size_t index;   // into ~triangles_~ or ~lines_~
+  };
+
+  struct Line {
+    Point from;
+    Point to;
+    bool last; // whether ~to~ is drawn
+  };
+
+  static Uint32 argb(rgba const c) noexcept {
+    return impl::pack_argb(c.a, c.r, c.g, c.b);
+  }
+
+  /** The pixel ~p~ falls in, unless it is too far off to count. */
+  static std::optional<Point> pixel(FPoint const p) noexcept {
+    // this also turns away NaN
+    SDLRAII_COLD_IF(!(std::abs(p.x) < 1e7f && std::abs(p.y) < 1e7f))
+      return std::nullopt;
+    return Point{static_cast<int>(std::floor(p.x)),
+                 static_cast<int>(std::floor(p.y))};
+  }
+
+  struct Quad {
+    Rect dst;
+    Rect src;
+    rgba color;
+  };
+
+  /**
+   * The pixels and texels of two triangles that make one axis-aligned
+   * rectangle in one color, its texture neither flipped, scaled nor running
+   * off ~texture~, or none. The pixels are those the triangles would cover.
+   */
+  static std::optional<Quad>
+      as_quad(std::array<Vertex const*, 6> const& pair,
+              Surface* const texture) noexcept {
+    for(auto const* v : pair)
+      if(v == nullptr) return std::nullopt;
+    auto const color = pair[0]->color;
+    auto x0 = pair[0]->position.x, x1 = x0;
+    auto y0 = pair[0]->position.y, y1 = y0;
+    for(auto const* v : pair) {
+      if(v->color.r != color.r || v->color.g != color.g
+         || v->color.b != color.b || v->color.a != color.a)
+        return std::nullopt;
+      x0 = std::min(x0, v->position.x);
+      x1 = std::max(x1, v->position.x);
+      y0 = std::min(y0, v->position.y);
+      y1 = std::max(y1, v->position.y);
+    }
+    // this also turns away NaN
+    if(!(x0 < x1 && y0 < y1 && -1e7f < x0 && x1 < 1e7f && -1e7f < y0
+         && y1 < 1e7f))
+      return std::nullopt;
+
+    // corners are numbered 1 for the right and 2 for the bottom
+    std::array<Vertex const*, 4> corners{};
+    std::array<int, 2> missing;
+    for(int t = 0; t < 2; ++t) {
+      auto seen = 0;
+      for(int k = 0; k < 3; ++k) {
+        auto const* const v = pair[static_cast<std::size_t>(t * 3 + k)];
+        auto const right = v->position.x == x1, bottom = v->position.y == y1;
+        if((!right && v->position.x != x0) || (!bottom && v->position.y != y0))
+          return std::nullopt;
+        auto const corner = static_cast<std::size_t>(right | bottom << 1);
+        auto& first = corners[corner];
+        if(first != nullptr
+           && (first->tex_coord.x != v->tex_coord.x
+               || first->tex_coord.y != v->tex_coord.y))
+          return std::nullopt;
+        first = v;
+        seen |= 1 << corner;
+      }
+      switch(seen ^ 0xf) {
+        case 1: missing[t] = 0; break;
+        case 2: missing[t] = 1; break;
+        case 4: missing[t] = 2; break;
+        case 8: missing[t] = 3; break;
+        default: return std::nullopt;
+      }
+    }
+    // leaving out opposite corners, the two meet along a diagonal
+    if((missing[0] ^ missing[1]) != 3) return std::nullopt;
+
+    // pixel centres on a top or left edge are inside, as for triangles
+    auto const pixel_edge = [](float const v) {
+      return static_cast<int>(std::ceil(v - 0.5f));
+    };
+    Quad quad{{pixel_edge(x0),
+               pixel_edge(y0),
+               pixel_edge(x1) - pixel_edge(x0),
+               pixel_edge(y1) - pixel_edge(y0)},
+              {},
+              {color.r, color.g, color.b, color.a}};
+    if(texture == nullptr) return quad;
+
+    auto const u0 = corners[0]->tex_coord.x, v0 = corners[0]->tex_coord.y;
+    auto const u1 = corners[3]->tex_coord.x, v1 = corners[3]->tex_coord.y;
+    if(corners[2]->tex_coord.x != u0 || corners[1]->tex_coord.y != v0
+       || corners[1]->tex_coord.x != u1 || corners[2]->tex_coord.y != v1)
+      return std::nullopt;
+    // texel edges, which must be whole to sample as a copy does
+    auto const texel = [](float const t, int const size, int& at) {
+      auto const v = t * static_cast<float>(size);
+      if(!(std::abs(v - std::round(v)) < 1e-3f)) return false;
+      at = static_cast<int>(std::round(v));
+      return 0 <= at && at <= size;
+    };
+    int sx0, sy0, sx1, sy1;
+    if(!texel(u0, texture->w, sx0) || !texel(u1, texture->w, sx1)
+       || !texel(v0, texture->h, sy0) || !texel(v1, texture->h, sy1)
+       || sx0 >= sx1 || sy0 >= sy1)
+      return std::nullopt;
+    quad.src = {sx0, sy0, sx1 - sx0, sy1 - sy0};
+    // only unscaled, a copy samples the texels the triangles would
+    auto const unscaled = [](float const span, int const pixels, int const n) {
+      return std::abs(span - static_cast<float>(n)) < 1e-3f && pixels == n;
+    };
+    if(!unscaled(x1 - x0, quad.dst.w, quad.src.w)
+       || !unscaled(y1 - y0, quad.dst.h, quad.src.h))
+      return std::nullopt;
+    return quad;
+  }
+
+  static MayError<void> check_source(Surface* const source) {
+    SDLRAII_COLD_IF(source == nullptr || source->format == nullptr
+                    || source->format->format != SDL_PIXELFORMAT_ARGB8888)
+      return sdl::Error{"Compositor: source must be ARGB8888"};
+    // RLE surfaces have no pixels to read until locked
+    SDLRAII_COLD_IF(SDL_MUSTLOCK(source))
+      return sdl::Error{"Compositor: source must not need locking"};
+    return {};
+  }
+
+  /**
+   * ~IntersectRect~ without the call into SDL, which costs more than
+   * drawing the one-pixel commands ~points~ and ~lines~ record.
+   */
+  static std::optional<Rect> overlap(Rect const a, Rect const b) noexcept {
+    auto const x0 = std::max(a.x, b.x), y0 = std::max(a.y, b.y);
+    auto const x1 = std::min(a.x + a.w, b.x + b.w);
+    auto const y1 = std::min(a.y + a.h, b.y + b.h);
+    if(x0 >= x1 || y0 >= y1) return std::nullopt;
+    return Rect{x0, y0, x1 - x0, y1 - y0};
+  }
+
+  void bin(Rect const clip, int const cols, std::size_t const tiles) {
+    if(bins_.size() < tiles) bins_.resize(tiles);
+    for(std::size_t t = 0; t < tiles; ++t) bins_[t].clear();
+    for(std::size_t i = 0; i < commands_.size(); ++i) {
+      auto const area = overlap(commands_[i].bounds, clip);
+      if(!area) continue;
+      auto const c0 = (area->x - clip.x) / tile_size;
+      auto const c1 = (area->x + area->w - 1 - clip.x) / tile_size;
+      auto const r0 = (area->y - clip.y) / tile_size;
+      auto const r1 = (area->y + area->h - 1 - clip.y) / tile_size;
+      for(auto r = r0; r <= r1; ++r)
+        for(auto c = c0; c <= c1; ++c) {
+          bins_[static_cast<std::size_t>(r * cols + c)].push_back(
+              static_cast<Uint32>(i));
+          ++stats_.binned;
+        }
+    }
+  }
+
+  void draw(Surface* const target, Rect const tile, Command const& cmd) const {
+    auto const area = overlap(cmd.bounds, tile);
+    if(!area) return;
+    impl::with_blend_mode(cmd.mode, [&](auto const mode) {
+      constexpr auto m = decltype(mode)::value;
+      switch(cmd.type) {
+        case kind::fill: draw_fill<m>(target, *area, cmd.color); break;
+        case kind::copy: draw_copy<m>(target, *area, cmd); break;
+        case kind::triangle: draw_triangle<m>(target, *area, cmd); break;
+        case kind::line: draw_line<m>(target, *area, cmd); break;
+      }
+    });
+  }
+
+  /**
+   * Blended fills go through ~BlendBlit~'s SIMD rows as white modulated by
+   * ~c~, which takes SDL's general rule, as its own fills do.
+   */
+  template<BlendMode::type mode>
+  static void
+      draw_fill(Surface* const target, Rect const area, Uint32 const c) {
+    static constexpr auto white = [] {
+      std::array<Uint32, tile_size> row;
+      row.fill(0xffffffff);
+      return row;
+    }();
+    auto const opaque = mode == BlendMode::none
+                     || (mode == BlendMode::blend && c >> 24 == 255);
+    for(auto y = area.y; y < area.y + area.h; ++y) {
+      auto* const row = impl::pixel_row(target, y) + area.x;
+      if(opaque)
+        std::fill(row, row + area.w, c);
+      else
+        impl::blit_row<mode>(
+            white.data(), row, static_cast<std::size_t>(area.w), {c, false});
+    }
+  }
+
+  /**
+   * Unscaled copies go through ~BlendBlit~'s SIMD rows; scaled ones sample
+   * the nearest texel to each pixel centre, in 16.16 fixed point along rows,
+   * into a scratch row that is then blitted the same way.
+   */
+  template<BlendMode::type mode>
+  static void
+      draw_copy(Surface* const target, Rect const area, Command const& cmd) {
+    auto const& src = cmd.src;
+    auto const& dst = cmd.bounds;
+    if(src.w == dst.w && src.h == dst.h) {
+      impl::BlitRow const row{cmd.color, false};
+      for(auto y = area.y; y < area.y + area.h; ++y)
+        impl::blit_row<mode>(
+            impl::pixel_row(cmd.source, src.y + y - dst.y) + src.x + area.x
+                - dst.x,
+            impl::pixel_row(target, y) + area.x,
+            static_cast<std::size_t>(area.w),
+            row);
+      return;
+    }
+    impl::BlitRow const blit{cmd.color, false};
+    std::array<Uint32, tile_size> texels;
+    auto const step = (Sint64{src.w} << 16) / dst.w;
+    auto const x0 =
+        ((Sint64{area.x - dst.x} * 2 + 1) * src.w << 16) / (2 * dst.w);
+    for(auto y = area.y; y < area.y + area.h; ++y) {
+      auto const sy = src.y + static_cast<int>(
+          (Sint64{y - dst.y} * 2 + 1) * src.h / (2 * dst.h));
+      auto const* const in = impl::pixel_row(cmd.source, sy) + src.x;
+      auto* const out = impl::pixel_row(target, y) + area.x;
+      auto sx = x0;
+      for(int x = 0; x < area.w; ++x, sx += step) texels[x] = in[sx >> 16];
+      impl::blit_row<mode>(
+          texels.data(), out, static_cast<std::size_t>(area.w), blit);
+    }
+  }
+
+  template<BlendMode::type mode>
+  void draw_triangle(Surface* const target,
+                     Rect const area,
+                     Command const& cmd) const {
+    auto const& [a0, b0, c0] = triangles_[cmd.index];
+    auto const* a = &a0;
+    auto const* b = &b0;
+    auto const* c = &c0;
+    auto const edge = [](SDL_FPoint const p, SDL_FPoint const q, float x,
+                         float y) {
+      return (q.x - p.x) * (y - p.y) - (q.y - p.y) * (x - p.x);
+    };
+    auto area2 = edge(a->position, b->position, c->position.x, c->position.y);
+    if(area2 == 0 || !std::isfinite(area2)) return;
+    if(area2 < 0) {
+      std::swap(b, c);
+      area2 = -area2;
+    }
+    // top-left rule: pixels exactly on an edge belong to top and left edges
+    auto const owns = [](SDL_FPoint const p, SDL_FPoint const q) {
+      auto const dy = q.y - p.y;
+      return dy < 0 || (dy == 0 && q.x > p.x);
+    };
+    std::array<SDL_FPoint const*, 3> const from{
+        &b->position, &c->position, &a->position};
+    std::array<SDL_FPoint const*, 3> const to{
+        &c->position, &a->position, &b->position};
+    std::array<bool, 3> own;
+    for(int k = 0; k < 3; ++k) own[k] = owns(*from[k], *to[k]);
+    auto const inv = 1 / area2;
+    auto* const tex = cmd.source;
+    auto const color = [](SDL_Color const k) {
+      return std::array<float, 4>{static_cast<float>(k.r),
+                                  static_cast<float>(k.g),
+                                  static_cast<float>(k.b),
+                                  static_cast<float>(k.a)};
+    };
+    auto const ca = color(a->color), cb = color(b->color), cc = color(c->color);
+    for(auto y = area.y; y < area.y + area.h; ++y) {
+      auto const py = static_cast<float>(y) + 0.5f;
+      auto* const out = impl::pixel_row(target, y);
+      for(auto x = area.x; x < area.x + area.w; ++x) {
+        auto const px = static_cast<float>(x) + 0.5f;
+        std::array<float, 3> w;
+        auto inside = true;
+        for(int k = 0; k < 3; ++k) {
+          w[k] = edge(*from[k], *to[k], px, py);
+          inside = inside && (w[k] > 0 || (w[k] == 0 && own[k]));
+        }
+        if(!inside) continue;
+        // w[0] weighs a, w[1] b and w[2] c
+        auto const l0 = w[0] * inv, l1 = w[1] * inv, l2 = w[2] * inv;
+        auto const mix = [&](int const ch) {
+          auto const v = l0 * ca[ch] + l1 * cb[ch] + l2 * cc[ch];
+          return static_cast<Uint32>(std::clamp(v + 0.5f, 0.0f, 255.0f));
+        };
+        auto s = impl::pack_argb(mix(3), mix(0), mix(1), mix(2));
+        if(tex != nullptr) {
+          auto const u = l0 * a->tex_coord.x + l1 * b->tex_coord.x
+                         + l2 * c->tex_coord.x;
+          auto const v = l0 * a->tex_coord.y + l1 * b->tex_coord.y
+                         + l2 * c->tex_coord.y;
+          auto const tx = std::clamp(
+              static_cast<int>(u * static_cast<float>(tex->w)), 0, tex->w - 1);
+          auto const ty = std::clamp(
+              static_cast<int>(v * static_cast<float>(tex->h)), 0, tex->h - 1);
+          s = impl::modulate_argb(impl::pixel_row(tex, ty)[tx], s);
+        }
+        out[x] = impl::compose<mode>(out[x], s);
+      }
+    }
+  }
+
+  /**
+   * A DDA along the longer axis, rounding the other coordinate to nearest.
+   * Only the steps whose longer-axis coordinate lies in ~area~ are walked, so
+   * a long line costs each tile it crosses no more than the tile's width.
+   */
+  template<BlendMode::type mode>
+  void draw_line(Surface* const target,
+                 Rect const area,
+                 Command const& cmd) const {
+    auto const& [from, to, last] = lines_[cmd.index];
+    auto const dx      = Sint64{to.x} - from.x;
+    auto const dy      = Sint64{to.y} - from.y;
+    auto const steps   = std::max(std::abs(dx), std::abs(dy));
+    auto const x_major = std::abs(dx) >= std::abs(dy);
+    auto const start   = Sint64{x_major ? from.x : from.y};
+    auto const delta   = x_major ? dx : dy;
+    auto const lo      = Sint64{x_major ? area.x : area.y};
+    auto const hi      = lo + (x_major ? area.w : area.h) - 1;
+    Sint64 first = 0, stop = last ? steps : steps - 1;
+    if(delta > 0) {
+      first = std::max(first, lo - start);
+      stop  = std::min(stop, hi - start);
+    } else if(delta < 0) {
+      first = std::max(first, start - hi);
+      stop  = std::min(stop, start - lo);
+    }
+    // n / steps rounded half up, for either sign of n
+    auto const scaled = [steps](Sint64 const n) {
+      if(steps == 0) return Sint64{0};
+      auto const num = 2 * n + steps;
+      return num >= 0 ? num / (2 * steps)
+                      : -((-num + 2 * steps - 1) / (2 * steps));
+    };
+    for(auto i = first; i <= stop; ++i) {
+      auto const x = static_cast<int>(from.x + scaled(dx * i));
+      auto const y = static_cast<int>(from.y + scaled(dy * i));
+      if(x < area.x || x >= area.x + area.w || y < area.y
+         || y >= area.y + area.h)
+        continue;
+      auto* const out = impl::pixel_row(target, y) + x;
+      *out            = impl::compose<mode>(*out, cmd.color);
+    }
+  }
+
+  JobSystem* jobs_;
+  std::vector<Command> commands_;
+  std::vector<std::array<Vertex, 3>> triangles_;
+  std::vector<Line> lines_;
+  std::vector<std::vector<Uint32>> bins_; // command indices per tile
+  std::vector<Uint32> busy_;              // tiles with commands
+  Stats stats_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_COMPOSITOR_INCLUDE_GUARD
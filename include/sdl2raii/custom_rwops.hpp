@@ -0,0 +1,443 @@
+#ifndef SDLRAII_CUSTOM_RWOPS_INCLUDE_GUARD
+#define SDLRAII_CUSTOM_RWOPS_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+namespace impl {
+
+/**
+ * The ~SDL_RWops~ function table for ~T~. Each entry calls the member of the
+ * same name if ~T~ has one; missing members act like an ~RWops~ that cannot
+ * do that operation.
+ */
+template<class T>
+struct rwops_thunks {
+  static T& self(SDL_RWops* const ctx) noexcept {
+    return *static_cast<T*>(ctx->hidden.unknown.data1);
+  }
+
+  static Sint64 size(SDL_RWops* const ctx) noexcept {
+    if constexpr(requires(T& t) { t.size(); })
+      return static_cast<Sint64>(self(ctx).size());
+    else
+      return -1;
+  }
+  static Sint64 seek(SDL_RWops* const ctx,
+                     Sint64 const offset,
+                     int const whence) noexcept {
+    if constexpr(requires(T& t) { t.seek(offset, whence); })
+      return static_cast<Sint64>(self(ctx).seek(offset, whence));
+    else
+      return SDL_SetError("RWops: stream is not seekable");
+  }
+  static std::size_t read(SDL_RWops* const ctx,
+                          void* const dst,
+                          std::size_t const size,
+                          std::size_t const n) noexcept {
+    if constexpr(requires(T& t) { t.read(dst, size, n); }) {
+      return static_cast<std::size_t>(self(ctx).read(dst, size, n));
+    } else {
+      SDL_SetError("RWops: stream is not readable");
+      return 0;
+    }
+  }
+  static std::size_t write(SDL_RWops* const ctx,
+                           void const* const src,
+                           std::size_t const size,
+                           std::size_t const n) noexcept {
+    if constexpr(requires(T& t) { t.write(src, size, n); }) {
+      return static_cast<std::size_t>(self(ctx).write(src, size, n));
+    } else {
+      SDL_SetError("RWops: stream is not writable");
+      return 0;
+    }
+  }
+  static int close(SDL_RWops* const ctx) noexcept {
+    int status = 0;
+    {
+      std::unique_ptr<T> const owned{&self(ctx)};
+      if constexpr(requires(T& t) {
+                     { t.close() } -> std::convertible_to<int>;
+                   })
+        status = owned->close();
+      else if constexpr(requires(T& t) { t.close(); })
+        owned->close();
+    }
+    SDL_FreeRW(ctx);
+    return status;
+  }
+};
+
+} // namespace impl
+
+/**
+ * Anything with some of
+ *
+ * #+begin_src c++
+ * Sint64 size();
+ * Sint64 seek(Sint64 offset, int whence);
+ * std::size_t read(void* dst, std::size_t size, std::size_t n);
+ * std::size_t write(void const* src, std::size_t size, std::size_t n);
+ * int close(); // or void
+ * #+end_src
+ *
+ * with the meanings of the ~SDL_RWops~ members of the same names. ~read~ or
+ * ~write~ is required; the rest are optional.
+ */
+template<class T>
+concept RWopsObject =
+    std::is_move_constructible_v<T>
+    && (requires(T& t, void* dst, std::size_t n) { t.read(dst, n, n); }
+        || requires(T& t, void const* src, std::size_t n) {
+             t.write(src, n, n);
+           });
+
+/**
+ * An ~RWops~ that owns ~object~ and forwards to it, through a function table
+ * generated for ~T~. ~SDL_RWclose~ calls ~object.close()~ if there is one and
+ * then destroys it. The members are called from C, so they must not throw.
+ */
+template<RWopsObject T>
+inline MayError<UniqueRWops> RWFromObject(T object) {
+  auto owned     = std::make_unique<T>(std::move(object));
+  auto* const rw = SDL_AllocRW();
+  SDLRAII_COLD_IF(rw == nullptr)
+    return sdl::GetError();
+  using thunks             = impl::rwops_thunks<T>;
+  rw->size                 = &thunks::size;
+  rw->seek                 = &thunks::seek;
+  rw->read                 = &thunks::read;
+  rw->write                = &thunks::write;
+  rw->close                = &thunks::close;
+  rw->type                 = SDL_RWOPS_UNKNOWN;
+  rw->hidden.unknown.data1 = owned.release();
+  return UniqueRWops{rw};
+}
+
+namespace impl {
+/** Shared ~seek~ arithmetic for streams over a byte range. */
+inline Sint64 seek_in(Sint64 const pos,
+                      Sint64 const size,
+                      Sint64 const offset,
+                      int const whence) noexcept {
+  Sint64 base;
+  switch(whence) {
+    case RW_SEEK_SET: base = 0; break;
+    case RW_SEEK_CUR: base = pos; break;
+    case RW_SEEK_END: base = size; break;
+    default: return SDL_SetError("RWops: unknown seek origin");
+  }
+  SDLRAII_COLD_IF(base + offset < 0)
+    return SDL_SetError("RWops: seek before start");
+  return base + offset;
+}
+} // namespace impl
+
+/**
+ * A stream over a span, like ~RWFromMem~ and ~RWFromConstMem~ but without
+ * their ~int~ size limit. Writing past the end writes what fits.
+ */
+template<class Byte>
+requires std::is_same_v<std::remove_const_t<Byte>, Uint8>
+class SpanStream {
+ public:
+  explicit SpanStream(std::span<Byte> const bytes) noexcept : bytes_{bytes} {}
+
+  Sint64 size() const noexcept { return static_cast<Sint64>(bytes_.size()); }
+  Sint64 seek(Sint64 const offset, int const whence) noexcept {
+    auto const at =
+        impl::seek_in(static_cast<Sint64>(pos_), size(), offset, whence);
+    if(at >= 0) pos_ = static_cast<std::size_t>(std::min(at, size()));
+    return at < 0 ? at : static_cast<Sint64>(pos_);
+  }
+  std::size_t read(void* const dst,
+                   std::size_t const size,
+                   std::size_t const n) noexcept {
+    if(size == 0) return 0;
+    auto const k = std::min(n, (bytes_.size() - pos_) / size);
+    if(k) std::memcpy(dst, bytes_.data() + pos_, k * size);
+    pos_ += k * size;
+    return k;
+  }
+  std::size_t write(void const* const src,
+                    std::size_t const size,
+                    std::size_t const n) noexcept
+  requires(!std::is_const_v<Byte>)
+  {
+    if(size == 0) return 0;
+    auto const k = std::min(n, (bytes_.size() - pos_) / size);
+    if(k) std::memcpy(bytes_.data() + pos_, src, k * size);
+    pos_ += k * size;
+    return k;
+  }
+
+ private:
+  std::span<Byte> bytes_;
+  std::size_t pos_ = 0;
+};
+
+inline MayError<UniqueRWops> RWFromSpan(std::span<Uint8> const bytes) {
+  return RWFromObject(SpanStream<Uint8>{bytes});
+}
+inline MayError<UniqueRWops> RWFromSpan(std::span<Uint8 const> const bytes) {
+  return RWFromObject(SpanStream<Uint8 const>{bytes});
+}
+
+/**
+ * A stream over a ~std::vector~ that grows as it is written, for building a
+ * file in memory. Seeking past the end and writing fills the gap with zeros.
+ * The vector is borrowed and must outlive the stream.
+ */
+class VectorStream {
+ public:
+  explicit VectorStream(std::vector<Uint8>& bytes) noexcept : bytes_{&bytes} {}
+
+  Sint64 size() const noexcept { return static_cast<Sint64>(bytes_->size()); }
+  Sint64 seek(Sint64 const offset, int const whence) noexcept {
+    auto const at =
+        impl::seek_in(static_cast<Sint64>(pos_), size(), offset, whence);
+    if(at >= 0) pos_ = static_cast<std::size_t>(at);
+    return at;
+  }
+  std::size_t read(void* const dst,
+                   std::size_t const size,
+                   std::size_t const n) noexcept {
+    if(size == 0 || pos_ >= bytes_->size()) return 0;
+    auto const k = std::min(n, (bytes_->size() - pos_) / size);
+    if(k) std::memcpy(dst, bytes_->data() + pos_, k * size);
+    pos_ += k * size;
+    return k;
+  }
+  std::size_t write(void const* const src,
+                    std::size_t const size,
+                    std::size_t const n) noexcept {
+    auto const want = size * n;
+    if(want == 0) return 0;
+    // this runs inside SDL's C call, so growth failures become SDL errors
+    try {
+      if(bytes_->size() < pos_ + want) bytes_->resize(pos_ + want);
+    } catch(std::bad_alloc const&) {
+      SDL_OutOfMemory();
+      return 0;
+    } catch(std::length_error const&) {
+      SDL_OutOfMemory();
+      return 0;
+    }
+    std::memcpy(bytes_->data() + pos_, src, want);
+    pos_ += want;
+    return n;
+  }
+
+ private:
+  std::vector<Uint8>* bytes_;
+  std::size_t pos_ = 0;
+};
+
+inline MayError<UniqueRWops> RWFromVector(std::vector<Uint8>& bytes) {
+  return RWFromObject(VectorStream{bytes});
+}
+
+/**
+ * A lock-free single-producer single-consumer byte ring. One thread writes
+ * and one thread reads; neither takes a lock, and each copies straight into
+ * or out of the ring.
+ *
+ * The ~try_~ calls never block. ~write~ blocks while the ring is full and
+ * ~read~ while it is empty, using ~std::atomic::wait~, until the whole request
+ * is done or the other side closes. Closing the writer is end of file for the
+ * reader; closing the reader makes further writes fail.
+ */
+class ByteRing {
+ public:
+  /** ~capacity~ is rounded up to a power of two. */
+  explicit ByteRing(std::size_t const capacity = 64 * 1024)
+      : capacity_{std::bit_ceil(std::max<std::size_t>(capacity, 16))},
+        buffer_{new Uint8[capacity_]} {}
+  ByteRing(ByteRing const&) = delete;
+  ByteRing& operator=(ByteRing const&) = delete;
+
+  std::size_t capacity() const noexcept { return capacity_; }
+
+  /** Producer only. Returns the number of bytes written. */
+  std::size_t try_write(void const* const src, std::size_t const n) noexcept {
+    auto const head = head_.load(std::memory_order_relaxed);
+    auto const tail = tail_.load(std::memory_order_acquire);
+    auto const k    = std::min(n, capacity_ - (head - tail));
+    if(k == 0) return 0;
+    copy_in(head, static_cast<Uint8 const*>(src), k);
+    head_.store(head + k, std::memory_order_release);
+    wake(produced_);
+    return k;
+  }
+  /** Consumer only. Returns the number of bytes read. */
+  std::size_t try_read(void* const dst, std::size_t const n) noexcept {
+    auto const tail = tail_.load(std::memory_order_relaxed);
+    auto const head = head_.load(std::memory_order_acquire);
+    auto const k    = std::min(n, head - tail);
+    if(k == 0) return 0;
+    copy_out(tail, static_cast<Uint8*>(dst), k);
+    tail_.store(tail + k, std::memory_order_release);
+    wake(consumed_);
+    return k;
+  }
+
+  /** Producer only. Short only if the reader closed. */
+  std::size_t write(void const* const src, std::size_t const n) noexcept {
+    auto const* const bytes = static_cast<Uint8 const*>(src);
+    std::size_t done        = 0;
+    while(done < n) {
+      auto const seen = consumed_.load(std::memory_order_acquire);
+      if(reader_closed_.load(std::memory_order_acquire)) break;
+      auto const k = try_write(bytes + done, n - done);
+      done += k;
+      if(k == 0) consumed_.wait(seen, std::memory_order_acquire);
+    }
+    return done;
+  }
+  /** Consumer only. Short only at end of file. */
+  std::size_t read(void* const dst, std::size_t const n) noexcept {
+    auto* const bytes = static_cast<Uint8*>(dst);
+    std::size_t done  = 0;
+    while(done < n) {
+      auto const seen   = produced_.load(std::memory_order_acquire);
+      auto const closed = writer_closed_.load(std::memory_order_acquire);
+      auto const k      = try_read(bytes + done, n - done);
+      done += k;
+      if(k == 0) {
+        if(closed) break;
+        produced_.wait(seen, std::memory_order_acquire);
+      }
+    }
+    return done;
+  }
+
+  void close_writer() noexcept {
+    writer_closed_.store(true, std::memory_order_release);
+    wake(produced_);
+  }
+  void close_reader() noexcept {
+    reader_closed_.store(true, std::memory_order_release);
+    wake(consumed_);
+  }
+
+ private:
+  static void wake(std::atomic<Uint32>& events) noexcept {
+    events.fetch_add(1, std::memory_order_release);
+    events.notify_one();
+  }
+
+  void copy_in(std::size_t const at,
+               Uint8 const* const src,
+               std::size_t const n) noexcept {
+    auto const i     = at & (capacity_ - 1);
+    auto const first = std::min(n, capacity_ - i);
+    std::memcpy(buffer_.get() + i, src, first);
+    std::memcpy(buffer_.get(), src + first, n - first);
+  }
+  void copy_out(std::size_t const at,
+                Uint8* const dst,
+                std::size_t const n) const noexcept {
+    auto const i     = at & (capacity_ - 1);
+    auto const first = std::min(n, capacity_ - i);
+    std::memcpy(dst, buffer_.get() + i, first);
+    std::memcpy(dst + first, buffer_.get(), n - first);
+  }
+
+  std::size_t const capacity_;
+  std::unique_ptr<Uint8[]> const buffer_;
+  // the producer and consumer each write one line
+  alignas(64) std::atomic<std::size_t> head_{0};
+  std::atomic<Uint32> produced_{0};
+  std::atomic<bool> writer_closed_{false};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::atomic<Uint32> consumed_{0};
+  std::atomic<bool> reader_closed_{false};
+};
+
+namespace impl {
+class RingReader {
+ public:
+  explicit RingReader(std::shared_ptr<ByteRing> ring) noexcept
+      : ring_{std::move(ring)} {}
+  RingReader(RingReader&&) noexcept = default;
+  ~RingReader() {
+    if(ring_) ring_->close_reader();
+  }
+
+  std::size_t read(void* const dst,
+                   std::size_t const size,
+                   std::size_t const n) noexcept {
+    if(size == 0) return 0;
+    return ring_->read(dst, size * n) / size;
+  }
+
+ private:
+  std::shared_ptr<ByteRing> ring_;
+};
+
+class RingWriter {
+ public:
+  explicit RingWriter(std::shared_ptr<ByteRing> ring) noexcept
+      : ring_{std::move(ring)} {}
+  RingWriter(RingWriter&&) noexcept = default;
+  ~RingWriter() {
+    if(ring_) ring_->close_writer();
+  }
+
+  std::size_t write(void const* const src,
+                    std::size_t const size,
+                    std::size_t const n) noexcept {
+    if(size == 0) return 0;
+    return ring_->write(src, size * n) / size;
+  }
+
+ private:
+  std::shared_ptr<ByteRing> ring_;
+};
+} // namespace impl
+
+/** The two ends of a ~ByteRing~, as streams. */
+struct RWopsPipe {
+  UniqueRWops reader;
+  UniqueRWops writer;
+};
+
+/**
+ * A pipe between two threads: bytes written to ~writer~ come out of ~reader~,
+ * through a ~ByteRing~ of ~capacity~ bytes. Closing the writer is end of file
+ * for the reader, so a loader such as ~LoadBMP_RW~ can consume data while
+ * another thread is still producing it. Neither end can seek.
+ */
+inline MayError<RWopsPipe> CreateRWopsPipe(std::size_t const capacity =
+                                               64 * 1024) {
+  auto const ring = std::make_shared<ByteRing>(capacity);
+  auto reader     = RWFromObject(impl::RingReader{ring});
+  SDLRAII_BAIL_ERROR(reader);
+  auto writer = RWFromObject(impl::RingWriter{ring});
+  SDLRAII_BAIL_ERROR(writer);
+  return RWopsPipe{std::move(reader.get()), std::move(writer.get())};
+}
+
+} // namespace sdl
+
+#endif // SDLRAII_CUSTOM_RWOPS_INCLUDE_GUARD
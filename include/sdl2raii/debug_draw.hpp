@@ -0,0 +1,303 @@
+#ifndef SDLRAII_DEBUG_DRAW_INCLUDE_GUARD
+#define SDLRAII_DEBUG_DRAW_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "compositor.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace sdl {
+
+/**
+ * Collects a frame's debug drawing and draws it grouped by color and kind.
+ *
+ * Drawing calls made between ~SetRenderDrawColor~s one primitive at a time
+ * keep SDL from batching them. Here, calls only append to per-color buckets;
+ * ~flush~ then draws all filled rectangles, then outlines, then lines, then
+ * points, with one plural call per color: ~RenderFillRectsF~,
+ * ~RenderDrawRectsF~, ~RenderDrawPointsF~, and ~RenderDrawLinesF~ per line
+ * strip. SDL has no call for unconnected segments, so separate ~line~s go in
+ * as strips wherever one starts where the last ended, and otherwise as
+ * two-point strips that SDL's own batching merges, the color no longer
+ * changing in between.
+ *
+ * ~flush~ into a ~Compositor~ records the same passes there instead, as
+ * fills, outlines, line strips and points.
+ *
+ * Buckets are cleared, not freed, by ~flush~, so after the first few frames
+ * nothing allocates. While disabled, every call returns at once.
+ */
+class DebugDraw {
+ public:
+  bool enabled() const noexcept { return enabled_; }
+  void set_enabled(bool const on) noexcept { enabled_ = on; }
+
+  void point(FPoint const p, rgba const color) {
+    if(!enabled_) return;
+    bucket(color).points.push_back(p);
+  }
+  void line(FPoint const a, FPoint const b, rgba const color) {
+    if(!enabled_) return;
+    auto& segments = bucket(color).segments;
+    segments.push_back(a);
+    segments.push_back(b);
+  }
+  /** Connected lines through ~points~, back to the first if ~closed~. */
+  void lines(std::span<FPoint const> const points,
+             rgba const color,
+             bool const closed = false) {
+    if(!enabled_ || points.size() < 2) return;
+    auto& b = bucket(color);
+    b.strips.insert(b.strips.end(), points.begin(), points.end());
+    if(closed) b.strips.push_back(points.front());
+    b.strip_ends.push_back(b.strips.size());
+  }
+  void rect(FRect const r, rgba const color) {
+    if(!enabled_) return;
+    bucket(color).rects.push_back(r);
+  }
+  void fill_rect(FRect const r, rgba const color) {
+    if(!enabled_) return;
+    bucket(color).fills.push_back(r);
+  }
+  /** An outline of ~segments~ lines. */
+  void circle(FPoint const center,
+              float const r,
+              rgba const color,
+              int const segments = 32) {
+    if(!enabled_ || segments < 3) return;
+    auto& b         = bucket(color);
+    auto const step = 2 * std::numbers::pi_v<float> / segments;
+    for(int k = 0; k <= segments; ++k) {
+      auto const a = step * static_cast<float>(k % segments);
+      b.strips.push_back({center.x + r * std::cos(a),
+                          center.y + r * std::sin(a)});
+    }
+    b.strip_ends.push_back(b.strips.size());
+  }
+
+  /**
+   * Draw everything collected and start the next frame. The draw color and
+   * blend mode are put back afterwards; shapes are blended, so translucent
+   * colors work.
+   */
+  MayError<void> flush(Renderer* const renderer) {
+    if(used_.empty()) return {};
+    auto const color = GetRenderDrawColor(renderer);
+    auto const blend = GetRenderDrawBlendMode(renderer);
+    SDLRAII_BAIL_ERROR(blend);
+    auto const blending = SetRenderDrawBlendMode(renderer, BlendMode::blend);
+    SDLRAII_BAIL_ERROR(blending);
+    calls_            = 0;
+    auto const result = draw(renderer);
+    static_cast<void>(SetRenderDrawBlendMode(renderer, blend.get()));
+    static_cast<void>(SetRenderDrawColor(renderer, color));
+    clear();
+    return result;
+  }
+
+  /** As above, into ~compositor~, which draws it on its next ~render~. */
+  MayError<void> flush(Compositor& compositor) {
+    calls_ = 0;
+    for(auto const kind : {pass::fills, pass::rects, pass::lines, pass::points})
+      for(auto const i : used_) {
+        auto const& b = buckets_[i];
+        switch(kind) {
+          case pass::fills:
+            for(auto const& r : b.fills)
+              if(auto const px = pixels(r)) compositor.fill(*px, b.color);
+            break;
+          case pass::rects:
+            for(auto const& r : b.rects)
+              if(auto const px = pixels(r)) compositor.outline(*px, b.color);
+            break;
+          case pass::lines:
+            each_strip(b, [&](std::span<FPoint const> const strip) {
+              compositor.lines(strip, b.color);
+              return MayError<void>{};
+            });
+            break;
+          case pass::points: compositor.points(b.points, b.color); break;
+        }
+      }
+    clear();
+    return {};
+  }
+
+  /** Drop what was collected without drawing it. */
+  void clear() noexcept {
+    for(auto const i : used_) {
+      auto& b = buckets_[i];
+      b.points.clear();
+      b.segments.clear();
+      b.strips.clear();
+      b.strip_ends.clear();
+      b.rects.clear();
+      b.fills.clear();
+    }
+    used_.clear();
+    last_ = none;
+  }
+
+  /** Draw calls the last ~flush~ made; none into a ~Compositor~. */
+  std::size_t calls() const noexcept { return calls_; }
+
+ private:
+  static constexpr auto none = static_cast<std::size_t>(-1);
+
+  struct Bucket {
+    rgba color;
+    std::vector<FPoint> points;
+    std::vector<FPoint> segments; // in pairs
+    std::vector<FPoint> strips;
+    std::vector<std::size_t> strip_ends;
+    std::vector<FRect> rects;
+    std::vector<FRect> fills;
+  };
+
+  static Uint32 key(rgba const c) noexcept {
+    return Uint32{c.r} << 24 | Uint32{c.g} << 16 | Uint32{c.b} << 8 | c.a;
+  }
+
+  Bucket& bucket(rgba const color) {
+    auto const k = key(color);
+    // overlays tend to draw runs of one color
+    if(last_ != none && key(buckets_[last_].color) == k)
+      return buckets_[last_];
+    auto [it, added] = index_.try_emplace(k, buckets_.size());
+    if(added) buckets_.push_back(Bucket{color, {}, {}, {}, {}, {}, {}});
+    auto& b = buckets_[it->second];
+    if(b.points.empty() && b.segments.empty() && b.strip_ends.empty()
+       && b.rects.empty() && b.fills.empty())
+      used_.push_back(it->second);
+    last_ = it->second;
+    return b;
+  }
+
+  enum class pass { fills, rects, lines, points };
+
+  MayError<void> draw(Renderer* const renderer) {
+    // back to front
+    for(auto const kind : {pass::fills, pass::rects, pass::lines, pass::points})
+      for(auto const i : used_) {
+        auto const& b = buckets_[i];
+        if(!has(b, kind)) continue;
+        auto const set = SetRenderDrawColor(renderer, b.color);
+        SDLRAII_BAIL_ERROR(set);
+        auto const drawn = draw(renderer, b, kind);
+        SDLRAII_BAIL_ERROR(drawn);
+      }
+    return {};
+  }
+
+  static bool has(Bucket const& b, pass const kind) noexcept {
+    switch(kind) {
+      case pass::fills: return !b.fills.empty();
+      case pass::rects: return !b.rects.empty();
+      case pass::lines: return !b.segments.empty() || !b.strip_ends.empty();
+      case pass::points: return !b.points.empty();
+    }
+    return false;
+  }
+
+  MayError<void>
+      draw(Renderer* const renderer, Bucket const& b, pass const kind) {
+    auto const count = [](auto const& v) { return static_cast<int>(v.size()); };
+    switch(kind) {
+      case pass::fills: {
+        ++calls_;
+        auto const drawn =
+            RenderFillRects(renderer, b.fills.data(), count(b.fills));
+        SDLRAII_BAIL_ERROR(drawn);
+        return {};
+      }
+      case pass::rects: {
+        ++calls_;
+        auto const drawn =
+            RenderDrawRects(renderer, b.rects.data(), count(b.rects));
+        SDLRAII_BAIL_ERROR(drawn);
+        return {};
+      }
+      case pass::points: {
+        ++calls_;
+        auto const drawn =
+            RenderDrawPoints(renderer, b.points.data(), count(b.points));
+        SDLRAII_BAIL_ERROR(drawn);
+        return {};
+      }
+      case pass::lines: break;
+    }
+    return each_strip(b, [&](std::span<FPoint const> const strip) {
+      ++calls_;
+      return RenderDrawLines(
+          renderer, strip.data(), static_cast<int>(strip.size()));
+    });
+  }
+
+  /**
+   * Calls ~fn~ on each line strip of ~b~: the strips as given, then the
+   * separate segments, chained wherever one starts where the last ended.
+   */
+  template<class Fn>
+  MayError<void> each_strip(Bucket const& b, Fn&& fn) {
+    std::size_t start = 0;
+    for(auto const end : b.strip_ends) {
+      auto const drawn =
+          fn(std::span<FPoint const>{b.strips}.subspan(start, end - start));
+      SDLRAII_BAIL_ERROR(drawn);
+      start = end;
+    }
+    chain_.clear();
+    auto const& s = b.segments;
+    for(std::size_t i = 0; i < s.size(); i += 2) {
+      if(!chain_.empty()
+         && (chain_.back().x != s[i].x || chain_.back().y != s[i].y)) {
+        auto const drawn = fn(std::span<FPoint const>{chain_});
+        SDLRAII_BAIL_ERROR(drawn);
+        chain_.clear();
+      }
+      if(chain_.empty()) chain_.push_back(s[i]);
+      chain_.push_back(s[i + 1]);
+    }
+    if(chain_.size() < 2) return {};
+    auto const drawn = fn(std::span<FPoint const>{chain_});
+    SDLRAII_BAIL_ERROR(drawn);
+    return {};
+  }
+
+  /** The pixels ~r~ covers, or none if it is off in the distance. */
+  static std::optional<Rect> pixels(FRect const r) noexcept {
+    auto const x0 = std::floor(r.x), y0 = std::floor(r.y);
+    auto const x1 = std::floor(r.x + r.w), y1 = std::floor(r.y + r.h);
+    // this also turns away NaN
+    for(auto const v : {x0, y0, x1, y1})
+      if(!(std::abs(v) < 1e7f)) return std::nullopt;
+    return Rect{static_cast<int>(x0),
+                static_cast<int>(y0),
+                static_cast<int>(x1 - x0),
+                static_cast<int>(y1 - y0)};
+  }
+
+  bool enabled_ = true;
+  std::vector<Bucket> buckets_;
+  std::unordered_map<Uint32, std::size_t> index_; // color to bucket
+  std::vector<std::size_t> used_;                 // buckets with something
+  std::size_t last_ = none; // a bucket in ~used_~
+  std::vector<FPoint> chain_;
+  std::size_t calls_ = 0;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_DEBUG_DRAW_INCLUDE_GUARD
@@ -0,0 +1,242 @@
+#ifndef SDLRAII_ENDIAN_SPAN_INCLUDE_GUARD
+#define SDLRAII_ENDIAN_SPAN_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "buffered_rwops.hpp"
+
+#include "compat_macros.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#  define SDLRAII_ENDIAN_AVX2 1
+#  include <immintrin.h>
+#elif defined(__SSSE3__)
+#  define SDLRAII_ENDIAN_SSSE3 1
+#  include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)                                     \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SDLRAII_ENDIAN_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+namespace sdl {
+namespace impl {
+
+template<class T, std::size_t N>
+concept word = std::is_integral_v<T> && sizeof(T) == N;
+
+inline constexpr bool host_little_endian = SDL_BYTEORDER == SDL_LIL_ENDIAN;
+
+#if defined(SDLRAII_ENDIAN_AVX2) || defined(SDLRAII_ENDIAN_SSSE3)
+template<std::size_t N>
+inline __m128i bswap_mask() noexcept {
+  if constexpr(N == 2)
+    return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  else if constexpr(N == 4)
+    return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  else
+    return _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+}
+#elif defined(SDLRAII_ENDIAN_SSE2)
+/** Without ~pshufb~: swap the bytes of each 16-bit lane, then the lanes. */
+template<std::size_t N>
+inline __m128i bswap_sse2(__m128i x) noexcept {
+  x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+  if constexpr(N == 4) {
+    x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+    x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+  } else if constexpr(N == 8) {
+    x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+    x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+  }
+  return x;
+}
+#endif
+
+/**
+ * Copy ~count~ ~N~-byte words from ~src~ to ~dst~, reversing the bytes of
+ * each. ~dst~ may equal ~src~.
+ */
+template<std::size_t N>
+inline void bswap_copy(Uint8* const dst,
+                       Uint8 const* const src,
+                       std::size_t const count) noexcept {
+  auto const bytes = count * N;
+  std::size_t i    = 0;
+#if defined(SDLRAII_ENDIAN_AVX2)
+  auto const mask = _mm256_broadcastsi128_si256(bswap_mask<N>());
+  for(; i + 32 <= bytes; i += 32) {
+    auto const x =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        _mm256_shuffle_epi8(x, mask));
+  }
+#elif defined(SDLRAII_ENDIAN_SSSE3)
+  auto const mask = bswap_mask<N>();
+  for(; i + 16 <= bytes; i += 16) {
+    auto const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_shuffle_epi8(x, mask));
+  }
+#elif defined(SDLRAII_ENDIAN_SSE2)
+  for(; i + 16 <= bytes; i += 16) {
+    auto const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bswap_sse2<N>(x));
+  }
+#endif
+  for(; i < bytes; i += N) {
+    if constexpr(N == 2) {
+      Uint16 v;
+      std::memcpy(&v, src + i, N);
+      v = SDL_Swap16(v);
+      std::memcpy(dst + i, &v, N);
+    } else if constexpr(N == 4) {
+      Uint32 v;
+      std::memcpy(&v, src + i, N);
+      v = SDL_Swap32(v);
+      std::memcpy(dst + i, &v, N);
+    } else {
+      Uint64 v;
+      std::memcpy(&v, src + i, N);
+      v = SDL_Swap64(v);
+      std::memcpy(dst + i, &v, N);
+    }
+  }
+}
+
+inline std::size_t stream_read(RWops* const src,
+                               void* const dst,
+                               std::size_t const size,
+                               std::size_t const n) noexcept {
+  return SDL_RWread(src, dst, size, n);
+}
+inline std::size_t stream_read(BufferedRWops& src,
+                               void* const dst,
+                               std::size_t const size,
+                               std::size_t const n) {
+  return src.read(dst, size, n);
+}
+inline std::size_t stream_write(RWops* const dst,
+                                void const* const src,
+                                std::size_t const size,
+                                std::size_t const n) noexcept {
+  return SDL_RWwrite(dst, src, size, n);
+}
+inline std::size_t stream_write(BufferedRWops& dst,
+                                void const* const src,
+                                std::size_t const size,
+                                std::size_t const n) {
+  return dst.write(src, size, n);
+}
+
+template<bool Little, std::size_t N, class Stream, class T>
+inline std::size_t read_words(Stream&& src, std::span<T> const out) {
+  auto const n = stream_read(src, out.data(), N, out.size());
+  if constexpr(Little != host_little_endian) {
+    auto* const p = reinterpret_cast<Uint8*>(out.data());
+    bswap_copy<N>(p, p, n);
+  }
+  return n;
+}
+
+/** Swapped writes go through a stack buffer so ~in~ is left alone. */
+template<bool Little, std::size_t N, class Stream, class T>
+inline std::size_t write_words(Stream&& dst, std::span<T> const in) {
+  if constexpr(Little == host_little_endian) {
+    return stream_write(dst, in.data(), N, in.size());
+  } else {
+    std::array<Uint8, 4096> chunk;
+    constexpr auto per_chunk = chunk.size() / N;
+    auto const* const src    = reinterpret_cast<Uint8 const*>(in.data());
+    std::size_t done         = 0;
+    while(done < in.size()) {
+      auto const n = std::min(per_chunk, in.size() - done);
+      bswap_copy<N>(chunk.data(), src + done * N, n);
+      auto const written = stream_write(dst, chunk.data(), N, n);
+      done += written;
+      if(written != n) break;
+    }
+    return done;
+  }
+}
+
+template<bool Little, std::size_t N, class T>
+inline std::size_t decode_words(std::span<Uint8 const> const bytes,
+                                std::span<T> const out) noexcept {
+  auto const n = std::min(bytes.size() / N, out.size());
+  auto* const p = reinterpret_cast<Uint8*>(out.data());
+  if(n == 0) return 0;
+  if constexpr(Little == host_little_endian)
+    std::memcpy(p, bytes.data(), n * N);
+  else
+    bswap_copy<N>(p, bytes.data(), n);
+  return n;
+}
+
+template<bool Little, std::size_t N, class T>
+inline std::size_t encode_words(std::span<T> const in,
+                                std::span<Uint8> const bytes) noexcept {
+  auto const n = std::min(bytes.size() / N, in.size());
+  auto const* const p = reinterpret_cast<Uint8 const*>(in.data());
+  if(n == 0) return 0;
+  if constexpr(Little == host_little_endian)
+    std::memcpy(bytes.data(), p, n * N);
+  else
+    bswap_copy<N>(bytes.data(), p, n);
+  return n;
+}
+} // namespace impl
+
+/**
+ * Bulk versions of ~ReadLE16~ through ~WriteBE64~, for arrays.
+ *
+ * ~ReadLE32(src, span)~ fills the span with one stream read and then, only if
+ * the host is big-endian, byte-swaps it in place with SIMD where available.
+ * Writers swap through a small buffer, leaving the input untouched. Each
+ * returns the number of elements transferred, like ~SDL_RWread~. Streams are
+ * ~RWops*~ or ~BufferedRWops&~.
+ *
+ * ~DecodeLE32(bytes, span)~ and ~EncodeLE32(span, bytes)~ do the same between
+ * memory buffers, e.g. a mapped file or a pack entry.
+ */
+#define SDLRAII_BULK_ENDIAN_(E, little, bits)                                  \
+  template<class Stream, impl::word<bits / 8> T>                               \
+  requires(!std::is_const_v<T>)                                                \
+  inline std::size_t Read##E##bits(Stream&& src, std::span<T> const out) {     \
+    return impl::read_words<little, bits / 8>(src, out);                       \
+  }                                                                            \
+  template<class Stream, impl::word<bits / 8> T>                               \
+  inline std::size_t Write##E##bits(Stream&& dst, std::span<T> const in) {     \
+    return impl::write_words<little, bits / 8>(dst, in);                       \
+  }                                                                            \
+  template<impl::word<bits / 8> T>                                             \
+  requires(!std::is_const_v<T>)                                                \
+  inline std::size_t Decode##E##bits(std::span<Uint8 const> const bytes,       \
+                                     std::span<T> const out) noexcept {        \
+    return impl::decode_words<little, bits / 8>(bytes, out);                   \
+  }                                                                            \
+  template<impl::word<bits / 8> T>                                             \
+  inline std::size_t Encode##E##bits(std::span<T> const in,                    \
+                                     std::span<Uint8> const bytes) noexcept {  \
+    return impl::encode_words<little, bits / 8>(in, bytes);                    \
+  }
+
+SDLRAII_BULK_ENDIAN_(LE, true, 16)
+SDLRAII_BULK_ENDIAN_(LE, true, 32)
+SDLRAII_BULK_ENDIAN_(LE, true, 64)
+SDLRAII_BULK_ENDIAN_(BE, false, 16)
+SDLRAII_BULK_ENDIAN_(BE, false, 32)
+SDLRAII_BULK_ENDIAN_(BE, false, 64)
+#undef SDLRAII_BULK_ENDIAN_
+
+} // namespace sdl
+
+#endif // SDLRAII_ENDIAN_SPAN_INCLUDE_GUARD
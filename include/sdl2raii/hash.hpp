@@ -0,0 +1,48 @@
+#ifndef SDLRAII_HASH_INCLUDE_GUARD
+#define SDLRAII_HASH_INCLUDE_GUARD
+
+#include <SDL2/SDL.h>
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace sdl {
+namespace impl {
+
+/** 64-bit FNV-1a, for hashing names. */
+constexpr Uint64 fnv1a(std::string_view const s) noexcept {
+  Uint64 h = 0xcbf29ce484222325;
+  for(auto const c : s) {
+    h ^= static_cast<Uint8>(c);
+    h *= 0x100000001b3;
+  }
+  return h;
+}
+
+inline constexpr auto crc32_table = [] {
+  std::array<Uint32, 256> table{};
+  for(Uint32 i = 0; i < 256; ++i) {
+    auto c = i;
+    for(int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+    table[i] = c;
+  }
+  return table;
+}();
+
+/**
+ * CRC-32 (the zlib polynomial), for checksumming data. Pass a previous result
+ * as ~crc~ to continue it over more bytes.
+ */
+constexpr Uint32 crc32(std::span<Uint8 const> const bytes,
+                       Uint32 const crc = 0) noexcept {
+  auto c = ~crc;
+  for(auto const b : bytes) c = crc32_table[(c ^ b) & 0xff] ^ (c >> 8);
+  return ~c;
+}
+
+} // namespace impl
+} // namespace sdl
+
+#endif // SDLRAII_HASH_INCLUDE_GUARD
@@ -0,0 +1,326 @@
+#ifndef SDLRAII_HEADLESS_INCLUDE_GUARD
+#define SDLRAII_HEADLESS_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)                                       \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SDLRAII_HEADLESS_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+namespace sdl {
+
+/**
+ * Tightly packed 32-bit pixels read back from a renderer. Readbacks reuse the
+ * storage, so keeping one buffer across frames allocates only when the size
+ * grows.
+ */
+struct PixelBuffer {
+  static constexpr Uint32 format = SDL_PIXELFORMAT_ARGB8888;
+
+  int w = 0, h = 0;
+  std::vector<Uint32> pixels;
+
+  int pitch() const noexcept { return w * 4; }
+  std::size_t size() const noexcept {
+    return static_cast<std::size_t>(w) * static_cast<std::size_t>(h);
+  }
+  void resize(int const width, int const height) {
+    w = width;
+    h = height;
+    pixels.resize(size());
+  }
+};
+
+/** Read ~area~ of the current render target into ~out~. */
+inline MayError<void> ReadPixels(Renderer* const renderer,
+                                 Rect const area,
+                                 PixelBuffer& out) {
+  out.resize(area.w, area.h);
+  auto const read = RenderReadPixels(
+      renderer, &area, PixelBuffer::format, out.pixels.data(), out.pitch());
+  SDLRAII_BAIL_ERROR(read);
+  return {};
+}
+
+/** Write ~pixels~ as a BMP, e.g. to record a golden image. */
+inline MayError<void> SavePixels(PixelBuffer const& pixels,
+                                 char const* const file) noexcept {
+  // SDL doesn't write through the pixel pointer when saving
+  auto surface = CreateRGBSurfaceWithFormatFrom(
+      const_cast<Uint32*>(pixels.pixels.data()),
+      pixels.w,
+      pixels.h,
+      32,
+      pixels.pitch(),
+      PixelBuffer::format);
+  SDLRAII_BAIL_ERROR(surface);
+  auto const saved = SaveBMP(surface.get().get(), file);
+  SDLRAII_BAIL_ERROR(saved);
+  return {};
+}
+
+/** Load an image saved by ~SavePixels~ into ~out~, reusing its storage. */
+inline MayError<void> LoadPixels(char const* const file, PixelBuffer& out) {
+  auto loaded = LoadBMP(file);
+  SDLRAII_BAIL_ERROR(loaded);
+  auto converted =
+      ConvertSurfaceFormat(loaded.get().get(), PixelBuffer::format, 0);
+  SDLRAII_BAIL_ERROR(converted);
+  auto const* const surface = converted.get().get();
+  out.resize(surface->w, surface->h);
+  for(int y = 0; y < surface->h; ++y)
+    std::memcpy(out.pixels.data() + static_cast<std::size_t>(y) * surface->w,
+                static_cast<Uint8 const*>(surface->pixels) + y * surface->pitch,
+                static_cast<std::size_t>(out.pitch()));
+  return {};
+}
+
+struct PixelDiff {
+  // pixels with some channel off by more than the tolerance
+  std::size_t mismatched = 0;
+  // the largest difference in any channel
+  Uint8 max_delta    = 0;
+  bool size_mismatch = false;
+
+  bool matches() const noexcept { return !size_mismatch && mismatched == 0; }
+};
+
+namespace impl {
+inline void diff_scalar(Uint32 const* const a,
+                        Uint32 const* const b,
+                        std::size_t const n,
+                        Uint8 const tolerance,
+                        PixelDiff& diff) noexcept {
+  for(std::size_t i = 0; i < n; ++i) {
+    bool over = false;
+    for(int shift = 0; shift < 32; shift += 8) {
+      auto const x     = static_cast<int>((a[i] >> shift) & 0xff);
+      auto const y     = static_cast<int>((b[i] >> shift) & 0xff);
+      auto const delta = static_cast<Uint8>(x > y ? x - y : y - x);
+      diff.max_delta   = std::max(diff.max_delta, delta);
+      over |= delta > tolerance;
+    }
+    diff.mismatched += over;
+  }
+}
+
+#ifdef SDLRAII_HEADLESS_SSE2
+/** Four pixels per step with saturating byte arithmetic. */
+inline std::size_t diff_sse2(Uint32 const* const a,
+                             Uint32 const* const b,
+                             std::size_t const n,
+                             Uint8 const tolerance,
+                             PixelDiff& diff) noexcept {
+  auto const limit = _mm_set1_epi8(static_cast<char>(tolerance));
+  auto const zero  = _mm_setzero_si128();
+  auto max         = zero;
+  std::size_t i    = 0;
+  for(; i + 4 <= n; i += 4) {
+    auto const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+    auto const y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+    auto const delta = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+    max              = _mm_max_epu8(max, delta);
+    // a pixel is within tolerance iff every byte saturates to zero
+    auto const within =
+        _mm_cmpeq_epi32(_mm_subs_epu8(delta, limit), zero);
+    auto const mask = _mm_movemask_ps(_mm_castsi128_ps(within));
+    diff.mismatched += 4 - static_cast<std::size_t>(std::popcount(
+                               static_cast<unsigned>(mask)));
+  }
+  alignas(16) std::array<Uint8, 16> lanes;
+  _mm_store_si128(reinterpret_cast<__m128i*>(lanes.data()), max);
+  diff.max_delta =
+      std::max(diff.max_delta, *std::max_element(lanes.begin(), lanes.end()));
+  return i;
+}
+#endif
+} // namespace impl
+
+/**
+ * Compare two images channel by channel. Pixels whose channels all differ by
+ * at most ~tolerance~ count as equal, which absorbs rounding differences
+ * between renderers.
+ */
+inline PixelDiff ComparePixels(PixelBuffer const& a,
+                               PixelBuffer const& b,
+                               Uint8 const tolerance = 0) noexcept {
+  PixelDiff diff;
+  SDLRAII_COLD_IF(a.w != b.w || a.h != b.h) {
+    diff.size_mismatch = true;
+    diff.mismatched    = std::max(a.size(), b.size());
+    diff.max_delta     = 255;
+    return diff;
+  }
+  auto const n  = a.size();
+  std::size_t i = 0;
+#ifdef SDLRAII_HEADLESS_SSE2
+  i = impl::diff_sse2(a.pixels.data(), b.pixels.data(), n, tolerance, diff);
+#endif
+  impl::diff_scalar(
+      a.pixels.data() + i, b.pixels.data() + i, n - i, tolerance, diff);
+  return diff;
+}
+
+struct FrameStats {
+  std::size_t count = 0;
+  double min = 0, mean = 0, median = 0, p95 = 0, p99 = 0, max = 0;
+};
+
+/** Per-frame durations in milliseconds. */
+class FrameTimes {
+ public:
+  void reserve(std::size_t const frames) { samples_.reserve(frames); }
+  void record(double const ms) { samples_.push_back(ms); }
+  /** Record the time since ~start~, a ~SDL_GetPerformanceCounter~ value. */
+  void record_since(Uint64 const start) {
+    auto const elapsed = SDL_GetPerformanceCounter() - start;
+    record(1000.0 * static_cast<double>(elapsed)
+           / static_cast<double>(SDL_GetPerformanceFrequency()));
+  }
+  void clear() noexcept { samples_.clear(); }
+
+  std::vector<double> const& samples() const noexcept { return samples_; }
+
+  FrameStats stats() const {
+    FrameStats s;
+    s.count = samples_.size();
+    if(s.count == 0) return s;
+    auto sorted = samples_;
+    std::sort(sorted.begin(), sorted.end());
+    auto const at = [&](double const p) {
+      auto const i = static_cast<std::size_t>(
+          std::ceil(p * static_cast<double>(s.count)) - 1);
+      return sorted[std::min(i, s.count - 1)];
+    };
+    double total = 0;
+    for(auto const t : sorted) total += t;
+    s.min    = sorted.front();
+    s.max    = sorted.back();
+    s.mean   = total / static_cast<double>(s.count);
+    s.median = at(0.5);
+    s.p95    = at(0.95);
+    s.p99    = at(0.99);
+    return s;
+  }
+
+ private:
+  std::vector<double> samples_;
+};
+
+/**
+ * Renders offscreen into a target texture so scenes can be checked against
+ * golden images and timed without a visible window.
+ *
+ * The window is hidden and the renderer is SDL's software renderer, so output
+ * is the same on every machine. For CI, select the dummy video driver before
+ * initializing SDL:
+ *
+ * #+begin_src c++
+ * sdl::UseDummyVideoDriver();
+ * auto const quitter = sdl::ScopedInit(sdl::init::video);
+ * auto harness       = sdl::HeadlessRenderer::Create(640, 480).get();
+ * for(int i = 0; i < 100; ++i) harness.frame(draw_scene);
+ * auto const diff = harness.compare_golden("scene.bmp", 2);
+ * auto const timing = harness.times().stats();
+ * #+end_src
+ */
+class HeadlessRenderer {
+ public:
+  static MayError<HeadlessRenderer>
+      Create(int const w,
+             int const h,
+             Uint32 const format = SDL_PIXELFORMAT_ARGB8888) noexcept {
+    HeadlessRenderer self{w, h};
+    auto window = CreateWindow("sdl2raii headless", w, h, window::hidden);
+    SDLRAII_BAIL_ERROR(window);
+    self.window_.reset(window.get().release());
+    auto renderer = CreateRenderer(self.window_.get(),
+                                   -1,
+                                   renderer::software
+                                       | renderer::targettexture);
+    SDLRAII_BAIL_ERROR(renderer);
+    self.renderer_.reset(renderer.get().release());
+    auto target = CreateTexture(
+        self.renderer_.get(), format, texture::access_target, w, h);
+    SDLRAII_BAIL_ERROR(target);
+    self.target_.reset(target.get().release());
+    return self;
+  }
+
+  Renderer* renderer() const noexcept { return renderer_.get(); }
+  Texture* target() const noexcept { return target_.get(); }
+  int width() const noexcept { return w_; }
+  int height() const noexcept { return h_; }
+
+  /**
+   * Runs ~draw(renderer)~ into the target texture, reads the result back and
+   * records how long it all took. Reading back waits for rendering to finish,
+   * so the time covers the whole frame. ~draw~ may return ~MayError<void>~ to
+   * abort the frame.
+   */
+  template<class Draw>
+  requires std::invocable<Draw&, Renderer*>
+  MayError<void> frame(Draw&& draw) {
+    auto const start    = SDL_GetPerformanceCounter();
+    auto const targeted = SetRenderTarget(renderer(), target());
+    SDLRAII_BAIL_ERROR(targeted);
+    if constexpr(std::is_void_v<std::invoke_result_t<Draw&, Renderer*>>) {
+      draw(renderer());
+    } else {
+      auto const drawn = draw(renderer());
+      SDLRAII_BAIL_ERROR(drawn);
+    }
+    auto const read = ReadPixels(renderer(), Rect{0, 0, w_, h_}, pixels_);
+    SDLRAII_BAIL_ERROR(read);
+    times_.record_since(start);
+    return {};
+  }
+
+  /** The pixels of the last frame. */
+  PixelBuffer const& pixels() const noexcept { return pixels_; }
+  FrameTimes const& times() const noexcept { return times_; }
+  FrameTimes& times() noexcept { return times_; }
+
+  MayError<void> save_golden(char const* const file) const noexcept {
+    return SavePixels(pixels_, file);
+  }
+  MayError<PixelDiff> compare_golden(char const* const file,
+                                     Uint8 const tolerance = 0) {
+    auto const loaded = LoadPixels(file, golden_);
+    SDLRAII_BAIL_ERROR(loaded);
+    return ComparePixels(pixels_, golden_, tolerance);
+  }
+
+ private:
+  HeadlessRenderer(int const w, int const h) noexcept : w_{w}, h_{h} {}
+
+  // destroyed in reverse: the texture, then the renderer, then the window
+  UniqueWindow window_;
+  UniqueRenderer renderer_;
+  UniqueTexture target_;
+  int w_, h_;
+  PixelBuffer pixels_;
+  PixelBuffer golden_;
+  FrameTimes times_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_HEADLESS_INCLUDE_GUARD
@@ -1,57 +1,87 @@
 #ifndef SDLRAII_IMG_INCLUDE_GUARD
 #define SDLRAII_IMG_INCLUDE_GUARD
 
-#include "mayerror.hpp"
+#include "sdl.hpp"
+
 #include "compat_macros.hpp"
+#include "MayError.hpp"
 #define SDLRAII_THE_PREFIX IMG
 #include "wrapgen_macros.hpp"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#include <utility>
+
 namespace sdl { namespace img {
 
 // init
-struct init {
-  enum flags { jpg = IMG_INIT_JPG, png = IMG_INIT_PNG, tif = IMG_INIT_TIF };
-};
+namespace init {
+using flags                           = int;
+[[maybe_unused]] constexpr flags jpg  = IMG_INIT_JPG;
+[[maybe_unused]] constexpr flags png  = IMG_INIT_PNG;
+[[maybe_unused]] constexpr flags tif  = IMG_INIT_TIF;
+[[maybe_unused]] constexpr flags webp = IMG_INIT_WEBP;
+} // namespace init
 
-struct Quitter {
-  ~Quitter() { sdl::img::Quit(); }
+/**
+ * ~IMG_Init~ returns the loaders that are ready rather than a status, so this
+ * fails unless every one of ~flags~ is. Returns everything that is ready.
+ */
+inline MayError<init::flags> Init(init::flags const flags) noexcept {
+  auto const ready = IMG_Init(flags);
+  SDLRAII_COLD_IF((ready & flags) != flags)
+    return sdl::GetError();
+  return ready;
+}
+SDLRAII_WRAP_FN(Quit, );
+
+/** ~sdl::Quitter~ for ~IMG_Quit~. */
+class Quitter {
+ public:
+  Quitter() = default;
+  Quitter(Quitter&& other) noexcept
+      : engaged_{std::exchange(other.engaged_, false)} {}
+  Quitter& operator=(Quitter&&) = delete;
+  ~Quitter() {
+    if(engaged_) sdl::img::Quit();
+  }
+
+ private:
+  bool engaged_ = true;
 };
 
-[[nodiscard]] MayError<Quitter> ScopedInit(init::flags flags = 0) noexcept {
-  auto const result = sdl::Init(subsystems);
-  SDLRAII_COLD_IF(!result.ok())
-    return result.error();
+[[nodiscard]] inline MayError<Quitter>
+    ScopedInit(init::flags const flags = 0) noexcept {
+  auto const result = img::Init(flags);
+  SDLRAII_BAIL_ERROR(result);
   return Quitter{};
 }
 
 // automagic
-SDLRAII_WRAP_FN(Init, nonzero_error);
-SDLRAII_WRAP_RAIIFN(unique::Surface, Load);
-SDLRAII_WRAP_RAIIFN(unique::Surface, Load_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadTyped_RW);
-SDLRAII_WRAP_FN(Quit);
+SDLRAII_WRAP_MAKER(UniqueSurface, Load);
+SDLRAII_WRAP_MAKER(UniqueSurface, Load_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadTyped_RW);
 
 // specific
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadBMP_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadCUR_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadGIF_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadICO_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadJPG_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadLBM_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadPCX_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadPNG_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadPNM_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadTGA_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadTIF_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadXCF_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadXPM_RW);
-SDLRAII_WRAP_RAIIFN(unique::Surface, LoadXV_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadBMP_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadCUR_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadGIF_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadICO_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadJPG_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadLBM_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadPCX_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadPNG_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadPNM_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadTGA_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadTIF_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadWEBP_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadXCF_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadXPM_RW);
+SDLRAII_WRAP_MAKER(UniqueSurface, LoadXV_RW);
 
 // array
-SDLRAII_WRAP_RAIIFN(unique::Surface, ReadXPMFromArray);
+SDLRAII_WRAP_MAKER(UniqueSurface, ReadXPMFromArray);
 
 // info
 SDLRAII_WRAP_FN(isBMP, );
@@ -64,10 +94,77 @@ SDLRAII_WRAP_FN(isPCX, );
 SDLRAII_WRAP_FN(isPNG, );
 SDLRAII_WRAP_FN(isPNM, );
 SDLRAII_WRAP_FN(isTIF, );
+SDLRAII_WRAP_FN(isWEBP, );
 SDLRAII_WRAP_FN(isXCF, );
 SDLRAII_WRAP_FN(isXPM, );
 SDLRAII_WRAP_FN(isXV, );
 
+/** The formats SDL_image can recognize from their contents. */
+enum class format : Uint8 {
+  unknown,
+  png,
+  jpg,
+  bmp,
+  gif,
+  webp,
+  tif,
+  ico,
+  cur,
+  pcx,
+  pnm,
+  lbm,
+  xcf,
+  xpm,
+  xv
+};
+
+namespace impl {
+struct Probe {
+  format type;
+  int (*is)(SDL_RWops*);
+  SDL_Surface* (*load)(SDL_RWops*);
+};
+// the common formats first; each probe reads a few bytes and seeks back
+inline constexpr Probe probes[] = {{format::png, IMG_isPNG, IMG_LoadPNG_RW},
+                                   {format::jpg, IMG_isJPG, IMG_LoadJPG_RW},
+                                   {format::bmp, IMG_isBMP, IMG_LoadBMP_RW},
+                                   {format::gif, IMG_isGIF, IMG_LoadGIF_RW},
+                                   {format::webp, IMG_isWEBP, IMG_LoadWEBP_RW},
+                                   {format::tif, IMG_isTIF, IMG_LoadTIF_RW},
+                                   {format::ico, IMG_isICO, IMG_LoadICO_RW},
+                                   {format::cur, IMG_isCUR, IMG_LoadCUR_RW},
+                                   {format::pcx, IMG_isPCX, IMG_LoadPCX_RW},
+                                   {format::pnm, IMG_isPNM, IMG_LoadPNM_RW},
+                                   {format::lbm, IMG_isLBM, IMG_LoadLBM_RW},
+                                   {format::xcf, IMG_isXCF, IMG_LoadXCF_RW},
+                                   {format::xpm, IMG_isXPM, IMG_LoadXPM_RW},
+                                   {format::xv, IMG_isXV, IMG_LoadXV_RW}};
+} // namespace impl
+
+/** Sniff the format of ~src~ without moving it. */
+inline format DetectFormat(RWops* const src) noexcept {
+  for(auto const& probe : impl::probes)
+    if(probe.is(src)) return probe.type;
+  return format::unknown;
+}
+
+/**
+ * Decode ~src~ as ~type~ with that format's loader, skipping the probing
+ * ~IMG_Load_RW~ would repeat. ~format::unknown~ falls back to ~IMG_Load_RW~,
+ * which also knows formats with no probe, such as TGA.
+ */
+inline MayError<UniqueSurface> LoadFormat(RWops* const src,
+                                          format const type) noexcept {
+  for(auto const& probe : impl::probes) {
+    if(probe.type != type) continue;
+    auto* const surface = probe.load(src);
+    SDLRAII_COLD_IF(surface == nullptr)
+      return sdl::GetError();
+    return UniqueSurface{surface};
+  }
+  return img::Load_RW(src, 0);
+}
+
 }} // namespace sdl::img
 
 #undef SDLRAII_THE_PREFIX
@@ -0,0 +1,117 @@
+#ifndef SDLRAII_IMG_BATCH_INCLUDE_GUARD
+#define SDLRAII_IMG_BATCH_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "img.hpp"
+#include "jobs.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <climits>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sdl { namespace img {
+
+/**
+ * The results of a ~LoadBatch~, one per input and in input order, with the
+ * format each was decoded as. Error messages point into ~messages~, since the
+ * workers' ~SDL_GetError~ buffers do not outlive them.
+ */
+struct ImageBatch {
+  std::vector<std::string> messages;
+  std::vector<MayError<UniqueSurface>> surfaces;
+  std::vector<format> formats;
+
+  std::size_t size() const noexcept { return surfaces.size(); }
+  std::size_t failures() const noexcept {
+    std::size_t n = 0;
+    for(auto const& s : surfaces) n += !s.ok();
+    return n;
+  }
+};
+
+namespace impl {
+/** Sniff and decode one file already in memory. */
+inline MayError<UniqueSurface> decode(std::span<Uint8 const> const bytes,
+                                      format& type) noexcept {
+  SDLRAII_COLD_IF(bytes.size() > INT_MAX)
+    return sdl::Error{"img::LoadBatch: file too large"};
+  auto src = RWFromConstMem(bytes.data(), static_cast<int>(bytes.size()));
+  SDLRAII_BAIL_ERROR(src);
+  type = DetectFormat(src.get().get());
+  return LoadFormat(src.get().get(), type);
+}
+
+/**
+ * Run ~load(i, type)~ for each input on ~jobs~, collecting the results. The
+ * slots are filled in place because ~MayError<UniqueSurface>~ cannot be
+ * assigned.
+ */
+template<class Load>
+inline ImageBatch
+    load_batch(JobSystem& jobs, std::size_t const count, Load const& load) {
+  std::vector<std::optional<MayError<UniqueSurface>>> slots(count);
+  ImageBatch batch;
+  batch.messages.resize(count);
+  batch.formats.resize(count, format::unknown);
+  jobs.parallel_for(0, count, 1, [&](std::size_t const first,
+                                     std::size_t const last) {
+    for(auto i = first; i < last; ++i) {
+      auto& slot = slots[i].emplace(load(i, batch.formats[i]));
+      if(!slot.ok()) batch.messages[i] = slot.error().message;
+    }
+  });
+  batch.surfaces.reserve(count);
+  for(std::size_t i = 0; i < count; ++i) {
+    if(slots[i]->ok())
+      batch.surfaces.emplace_back(std::move(*slots[i]).get());
+    else
+      batch.surfaces.emplace_back(sdl::Error{batch.messages[i].c_str()});
+  }
+  return batch;
+}
+} // namespace impl
+
+/**
+ * Decode many images at once on ~jobs~' workers. Each file is read into memory
+ * in one call, its format is sniffed once with the ~isPNG~-style probes on a
+ * memory ~RWops~, and it is decoded by that format's loader; all of it happens
+ * on a worker, so files load and decode in parallel.
+ *
+ * Call ~img::Init~ for the formats used first: SDL_image loads its codec
+ * libraries on first use, which is not safe to race.
+ */
+inline ImageBatch LoadBatch(JobSystem& jobs,
+                            std::span<char const* const> const paths) {
+  return impl::load_batch(
+      jobs,
+      paths.size(),
+      [&](std::size_t const i, format& type) -> MayError<UniqueSurface> {
+        auto const file = LoadFile(paths[i]);
+        SDLRAII_BAIL_ERROR(file);
+        auto const* const data = static_cast<Uint8 const*>(file.get().data);
+        return impl::decode({data, file.get().size}, type);
+      });
+}
+
+/** ~LoadBatch~ for files already in memory, e.g. ~Pack~ entries. */
+inline ImageBatch
+    LoadBatch(JobSystem& jobs,
+              std::span<std::span<Uint8 const> const> const files) {
+  return impl::load_batch(
+      jobs, files.size(), [&](std::size_t const i, format& type) {
+        return impl::decode(files[i], type);
+      });
+}
+
+}} // namespace sdl::img
+
+#endif // SDLRAII_IMG_BATCH_INCLUDE_GUARD
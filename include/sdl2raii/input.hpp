@@ -0,0 +1,303 @@
+#ifndef SDLRAII_INPUT_INCLUDE_GUARD
+#define SDLRAII_INPUT_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+#define SDLRAII_THE_PREFIX SDL
+#include "wrapgen_macros.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+namespace sdl {
+
+SDLRAII_WRAP_TYPE(Scancode);
+SDLRAII_WRAP_TYPE(JoystickID);
+SDLRAII_WRAP_TYPE(GameController);
+SDLRAII_WRAP_TYPE(GameControllerAxis);
+SDLRAII_WRAP_TYPE(GameControllerButton);
+
+SDLRAII_DEFUNIQUE(GameController, SDL_GameControllerClose);
+SDLRAII_WRAP_MAKER(UniqueGameController, GameControllerOpen);
+
+SDLRAII_WRAP_FN(GameControllerGetAxis, );
+SDLRAII_WRAP_FN(GameControllerGetButton, );
+
+/**
+ * A fixed-size bitset with the word-wise operations edge detection needs.
+ * Unlike ~std::bitset~ it is guaranteed trivially copyable.
+ */
+template<std::size_t N>
+struct Bits {
+  static constexpr std::size_t word_count = (N + 63) / 64;
+  std::array<Uint64, word_count> words{};
+
+  constexpr bool test(std::size_t const i) const noexcept {
+    return (words[i / 64] >> (i % 64)) & 1;
+  }
+  constexpr void set(std::size_t const i, bool const value = true) noexcept {
+    auto const bit = Uint64{1} << (i % 64);
+    if(value)
+      words[i / 64] |= bit;
+    else
+      words[i / 64] &= ~bit;
+  }
+  constexpr bool any() const noexcept {
+    for(auto const w : words)
+      if(w) return true;
+    return false;
+  }
+  constexpr std::size_t count() const noexcept {
+    std::size_t n = 0;
+    for(auto const w : words) n += static_cast<std::size_t>(std::popcount(w));
+    return n;
+  }
+
+  /** Bits set in ~*this~ but not in ~other~. */
+  constexpr Bits minus(Bits const& other) const noexcept {
+    Bits result;
+    for(std::size_t i = 0; i < word_count; ++i)
+      result.words[i] = words[i] & ~other.words[i];
+    return result;
+  }
+
+  friend constexpr bool operator==(Bits const&, Bits const&) = default;
+};
+
+/**
+ * A per-frame snapshot of keyboard, mouse and game controller state with
+ * press and release edges.
+ *
+ * Call ~begin_frame~ once per frame, then update it either by feeding every
+ * event to ~handle~ (e.g. from the ~NextEvent~ loop) or by calling ~poll~
+ * after the events are pumped. Edges compare against the state at the start
+ * of the frame, so a key tapped and released within one frame shows as
+ * neither pressed nor released.
+ *
+ * Everything is stored inline: nothing allocates, and the whole state is
+ * trivially copyable (a few hundred bytes), so snapshots are cheap to keep for
+ * rollback.
+ */
+class InputState {
+ public:
+  static constexpr std::size_t scancode_count  = SDL_NUM_SCANCODES;
+  static constexpr std::size_t max_controllers = 4;
+  static constexpr std::size_t controller_axes = SDL_CONTROLLER_AXIS_MAX;
+
+  using Keys = Bits<scancode_count>;
+
+  struct Mouse {
+    int x = 0, y = 0;
+    // motion and wheel accumulated this frame
+    int dx = 0, dy = 0;
+    float wheel_x = 0, wheel_y = 0;
+    Uint32 buttons = 0; // SDL_BUTTON(n) mask
+
+    friend bool operator==(Mouse const&, Mouse const&) = default;
+  };
+
+  struct Controller {
+    JoystickID id = -1; // -1 when the slot is empty
+    std::array<Sint16, controller_axes> axes{};
+    Uint32 buttons = 0; // 1 << SDL_GameControllerButton
+
+    friend bool operator==(Controller const&, Controller const&) = default;
+  };
+
+  /** Make the current state the baseline for this frame's edges. */
+  void begin_frame() noexcept {
+    previous_keys_    = keys_;
+    previous_buttons_ = mouse_.buttons;
+    for(std::size_t i = 0; i < max_controllers; ++i)
+      previous_pad_buttons_[i] = controllers_[i].buttons;
+    mouse_.dx = mouse_.dy = 0;
+    mouse_.wheel_x = mouse_.wheel_y = 0;
+  }
+
+  /** Fold one event into the state. Unrelated events are ignored. */
+  void handle(Event const& e) noexcept {
+    switch(e.type) {
+      case SDL_KEYDOWN:
+      case SDL_KEYUP:
+        keys_.set(static_cast<std::size_t>(e.key.keysym.scancode),
+                  e.key.state == SDL_PRESSED);
+        break;
+      case SDL_MOUSEMOTION:
+        mouse_.x = e.motion.x;
+        mouse_.y = e.motion.y;
+        mouse_.dx += e.motion.xrel;
+        mouse_.dy += e.motion.yrel;
+        break;
+      case SDL_MOUSEBUTTONDOWN:
+      case SDL_MOUSEBUTTONUP: {
+        auto const bit = static_cast<Uint32>(SDL_BUTTON(e.button.button));
+        if(e.button.state == SDL_PRESSED)
+          mouse_.buttons |= bit;
+        else
+          mouse_.buttons &= ~bit;
+        mouse_.x = e.button.x;
+        mouse_.y = e.button.y;
+        break;
+      }
+      case SDL_MOUSEWHEEL: {
+        auto const flip =
+            e.wheel.direction == SDL_MOUSEWHEEL_FLIPPED ? -1.f : 1.f;
+        mouse_.wheel_x += flip * e.wheel.preciseX;
+        mouse_.wheel_y += flip * e.wheel.preciseY;
+        break;
+      }
+      case SDL_CONTROLLERAXISMOTION:
+        if(auto* const pad = slot(e.caxis.which, true))
+          if(e.caxis.axis < controller_axes)
+            pad->axes[e.caxis.axis] = e.caxis.value;
+        break;
+      case SDL_CONTROLLERBUTTONDOWN:
+      case SDL_CONTROLLERBUTTONUP:
+        if(auto* const pad = slot(e.cbutton.which, true)) {
+          auto const bit = Uint32{1} << (e.cbutton.button & 31);
+          if(e.cbutton.state == SDL_PRESSED)
+            pad->buttons |= bit;
+          else
+            pad->buttons &= ~bit;
+        }
+        break;
+      case SDL_CONTROLLERDEVICEREMOVED:
+        // for removals ~which~ is the instance ID
+        if(auto* const pad = slot(e.cdevice.which, false)) *pad = Controller{};
+        break;
+      default: break;
+    }
+  }
+
+  /**
+   * Replace keyboard and mouse state with SDL's current state. Wheel and
+   * relative motion only come from events, so they are left alone.
+   */
+  void poll() noexcept {
+    int n               = 0;
+    auto const* const k = SDL_GetKeyboardState(&n);
+    auto const count    = std::min(static_cast<std::size_t>(n), scancode_count);
+    keys_               = Keys{};
+    for(std::size_t word = 0; word * 64 < count; ++word) {
+      Uint64 bits     = 0;
+      auto const last = std::min<std::size_t>(64, count - word * 64);
+      for(std::size_t b = 0; b < last; ++b)
+        bits |= Uint64{k[word * 64 + b] != 0} << b;
+      keys_.words[word] = bits;
+    }
+    mouse_.buttons = SDL_GetMouseState(&mouse_.x, &mouse_.y);
+  }
+
+  /** Also replace controller state by querying each open controller. */
+  void poll(std::span<GameController* const> const pads) noexcept {
+    poll();
+    for(auto* const pad : pads) {
+      if(!pad) continue;
+      auto const id =
+          SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(pad));
+      auto* const c = slot(id, true);
+      if(!c) continue;
+      for(std::size_t a = 0; a < controller_axes; ++a)
+        c->axes[a] = SDL_GameControllerGetAxis(
+            pad, static_cast<GameControllerAxis>(a));
+      Uint32 buttons = 0;
+      for(int b = 0; b < SDL_CONTROLLER_BUTTON_MAX && b < 32; ++b)
+        buttons |= Uint32{SDL_GameControllerGetButton(
+                       pad, static_cast<GameControllerButton>(b))
+                   != 0}
+                << b;
+      c->buttons = buttons;
+    }
+  }
+
+  // keyboard
+  bool down(Scancode const key) const noexcept {
+    return keys_.test(static_cast<std::size_t>(key));
+  }
+  bool pressed(Scancode const key) const noexcept {
+    auto const i = static_cast<std::size_t>(key);
+    return keys_.test(i) && !previous_keys_.test(i);
+  }
+  bool released(Scancode const key) const noexcept {
+    auto const i = static_cast<std::size_t>(key);
+    return !keys_.test(i) && previous_keys_.test(i);
+  }
+  Keys const& keys() const noexcept { return keys_; }
+  Keys keys_pressed() const noexcept { return keys_.minus(previous_keys_); }
+  Keys keys_released() const noexcept { return previous_keys_.minus(keys_); }
+
+  // mouse; buttons are SDL_BUTTON_LEFT etc
+  Mouse const& mouse() const noexcept { return mouse_; }
+  bool mouse_down(int const button) const noexcept {
+    return mouse_.buttons & SDL_BUTTON(button);
+  }
+  bool mouse_pressed(int const button) const noexcept {
+    return mouse_buttons_pressed() & SDL_BUTTON(button);
+  }
+  bool mouse_released(int const button) const noexcept {
+    return mouse_buttons_released() & SDL_BUTTON(button);
+  }
+  Uint32 mouse_buttons_pressed() const noexcept {
+    return mouse_.buttons & ~previous_buttons_;
+  }
+  Uint32 mouse_buttons_released() const noexcept {
+    return previous_buttons_ & ~mouse_.buttons;
+  }
+
+  // controllers, by slot; slots fill in the order controllers are first seen
+  Controller const& controller(std::size_t const i) const noexcept {
+    return controllers_[i];
+  }
+  Sint16 axis(std::size_t const i, GameControllerAxis const a) const noexcept {
+    return controllers_[i].axes[static_cast<std::size_t>(a)];
+  }
+  bool button_down(std::size_t const i,
+                   GameControllerButton const b) const noexcept {
+    return controllers_[i].buttons & (Uint32{1} << b);
+  }
+  bool button_pressed(std::size_t const i,
+                      GameControllerButton const b) const noexcept {
+    return (controllers_[i].buttons & ~previous_pad_buttons_[i])
+         & (Uint32{1} << b);
+  }
+  bool button_released(std::size_t const i,
+                       GameControllerButton const b) const noexcept {
+    return (previous_pad_buttons_[i] & ~controllers_[i].buttons)
+         & (Uint32{1} << b);
+  }
+
+  friend bool operator==(InputState const&, InputState const&) = default;
+
+ private:
+  Controller* slot(JoystickID const id, bool const claim) noexcept {
+    Controller* empty = nullptr;
+    for(auto& c : controllers_) {
+      if(c.id == id) return &c;
+      if(!empty && c.id == -1) empty = &c;
+    }
+    if(claim && empty) empty->id = id;
+    return claim ? empty : nullptr;
+  }
+
+  Keys keys_;
+  Keys previous_keys_;
+  Mouse mouse_;
+  Uint32 previous_buttons_ = 0;
+  std::array<Controller, max_controllers> controllers_{};
+  std::array<Uint32, max_controllers> previous_pad_buttons_{};
+};
+
+static_assert(std::is_trivially_copyable_v<InputState>);
+
+} // namespace sdl
+#undef SDLRAII_THE_PREFIX
+
+#endif // SDLRAII_INPUT_INCLUDE_GUARD
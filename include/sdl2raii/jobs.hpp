@@ -0,0 +1,430 @@
+#ifndef SDLRAII_JOBS_INCLUDE_GUARD
+#define SDLRAII_JOBS_INCLUDE_GUARD
+
+#include "thread.hpp"
+
+#include "compat_macros.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+namespace impl {
+
+struct Job {
+  std::function<void()> fn;
+  AtomicInt refs{1};
+  // dependencies still running, plus one held by ~spawn~ until it is done
+  // registering them
+  AtomicInt unmet{1};
+  AtomicInt done;
+  SpinMutex lock;
+  std::vector<Job*> continuations; // guarded by lock
+};
+
+template<class Unique>
+inline Unique or_null(MayError<Unique>&& made) noexcept {
+  return made.ok() ? std::move(made).success() : Unique{};
+}
+
+inline void release_job(Job* const job) noexcept {
+  if(job->refs.add(-1) == 1) delete job;
+}
+
+/**
+ * The Chase-Lev work-stealing deque, with the C11 memory orderings from
+ * Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models"
+ * (PPoPP 2013).
+ *
+ * The owning worker pushes and takes at the bottom; any thread steals from
+ * the top. The ring grows when full; outgrown rings are kept until the deque
+ * dies because a thief may still be reading one.
+ */
+class WorkStealingDeque {
+ public:
+  explicit WorkStealingDeque(std::int64_t const capacity = 256) {
+    rings_.push_back(std::make_unique<Ring>(capacity));
+    ring_.store(rings_.back().get(), std::memory_order_relaxed);
+  }
+  WorkStealingDeque(WorkStealingDeque const&) = delete;
+  WorkStealingDeque& operator=(WorkStealingDeque const&) = delete;
+
+  /** Owner only. */
+  void push(Job* const job) {
+    auto const b = bottom_.load(std::memory_order_relaxed);
+    auto const t = top_.load(std::memory_order_acquire);
+    auto* ring   = ring_.load(std::memory_order_relaxed);
+    SDLRAII_COLD_IF(b - t > ring->mask) ring = grow(ring, t, b);
+    ring->put(b, job);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+
+  /** Owner only. Newest first; ~nullptr~ if empty. */
+  Job* take() noexcept {
+    auto const b     = bottom_.load(std::memory_order_relaxed) - 1;
+    auto* const ring = ring_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_relaxed);
+    if(t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    auto* job = ring->get(b);
+    if(t == b) {
+      // last element: race the thieves for it
+      if(!top_.compare_exchange_strong(t,
+                                       t + 1,
+                                       std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+        job = nullptr;
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  /** Any thread. Oldest first; ~nullptr~ if empty or another thief won. */
+  Job* steal() noexcept {
+    auto t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto const b = bottom_.load(std::memory_order_acquire);
+    if(t >= b) return nullptr;
+    auto* const job = ring_.load(std::memory_order_acquire)->get(t);
+    if(!top_.compare_exchange_strong(t,
+                                     t + 1,
+                                     std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      return nullptr;
+    return job;
+  }
+
+  /** A hint for thieves; may be stale by the time it returns. */
+  bool looks_empty() const noexcept {
+    return bottom_.load(std::memory_order_relaxed)
+        <= top_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Ring {
+    std::int64_t mask;
+    std::unique_ptr<std::atomic<Job*>[]> slots;
+
+    explicit Ring(std::int64_t const capacity)
+        : mask{capacity - 1},
+          slots{std::make_unique<std::atomic<Job*>[]>(
+              static_cast<std::size_t>(capacity))} {
+      SDL_assert((capacity & mask) == 0);
+    }
+    Job* get(std::int64_t const i) const noexcept {
+      return slots[static_cast<std::size_t>(i & mask)].load(
+          std::memory_order_relaxed);
+    }
+    void put(std::int64_t const i, Job* const job) noexcept {
+      slots[static_cast<std::size_t>(i & mask)].store(
+          job, std::memory_order_relaxed);
+    }
+  };
+
+  Ring* grow(Ring* const old, std::int64_t const t, std::int64_t const b) {
+    rings_.push_back(std::make_unique<Ring>((old->mask + 1) * 2));
+    auto* const ring = rings_.back().get();
+    for(auto i = t; i < b; ++i) ring->put(i, old->get(i));
+    ring_.store(ring, std::memory_order_release);
+    return ring;
+  }
+
+  alignas(64) std::atomic<std::int64_t> top_{0};
+  alignas(64) std::atomic<std::int64_t> bottom_{0};
+  std::atomic<Ring*> ring_;
+  std::vector<std::unique_ptr<Ring>> rings_; // owner only
+};
+
+} // namespace impl
+
+/**
+ * A reference to a spawned job, for waiting on it or depending on it.
+ */
+class JobHandle {
+ public:
+  JobHandle() = default;
+  JobHandle(JobHandle const& other) noexcept : job_{other.job_} {
+    if(job_) job_->refs.add(1);
+  }
+  JobHandle(JobHandle&& other) noexcept
+      : job_{std::exchange(other.job_, nullptr)} {}
+  JobHandle& operator=(JobHandle other) noexcept {
+    std::swap(job_, other.job_);
+    return *this;
+  }
+  ~JobHandle() {
+    if(job_) impl::release_job(job_);
+  }
+
+  bool done() const noexcept { return !job_ || job_->done.get() != 0; }
+  explicit operator bool() const noexcept { return job_ != nullptr; }
+
+ private:
+  friend class JobSystem;
+  /** Adopts a reference. */
+  explicit JobHandle(impl::Job* const job) noexcept : job_{job} {}
+
+  impl::Job* job_ = nullptr;
+};
+
+/**
+ * A work-stealing job scheduler on SDL threads.
+ *
+ * Each worker owns a Chase-Lev deque: jobs spawned from a worker go to its
+ * own deque and idle workers steal from the others. Jobs spawned from other
+ * threads (usually the main loop) go through a shared queue. Idle workers
+ * spin briefly, then sleep on a semaphore.
+ *
+ * Waiting helps: a thread blocked in ~wait~ or ~parallel_for~ runs queued jobs
+ * instead of sleeping. So with zero workers, e.g. on an emscripten build
+ * without pthreads, everything still runs, on the waiting thread.
+ *
+ * Workers that fail to start are skipped, so ~worker_count~ may be less than
+ * requested (zero if SDL can't make the mutex or semaphore). Destruction runs
+ * every outstanding job, then joins the workers.
+ */
+class JobSystem {
+ public:
+  explicit JobSystem(int const workers = std::max(GetCPUCount() - 1, 0),
+                     thread::priority const priority = thread::priority_normal)
+      : wake_{impl::or_null(CreateSemaphore(0u))},
+        mutex_{impl::or_null(CreateMutex())} {
+    SDLRAII_COLD_IF(!wake_ || !mutex_) return;
+    workers_.reserve(static_cast<std::size_t>(workers));
+    for(int i = 0; i < workers; ++i)
+      workers_.push_back(std::make_unique<Worker>());
+    for(int i = 0; i < workers; ++i) {
+      auto thread = CreateThread("sdl2raii job", [this, i, priority] {
+        if(priority != thread::priority_normal) SetThreadPriority(priority);
+        work(i);
+      });
+      SDLRAII_COLD_IF(!thread.ok()) break;
+      threads_.push_back(std::move(thread).success());
+    }
+  }
+
+  JobSystem(JobSystem const&) = delete;
+  JobSystem& operator=(JobSystem const&) = delete;
+
+  ~JobSystem() {
+    while(outstanding_.get() > 0)
+      if(!run_one(current_index())) std::this_thread::yield();
+    stop_.set(1);
+    for(std::size_t i = 0; i < threads_.size(); ++i) SemPost(wake_.get());
+    threads_.clear();
+  }
+
+  int worker_count() const noexcept { return static_cast<int>(threads_.size()); }
+
+  /** Runs ~fn~ once every job in ~after~ has finished. */
+  JobHandle spawn(std::function<void()> fn,
+                  std::span<JobHandle const> const after = {}) {
+    auto* const job = new impl::Job;
+    job->fn         = std::move(fn);
+    job->refs.set(2); // ours, until it runs, and the handle's
+    outstanding_.add(1);
+    for(auto const& dependency : after) {
+      auto* const before = dependency.job_;
+      if(!before) continue;
+      std::lock_guard const lock{before->lock};
+      if(before->done.get() != 0) continue;
+      job->unmet.add(1);
+      before->continuations.push_back(job);
+    }
+    if(job->unmet.add(-1) == 1) enqueue(job);
+    return JobHandle{job};
+  }
+  JobHandle spawn(std::function<void()> fn,
+                  std::initializer_list<JobHandle> const after) {
+    return spawn(std::move(fn),
+                 std::span<JobHandle const>{after.begin(), after.size()});
+  }
+
+  /** Blocks until ~job~ has finished, running other jobs meanwhile. */
+  void wait(JobHandle const& job) {
+    auto const index = current_index();
+    while(!job.done())
+      if(!run_one(index)) std::this_thread::yield();
+  }
+
+  /**
+   * Calls ~fn(begin, end)~ on disjoint subranges covering [first, last), each
+   * at most ~grain~ long, and returns when all have finished. The range is
+   * split in halves recursively so that thieves take large pieces.
+   */
+  template<class Fn>
+  requires std::invocable<Fn&, std::size_t, std::size_t>
+  void parallel_for(std::size_t first,
+                    std::size_t last,
+                    std::size_t grain,
+                    Fn&& fn) {
+    grain = std::max<std::size_t>(grain, 1);
+    std::array<JobHandle, 64> halves;
+    std::size_t split = 0;
+    while(last > first && last - first > grain && split < halves.size()) {
+      auto const mid  = first + (last - first) / 2;
+      halves[split++] = spawn(
+          [this, mid, last, grain, &fn] { parallel_for(mid, last, grain, fn); });
+      last = mid;
+    }
+    if(first < last) fn(first, last);
+    while(split > 0) wait(halves[--split]);
+  }
+  /** Picks a grain giving each thread a few pieces to balance with. */
+  template<class Fn>
+  requires std::invocable<Fn&, std::size_t, std::size_t>
+  void parallel_for(std::size_t const first, std::size_t const last, Fn&& fn) {
+    auto const pieces = static_cast<std::size_t>(worker_count() + 1) * 4;
+    auto const grain  = last > first ? (last - first + pieces - 1) / pieces : 1;
+    parallel_for(first, last, grain, SDLRAII_FWD(fn));
+  }
+
+ private:
+  struct alignas(64) Worker {
+    impl::WorkStealingDeque deque;
+  };
+
+  struct Current {
+    JobSystem const* system = nullptr;
+    int index               = -1;
+    Uint32 seed             = 0; // picks steal victims; 0 until first used
+  };
+  static Current& current() noexcept {
+    thread_local Current current;
+    return current;
+  }
+  /** The calling thread's worker index, or -1 if it isn't one of ours. */
+  int current_index() const noexcept {
+    auto const& c = current();
+    return c.system == this ? c.index : -1;
+  }
+
+  void enqueue(impl::Job* const job) {
+    auto const index = current_index();
+    if(index >= 0) {
+      workers_[static_cast<std::size_t>(index)]->deque.push(job);
+    } else {
+      LockGuard const lock{mutex_.get()};
+      injected_.push_back(job);
+      injected_count_.add(1);
+    }
+    // order the push before reading ~sleeping_~; pairs with the fence before
+    // the re-check in ~work~
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(sleeping_.get() > 0) SemPost(wake_.get());
+  }
+
+  impl::Job* find_job(int const index) {
+    if(index >= 0)
+      if(auto* const job = workers_[static_cast<std::size_t>(index)]->deque.take())
+        return job;
+    if(injected_count_.get() > 0) {
+      LockGuard const lock{mutex_.get()};
+      if(!injected_.empty()) {
+        auto* const job = injected_.front();
+        injected_.pop_front();
+        injected_count_.add(-1);
+        return job;
+      }
+    }
+    auto const n = workers_.size();
+    if(n == 0) return nullptr;
+    // xorshift, seeded per thread so that thieves spread over the victims
+    auto& seed = current().seed;
+    if(seed == 0) seed = static_cast<Uint32>(ThreadID()) * 0x9e3779b9u | 1u;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    for(std::size_t i = 0; i < n; ++i) {
+      auto const victim = (seed + i) % n;
+      if(static_cast<int>(victim) == index) continue;
+      auto& deque = workers_[victim]->deque;
+      if(deque.looks_empty()) continue;
+      if(auto* const job = deque.steal()) return job;
+    }
+    return nullptr;
+  }
+
+  bool run_one(int const index) {
+    auto* const job = find_job(index);
+    if(!job) return false;
+    execute(job);
+    return true;
+  }
+
+  void execute(impl::Job* const job) {
+    job->fn();
+    job->fn = nullptr; // drop captures before anyone waiting wakes
+    std::vector<impl::Job*> ready;
+    {
+      std::lock_guard const lock{job->lock};
+      job->done.set(1);
+      ready.swap(job->continuations);
+    }
+    for(auto* const next : ready)
+      if(next->unmet.add(-1) == 1) enqueue(next);
+    outstanding_.add(-1);
+    impl::release_job(job);
+  }
+
+  void work(int const index) {
+    current() = Current{this, index};
+    constexpr int spins = 64;
+    int idle            = 0;
+    while(stop_.get() == 0) {
+      if(run_one(index)) {
+        idle = 0;
+        continue;
+      }
+      if(++idle < spins) {
+        std::this_thread::yield();
+        continue;
+      }
+      // announce the sleep, then look once more: either this sees a job
+      // pushed before the fence in ~enqueue~ or that producer sees us and
+      // posts, so no wakeup is missed
+      sleeping_.add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(run_one(index)) {
+        sleeping_.add(-1);
+        idle = 0;
+        continue;
+      }
+      SemWait(wake_.get());
+      sleeping_.add(-1);
+      idle = 0;
+    }
+  }
+
+  UniqueSem wake_;
+  UniqueMutex mutex_;
+  std::deque<impl::Job*> injected_; // guarded by mutex_
+  AtomicInt injected_count_;
+  AtomicInt outstanding_;
+  AtomicInt sleeping_;
+  AtomicInt stop_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<UniqueThread> threads_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_JOBS_INCLUDE_GUARD
@@ -0,0 +1,101 @@
+#ifndef SDLRAII_MAPPED_FILE_INCLUDE_GUARD
+#define SDLRAII_MAPPED_FILE_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <cstddef>
+#include <span>
+#include <utility>
+
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#  define SDLRAII_HAVE_MMAP 1
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace sdl {
+
+/**
+ * A whole file mapped into memory, read-only on disk.
+ *
+ * Pages are mapped copy-on-write, so the bytes may be modified (for example
+ * when handed to SDL as surface pixels) without touching the file. Where
+ * ~mmap~ is unavailable the file is read into memory with ~SDL_LoadFile~
+ * instead, which costs a copy but behaves the same.
+ */
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(MappedFile&& other) noexcept
+      : data_{std::exchange(other.data_, nullptr)},
+        size_{std::exchange(other.size_, 0)} {}
+  MappedFile& operator=(MappedFile other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+  ~MappedFile() { reset(); }
+
+  static MayError<MappedFile> Open(char const* const path) noexcept {
+    MappedFile file;
+#ifdef SDLRAII_HAVE_MMAP
+    auto const fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    SDLRAII_COLD_IF(fd < 0)
+      return sdl::Error{"MappedFile: could not open file"};
+    struct stat info;
+    auto const statted = ::fstat(fd, &info) == 0;
+    if(statted && info.st_size > 0) {
+      auto* const data = ::mmap(nullptr,
+                                static_cast<std::size_t>(info.st_size),
+                                PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE,
+                                fd,
+                                0);
+      if(data != MAP_FAILED) {
+        file.data_ = static_cast<Uint8*>(data);
+        file.size_ = static_cast<std::size_t>(info.st_size);
+      }
+    }
+    ::close(fd); // the mapping keeps the file alive
+    SDLRAII_COLD_IF(!statted || (info.st_size > 0 && !file.data_))
+      return sdl::Error{"MappedFile: could not map file"};
+#else
+    auto loaded = LoadFile(path);
+    SDLRAII_BAIL_ERROR(loaded);
+    file.size_ = loaded.get().size;
+    file.data_ = static_cast<Uint8*>(loaded.get().release());
+#endif
+    return file;
+  }
+
+  void reset() noexcept {
+    if(!data_) return;
+#ifdef SDLRAII_HAVE_MMAP
+    ::munmap(data_, size_);
+#else
+    SDL_free(data_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  Uint8* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  std::span<Uint8> bytes() const noexcept { return {data_, size_}; }
+  explicit operator bool() const noexcept { return data_ != nullptr; }
+
+ private:
+  Uint8* data_      = nullptr;
+  std::size_t size_ = 0;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_MAPPED_FILE_INCLUDE_GUARD
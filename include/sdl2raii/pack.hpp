@@ -0,0 +1,307 @@
+#ifndef SDLRAII_PACK_INCLUDE_GUARD
+#define SDLRAII_PACK_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sdl {
+
+/**
+ * The pack archive format. Everything is little-endian.
+ *
+ * | offset          | contents                                          |
+ * |-----------------+---------------------------------------------------|
+ * | 0               | magic, version, entry count, flags, the offsets   |
+ * | ~index_offset~  | ~entry_count~ index entries, sorted by hash, name |
+ * | ~names_offset~  | the entry names, concatenated                     |
+ * | entry ~offset~s | entry data, each aligned to ~alignment~           |
+ *
+ * Names are hashed with 64-bit FNV-1a. When ~flags::checksums~ is set every
+ * entry carries the CRC-32 of its data.
+ */
+namespace pack {
+inline constexpr char magic[4]           = {'S', 'P', 'A', 'K'};
+inline constexpr Uint32 version          = 1;
+inline constexpr std::size_t alignment   = 16;
+inline constexpr std::size_t header_size = 32;
+inline constexpr std::size_t entry_size  = 40;
+
+namespace flags {
+[[maybe_unused]] constexpr Uint32 checksums = 1;
+} // namespace flags
+
+/** An index entry. On disk the fields are followed by a reserved ~Uint32~. */
+struct Entry {
+  Uint64 hash;
+  Uint64 offset;
+  Uint64 size;
+  Uint32 name_offset;
+  Uint32 name_size;
+  Uint32 crc;
+};
+
+namespace impl {
+inline Uint32 get32(Uint8 const* const p) noexcept {
+  Uint32 v;
+  std::memcpy(&v, p, sizeof v);
+  return SDL_SwapLE32(v);
+}
+inline Uint64 get64(Uint8 const* const p) noexcept {
+  Uint64 v;
+  std::memcpy(&v, p, sizeof v);
+  return SDL_SwapLE64(v);
+}
+inline void put32(std::vector<Uint8>& out, Uint32 v) {
+  for(int i = 0; i < 4; ++i, v >>= 8) out.push_back(static_cast<Uint8>(v));
+}
+inline void put64(std::vector<Uint8>& out, Uint64 v) {
+  for(int i = 0; i < 8; ++i, v >>= 8) out.push_back(static_cast<Uint8>(v));
+}
+} // namespace impl
+} // namespace pack
+
+/**
+ * A pack archive, mapped once. Entries are looked up by binary search over
+ * the hash-sorted index and returned as views into the mapping, so reading an
+ * entry costs no system calls and no copies. Views stay valid as long as the
+ * ~Pack~ does.
+ */
+class Pack {
+ public:
+  static MayError<Pack> Open(char const* const path) noexcept {
+    auto opened = MappedFile::Open(path);
+    SDLRAII_BAIL_ERROR(opened);
+    Pack self;
+    self.file_       = std::move(opened.get());
+    auto const* data = self.file_.data();
+    auto const size  = self.file_.size();
+    SDLRAII_COLD_IF(size < pack::header_size
+                    || std::memcmp(data, pack::magic, sizeof pack::magic) != 0
+                    || pack::impl::get32(data + 4) != pack::version)
+      return sdl::Error{"Pack: not a pack archive"};
+    self.count_ = pack::impl::get32(data + 8);
+    self.flags_ = pack::impl::get32(data + 12);
+    auto const index_offset = pack::impl::get64(data + 16);
+    auto const names_offset = pack::impl::get64(data + 24);
+    SDLRAII_COLD_IF(index_offset > size
+                    || (size - index_offset) / pack::entry_size < self.count_
+                    || names_offset > size)
+      return sdl::Error{"Pack: truncated index"};
+    self.index_      = data + index_offset;
+    self.names_      = data + names_offset;
+    self.names_size_ = size - names_offset;
+    return self;
+  }
+
+  std::size_t size() const noexcept { return count_; }
+  bool has_checksums() const noexcept {
+    return flags_ & pack::flags::checksums;
+  }
+
+  pack::Entry entry(std::size_t const i) const noexcept {
+    auto const* const p = index_ + i * pack::entry_size;
+    return {pack::impl::get64(p),
+            pack::impl::get64(p + 8),
+            pack::impl::get64(p + 16),
+            pack::impl::get32(p + 24),
+            pack::impl::get32(p + 28),
+            pack::impl::get32(p + 32)};
+  }
+
+  /** The name of entry ~i~, or an empty view if the index is corrupt. */
+  std::string_view name(std::size_t const i) const noexcept {
+    auto const e = entry(i);
+    if(e.name_offset > names_size_ || names_size_ - e.name_offset < e.name_size)
+      return {};
+    return {reinterpret_cast<char const*>(names_ + e.name_offset), e.name_size};
+  }
+
+  /** The index of the entry named ~path~, or ~size()~ if there is none. */
+  std::size_t find(std::string_view const path) const noexcept {
+    auto const hash = impl::fnv1a(path);
+    std::size_t lo = 0, hi = count_;
+    while(lo < hi) {
+      auto const mid = lo + (hi - lo) / 2;
+      auto const h   = pack::impl::get64(index_ + mid * pack::entry_size);
+      if(h < hash || (h == hash && name(mid) < path))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo < count_ && name(lo) == path ? lo : count_;
+  }
+  bool contains(std::string_view const path) const noexcept {
+    return find(path) != count_;
+  }
+
+  /** The data of entry ~i~, checked against its checksum if ~verify~. */
+  MayError<std::span<Uint8 const>>
+      data(std::size_t const i, bool const verify = false) const noexcept {
+    auto const e = entry(i);
+    SDLRAII_COLD_IF(e.offset > file_.size()
+                    || file_.size() - e.offset < e.size)
+      return sdl::Error{"Pack: entry out of bounds"};
+    std::span<Uint8 const> const bytes{file_.data() + e.offset,
+                                       static_cast<std::size_t>(e.size)};
+    SDLRAII_COLD_IF(verify && has_checksums() && impl::crc32(bytes) != e.crc)
+      return sdl::Error{"Pack: checksum mismatch"};
+    return bytes;
+  }
+
+  /** Check every entry's checksum. */
+  MayError<void> verify() const noexcept {
+    for(std::size_t i = 0; i < count_; ++i) {
+      auto const d = data(i, true);
+      SDLRAII_BAIL_ERROR(d);
+    }
+    return {};
+  }
+
+ private:
+  Pack() = default;
+
+  MappedFile file_;
+  Uint8 const* index_     = nullptr;
+  Uint8 const* names_     = nullptr;
+  std::size_t names_size_ = 0;
+  std::size_t count_      = 0;
+  Uint32 flags_           = 0;
+};
+
+/** ~LoadFile~ for a pack entry: a view into the archive, not a copy. */
+inline MayError<std::span<Uint8 const>> LoadFile(Pack const& pack,
+                                                 std::string_view const path,
+                                                 bool const verify = false) {
+  auto const i = pack.find(path);
+  SDLRAII_COLD_IF(i == pack.size())
+    return sdl::Error{"Pack: no such entry"};
+  return pack.data(i, verify);
+}
+
+/** A read-only ~RWops~ over a pack entry, for APIs that take one. */
+inline MayError<UniqueRWops> RWFromFile(Pack const& pack,
+                                        std::string_view const path,
+                                        bool const verify = false) {
+  auto const bytes = LoadFile(pack, path, verify);
+  SDLRAII_BAIL_ERROR(bytes);
+  SDLRAII_COLD_IF(bytes.get().size() > INT_MAX)
+    return sdl::Error{"Pack: entry too large for RWFromConstMem"};
+  return RWFromConstMem(bytes.get().data(),
+                        static_cast<int>(bytes.get().size()));
+}
+
+/**
+ * Builds a pack archive. Entries are held in memory until ~write~; adding a
+ * path twice replaces the earlier data.
+ */
+class PackWriter {
+ public:
+  void add(std::string path, std::vector<Uint8> data) {
+    entries_.insert_or_assign(std::move(path), std::move(data));
+  }
+  void add(std::string path, std::span<Uint8 const> const data) {
+    add(std::move(path), std::vector<Uint8>(data.begin(), data.end()));
+  }
+  /** Add the contents of ~file~ under ~path~. */
+  MayError<void> add_file(std::string path, char const* const file) {
+    auto loaded = sdl::LoadFile(file);
+    SDLRAII_BAIL_ERROR(loaded);
+    auto const* const bytes = static_cast<Uint8 const*>(loaded.get().data);
+    add(std::move(path), std::span{bytes, loaded.get().size});
+    return {};
+  }
+
+  std::size_t size() const noexcept { return entries_.size(); }
+
+  MayError<void> write(RWops* const out, bool const checksums = true) const {
+    struct Sorted {
+      Uint64 hash;
+      std::string_view name;
+      std::vector<Uint8> const* data;
+    };
+    std::vector<Sorted> sorted;
+    sorted.reserve(entries_.size());
+    for(auto const& [name, data] : entries_)
+      sorted.push_back({impl::fnv1a(name), name, &data});
+    std::sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) {
+      return a.hash != b.hash ? a.hash < b.hash : a.name < b.name;
+    });
+
+    auto const index_offset = pack::header_size;
+    auto const names_offset = index_offset + sorted.size() * pack::entry_size;
+    std::size_t names_size  = 0;
+    for(auto const& e : sorted) names_size += e.name.size();
+    auto offset = align(names_offset + names_size);
+
+    std::vector<Uint8> head;
+    head.reserve(offset);
+    head.insert(head.end(), std::begin(pack::magic), std::end(pack::magic));
+    pack::impl::put32(head, pack::version);
+    pack::impl::put32(head, static_cast<Uint32>(sorted.size()));
+    pack::impl::put32(head, checksums ? pack::flags::checksums : 0);
+    pack::impl::put64(head, index_offset);
+    pack::impl::put64(head, names_offset);
+    Uint32 name_offset = 0;
+    for(auto const& e : sorted) {
+      pack::impl::put64(head, e.hash);
+      pack::impl::put64(head, offset);
+      pack::impl::put64(head, e.data->size());
+      pack::impl::put32(head, name_offset);
+      pack::impl::put32(head, static_cast<Uint32>(e.name.size()));
+      pack::impl::put32(head, checksums ? impl::crc32(*e.data) : 0);
+      pack::impl::put32(head, 0); // reserved
+      name_offset += static_cast<Uint32>(e.name.size());
+      offset = align(offset + e.data->size());
+    }
+    for(auto const& e : sorted)
+      head.insert(head.end(), e.name.begin(), e.name.end());
+    head.resize(align(head.size()));
+
+    SDLRAII_COLD_IF(SDL_RWwrite(out, head.data(), head.size(), 1) != 1)
+      return sdl::GetError();
+    static constexpr Uint8 padding[pack::alignment] = {};
+    for(auto const& e : sorted) {
+      auto const& d = *e.data;
+      SDLRAII_COLD_IF(!d.empty()
+                      && SDL_RWwrite(out, d.data(), d.size(), 1) != 1)
+        return sdl::GetError();
+      auto const pad = align(d.size()) - d.size();
+      SDLRAII_COLD_IF(pad && SDL_RWwrite(out, padding, pad, 1) != 1)
+        return sdl::GetError();
+    }
+    return {};
+  }
+  MayError<void> write(char const* const file,
+                       bool const checksums = true) const {
+    auto out = RWFromFile(file, "wb");
+    SDLRAII_BAIL_ERROR(out);
+    return write(out.get().get(), checksums);
+  }
+
+ private:
+  static constexpr std::size_t align(std::size_t const n) noexcept {
+    return (n + pack::alignment - 1) & ~(pack::alignment - 1);
+  }
+
+  std::map<std::string, std::vector<Uint8>, std::less<>> entries_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_PACK_INCLUDE_GUARD
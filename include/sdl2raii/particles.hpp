@@ -0,0 +1,305 @@
+#ifndef SDLRAII_PARTICLES_INCLUDE_GUARD
+#define SDLRAII_PARTICLES_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "compositor.hpp"
+#include "jobs.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#if defined(__AVX__)
+#  define SDLRAII_PARTICLES_AVX 1
+#  include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)                                      \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#  define SDLRAII_PARTICLES_SSE 1
+#  include <xmmintrin.h>
+#endif
+
+namespace sdl {
+
+struct Particle {
+  FPoint position{};
+  FPoint velocity{};
+  float life  = 1; // in seconds
+  rgba color = {255, 255, 255, 255};
+};
+
+namespace impl {
+/**
+ * One step of semi-implicit Euler over ~[first, last)~: velocity takes the
+ * acceleration, position the new velocity, and life counts down. ~true~ if
+ * any of them is left with no life.
+ */
+inline bool integrate_particles(float* const x,
+                                float* const y,
+                                float* const vx,
+                                float* const vy,
+                                float* const life,
+                                std::size_t first,
+                                std::size_t const last,
+                                FPoint const accel,
+                                float const dt) noexcept {
+#if defined(SDLRAII_PARTICLES_AVX)
+  auto const ax = _mm256_set1_ps(accel.x * dt);
+  auto const ay = _mm256_set1_ps(accel.y * dt);
+  auto const t  = _mm256_set1_ps(dt);
+  auto dead     = _mm256_setzero_ps();
+  for(; first + 8 <= last; first += 8) {
+    auto const u = _mm256_add_ps(_mm256_loadu_ps(vx + first), ax);
+    auto const v = _mm256_add_ps(_mm256_loadu_ps(vy + first), ay);
+    _mm256_storeu_ps(vx + first, u);
+    _mm256_storeu_ps(vy + first, v);
+    _mm256_storeu_ps(x + first,
+                     _mm256_add_ps(_mm256_loadu_ps(x + first),
+                                   _mm256_mul_ps(u, t)));
+    _mm256_storeu_ps(y + first,
+                     _mm256_add_ps(_mm256_loadu_ps(y + first),
+                                   _mm256_mul_ps(v, t)));
+    auto const l = _mm256_sub_ps(_mm256_loadu_ps(life + first), t);
+    _mm256_storeu_ps(life + first, l);
+    dead = _mm256_or_ps(dead,
+                        _mm256_cmp_ps(l, _mm256_setzero_ps(), _CMP_NGT_UQ));
+  }
+  auto died = _mm256_movemask_ps(dead) != 0;
+#elif defined(SDLRAII_PARTICLES_SSE)
+  auto const ax = _mm_set1_ps(accel.x * dt);
+  auto const ay = _mm_set1_ps(accel.y * dt);
+  auto const t  = _mm_set1_ps(dt);
+  auto dead     = _mm_setzero_ps();
+  for(; first + 4 <= last; first += 4) {
+    auto const u = _mm_add_ps(_mm_loadu_ps(vx + first), ax);
+    auto const v = _mm_add_ps(_mm_loadu_ps(vy + first), ay);
+    _mm_storeu_ps(vx + first, u);
+    _mm_storeu_ps(vy + first, v);
+    _mm_storeu_ps(x + first,
+                  _mm_add_ps(_mm_loadu_ps(x + first), _mm_mul_ps(u, t)));
+    _mm_storeu_ps(y + first,
+                  _mm_add_ps(_mm_loadu_ps(y + first), _mm_mul_ps(v, t)));
+    auto const l = _mm_sub_ps(_mm_loadu_ps(life + first), t);
+    _mm_storeu_ps(life + first, l);
+    dead = _mm_or_ps(dead, _mm_cmpngt_ps(l, _mm_setzero_ps()));
+  }
+  auto died = _mm_movemask_ps(dead) != 0;
+#else
+  auto died = false;
+#endif
+  for(; first < last; ++first) {
+    vx[first] += accel.x * dt;
+    vy[first] += accel.y * dt;
+    x[first] += vx[first] * dt;
+    y[first] += vy[first] * dt;
+    life[first] -= dt;
+    died = died || !(life[first] > 0);
+  }
+  return died;
+}
+} // namespace impl
+
+/**
+ * Many short-lived particles, stored as structure of arrays so the update is a
+ * SIMD loop over each field and drawing is one call.
+ *
+ * ~update~ integrates every particle under a shared acceleration, split
+ * across a ~JobSystem~ if given one, then removes the dead by moving the last
+ * particle into each hole; order is not kept. ~draw_points~ draws them all as
+ * points with one ~RenderDrawPointsF~ in the current draw color, and ~draw~ as
+ * textured quads with one ~RenderGeometry~, tinted by each particle's color
+ * and faded out over its last ~fade~ seconds. Both also draw into a
+ * ~Compositor~, points in a given color and quads of an ARGB8888 surface.
+ *
+ * Emitting past ~capacity~ drops the new particle, so the arrays never
+ * reallocate after construction.
+ */
+class ParticleSystem {
+ public:
+  // enough particles per job to amortize the spawn
+  static constexpr std::size_t parallel_grain = 16 * 1024;
+
+  explicit ParticleSystem(std::size_t const capacity) : capacity_{capacity} {
+    for(auto* field : {&x_, &y_, &vx_, &vy_, &life_}) field->reserve(capacity);
+    color_.reserve(capacity);
+  }
+
+  std::size_t size() const noexcept { return life_.size(); }
+  std::size_t capacity() const noexcept { return capacity_; }
+  bool empty() const noexcept { return life_.empty(); }
+
+  FPoint gravity() const noexcept { return gravity_; }
+  void set_gravity(FPoint const accel) noexcept { gravity_ = accel; }
+  float fade() const noexcept { return fade_; }
+  void set_fade(float const seconds) noexcept { fade_ = seconds; }
+
+  /** ~false~ if the system is full. */
+  bool emit(Particle const& p) {
+    if(size() == capacity_) return false;
+    x_.push_back(p.position.x);
+    y_.push_back(p.position.y);
+    vx_.push_back(p.velocity.x);
+    vy_.push_back(p.velocity.y);
+    life_.push_back(p.life);
+    color_.push_back(p.color);
+    return true;
+  }
+
+  void clear() noexcept {
+    for(auto* field : {&x_, &y_, &vx_, &vy_, &life_}) field->clear();
+    color_.clear();
+  }
+
+  /** Advance by ~dt~ seconds and drop the particles that died. */
+  void update(float const dt, JobSystem* const jobs = nullptr) {
+    // most steps kill nothing, and then there is nothing to compact
+    std::atomic<bool> died{false};
+    auto const step = [&](std::size_t const first, std::size_t const last) {
+      if(impl::integrate_particles(x_.data(),
+                                   y_.data(),
+                                   vx_.data(),
+                                   vy_.data(),
+                                   life_.data(),
+                                   first,
+                                   last,
+                                   gravity_,
+                                   dt))
+        died.store(true, std::memory_order_relaxed);
+    };
+    if(jobs != nullptr && size() > parallel_grain)
+      jobs->parallel_for(0, size(), parallel_grain, step);
+    else
+      step(0, size());
+    if(died.load(std::memory_order_relaxed)) compact();
+  }
+
+  /** Every particle as a point, in the current draw color. */
+  MayError<void> draw_points(Renderer* const renderer) {
+    if(empty()) return {};
+    auto const points = positions();
+    auto const drawn  = RenderDrawPoints(
+        renderer, points.data(), static_cast<int>(points.size()));
+    SDLRAII_BAIL_ERROR(drawn);
+    return {};
+  }
+
+  /** As above, in ~color~; a compositor has no draw color. */
+  MayError<void> draw_points(Compositor& compositor, rgba const color) {
+    if(empty()) return {};
+    compositor.points(positions(), color);
+    return {};
+  }
+
+  /** Every particle as a ~size~ by ~size~ quad of ~texture~ centred on it. */
+  MayError<void> draw(Renderer* const renderer,
+                      Texture* const texture,
+                      float const size,
+                      JobSystem* const jobs = nullptr) {
+    if(empty()) return {};
+    auto const drawn = RenderGeometry(
+        renderer, texture, quads(size, jobs), quad_indices());
+    SDLRAII_BAIL_ERROR(drawn);
+    return {};
+  }
+  MayError<void> draw(Compositor& compositor,
+                      Surface* const texture,
+                      float const size,
+                      JobSystem* const jobs = nullptr) {
+    if(empty()) return {};
+    auto const drawn =
+        compositor.geometry(texture, quads(size, jobs), quad_indices());
+    SDLRAII_BAIL_ERROR(drawn);
+    return {};
+  }
+
+  // the fields, for custom kernels; index ~i~ is one particle throughout
+  std::span<float> xs() noexcept { return x_; }
+  std::span<float> ys() noexcept { return y_; }
+  std::span<float> vxs() noexcept { return vx_; }
+  std::span<float> vys() noexcept { return vy_; }
+  std::span<float> lives() noexcept { return life_; }
+  std::span<rgba> colors() noexcept { return color_; }
+
+ private:
+  std::span<FPoint const> positions() {
+    points_.resize(size());
+    for(std::size_t i = 0; i < size(); ++i) points_[i] = {x_[i], y_[i]};
+    return points_;
+  }
+
+  std::span<Vertex const> quads(float const size, JobSystem* const jobs) {
+    auto const n = this->size();
+    vertices_.resize(n * 4);
+    auto const build = [&, half = size / 2](std::size_t const first,
+                                            std::size_t const last) {
+      auto const inv_fade = fade_ > 0 ? 1 / fade_ : 0.0f;
+      for(auto i = first; i < last; ++i) {
+        auto const [r, g, b, a] = color_[i];
+        auto const fade = fade_ > 0 ? std::min(life_[i] * inv_fade, 1.0f) : 1;
+        SDL_Color const tint{r, g, b, static_cast<Uint8>(a * fade)};
+        auto const x0 = x_[i] - half, y0 = y_[i] - half;
+        auto const x1 = x_[i] + half, y1 = y_[i] + half;
+        auto* const v = &vertices_[i * 4];
+        v[0] = {{x0, y0}, tint, {0, 0}};
+        v[1] = {{x1, y0}, tint, {1, 0}};
+        v[2] = {{x0, y1}, tint, {0, 1}};
+        v[3] = {{x1, y1}, tint, {1, 1}};
+      }
+    };
+    if(jobs != nullptr && n > parallel_grain)
+      jobs->parallel_for(0, n, parallel_grain, build);
+    else
+      build(0, n);
+    return vertices_;
+  }
+
+  std::span<int const> quad_indices() {
+    auto const n = size();
+    // split from top left to bottom right, which SDL's software renderer
+    // draws as one copy
+    for(auto q = indices_.size() / 6; q < n; ++q) {
+      auto const i = static_cast<int>(q * 4);
+      indices_.insert(indices_.end(), {i, i + 1, i + 3, i, i + 3, i + 2});
+    }
+    return {indices_.data(), n * 6};
+  }
+
+  void compact() noexcept {
+    auto n = size();
+    for(std::size_t i = 0; i < n;) {
+      if(life_[i] > 0) {
+        ++i;
+        continue;
+      }
+      --n;
+      x_[i]     = x_[n];
+      y_[i]     = y_[n];
+      vx_[i]    = vx_[n];
+      vy_[i]    = vy_[n];
+      life_[i]  = life_[n];
+      color_[i] = color_[n];
+    }
+    for(auto* field : {&x_, &y_, &vx_, &vy_, &life_}) field->resize(n);
+    color_.resize(n);
+  }
+
+  std::size_t capacity_;
+  FPoint gravity_{0, 0};
+  float fade_ = 0.5f;
+  std::vector<float> x_, y_, vx_, vy_, life_;
+  std::vector<rgba> color_;
+  // scratch for drawing
+  std::vector<FPoint> points_;
+  std::vector<Vertex> vertices_;
+  std::vector<int> indices_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_PARTICLES_INCLUDE_GUARD
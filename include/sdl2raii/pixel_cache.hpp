@@ -0,0 +1,198 @@
+#ifndef SDLRAII_PIXEL_CACHE_INCLUDE_GUARD
+#define SDLRAII_PIXEL_CACHE_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <utility>
+
+namespace sdl {
+
+/**
+ * A decoded surface, either reading its pixels straight out of a mapped cache
+ * file or owning them outright.
+ */
+struct CachedSurface {
+  MappedFile file; // empty unless the pixels live in the cache file
+  UniqueSurface surface;
+
+  Surface* get() const noexcept { return surface.get(); }
+  bool mapped() const noexcept { return static_cast<bool>(file); }
+};
+
+/**
+ * A disk cache of decoded images, stored already converted to one pixel
+ * format so loading one is an ~mmap~ instead of a decode and a conversion.
+ *
+ * Each source file gets one cache file in ~dir~, named by a hash of the source
+ * path. It holds a small header and then the pixel rows, starting on a page
+ * boundary. A cache file is used only if its header matches the source's
+ * current size and modification time, the format asked for, and the path;
+ * anything else counts as a miss and is rewritten. Files are written to a
+ * temporary name and renamed into place, so a crash never leaves a torn entry.
+ *
+ * Pick the renderer's preferred texture format (the first of
+ * ~SDL_RendererInfo::texture_formats~) so ~CreateTextureFromSurface~ has
+ * nothing left to convert either. Entries are native-endian and meant for the
+ * machine that wrote them.
+ */
+class PixelCache {
+ public:
+  using Loader = std::function<MayError<UniqueSurface>(char const*)>;
+
+  static constexpr std::size_t data_alignment = 4096;
+
+  struct Header {
+    std::array<char, 4> magic = {'S', 'P', 'X', 'C'};
+    Uint32 version            = 1;
+    Uint32 format             = 0;
+    Sint32 w = 0, h = 0, pitch = 0;
+    Uint64 source_size  = 0;
+    Sint64 source_mtime = 0;
+    Uint64 path_hash    = 0;
+    Uint64 data_offset  = data_alignment;
+
+    friend bool operator==(Header const&, Header const&) = default;
+  };
+
+  explicit PixelCache(
+      std::filesystem::path dir,
+      Uint32 const format = SDL_PIXELFORMAT_ARGB8888,
+      Loader loader = [](char const* const file) { return LoadBMP(file); })
+      : dir_{std::move(dir)}, format_{format}, loader_{std::move(loader)} {}
+
+  /**
+   * Load ~source~ in the cache's format, from the cache when it is fresh and
+   * by decoding and converting otherwise. A miss also writes the cache entry;
+   * failing to write it is not an error.
+   */
+  MayError<CachedSurface> load(char const* const source) {
+    std::error_code ec;
+    auto expected = stamp(source, ec);
+    SDLRAII_COLD_IF(ec)
+      return sdl::Error{"PixelCache: could not stat the source file"};
+    auto const entry = entry_path(expected.path_hash);
+
+    if(auto hit = map(entry, expected); hit.get()) {
+      ++hits_;
+      return hit;
+    }
+    ++misses_;
+
+    auto decoded = loader_(source);
+    SDLRAII_BAIL_ERROR(decoded);
+    auto converted = ConvertSurfaceFormat(decoded.get().get(), format_, 0);
+    SDLRAII_BAIL_ERROR(converted);
+    auto* const surface = converted.get().get();
+    expected.format     = format_;
+    expected.w          = surface->w;
+    expected.h          = surface->h;
+    expected.pitch      = surface->pitch;
+    store(entry, expected, surface);
+    return CachedSurface{{}, std::move(converted.get())};
+  }
+
+  std::filesystem::path const& dir() const noexcept { return dir_; }
+  Uint32 format() const noexcept { return format_; }
+  std::size_t hits() const noexcept { return hits_; }
+  std::size_t misses() const noexcept { return misses_; }
+
+ private:
+  /** The header fields that describe the source, for comparison. */
+  Header stamp(char const* const source, std::error_code& ec) const {
+    Header h;
+    std::filesystem::path const path{source};
+    h.source_size = std::filesystem::file_size(path, ec);
+    if(ec) return h;
+    h.source_mtime = static_cast<Sint64>(
+        std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+    h.path_hash = impl::fnv1a(source);
+    h.format    = format_;
+    return h;
+  }
+
+  std::filesystem::path entry_path(Uint64 const path_hash) const {
+    std::array<char, 17> name{};
+    SDL_snprintf(name.data(),
+                 name.size(),
+                 "%016llx",
+                 static_cast<unsigned long long>(path_hash));
+    return dir_ / (std::string{name.data()} + ".pxc");
+  }
+
+  CachedSurface map(std::filesystem::path const& entry,
+                    Header const& expected) const {
+    auto opened = MappedFile::Open(entry.string().c_str());
+    if(!opened.ok()) return {};
+    auto file = std::move(opened.get());
+    Header h;
+    if(file.size() < sizeof h) return {};
+    std::memcpy(&h, file.data(), sizeof h);
+    auto const rows =
+        static_cast<std::size_t>(h.pitch) * static_cast<std::size_t>(h.h);
+    auto fresh = h;
+    fresh.w = fresh.h = fresh.pitch = 0;
+    fresh.data_offset               = data_alignment;
+    if(fresh != expected || h.w <= 0 || h.h <= 0
+       || h.pitch < h.w * static_cast<int>(SDL_BYTESPERPIXEL(h.format))
+       || h.data_offset + rows > file.size())
+      return {};
+    auto surface = CreateRGBSurfaceWithFormatFrom(file.data() + h.data_offset,
+                                                  h.w,
+                                                  h.h,
+                                                  SDL_BITSPERPIXEL(h.format),
+                                                  h.pitch,
+                                                  h.format);
+    if(!surface.ok()) return {};
+    return CachedSurface{std::move(file), std::move(surface.get())};
+  }
+
+  void store(std::filesystem::path const& entry,
+             Header const& h,
+             Surface* const surface) const {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    auto temp = entry;
+    temp += ".tmp";
+    bool written = false;
+    {
+      auto out = RWFromFile(temp.string().c_str(), "wb");
+      if(!out.ok()) return;
+      auto* const rw = out.get().get();
+      std::array<Uint8, data_alignment> page{};
+      std::memcpy(page.data(), &h, sizeof h);
+      auto const rows =
+          static_cast<std::size_t>(h.pitch) * static_cast<std::size_t>(h.h);
+      // ~ConvertSurfaceFormat~ results are never RLE, so the rows are in place
+      written = SDL_RWwrite(rw, page.data(), page.size(), 1) == 1
+             && SDL_RWwrite(rw, surface->pixels, rows, 1) == 1;
+    }
+    if(written) std::filesystem::rename(temp, entry, ec);
+    if(!written || ec) std::filesystem::remove(temp, ec);
+  }
+
+  std::filesystem::path dir_;
+  Uint32 format_;
+  Loader loader_;
+  std::size_t hits_   = 0;
+  std::size_t misses_ = 0;
+};
+
+static_assert(sizeof(PixelCache::Header) <= PixelCache::data_alignment);
+
+} // namespace sdl
+
+#endif // SDLRAII_PIXEL_CACHE_INCLUDE_GUARD
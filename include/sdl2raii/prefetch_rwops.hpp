@@ -0,0 +1,311 @@
+#ifndef SDLRAII_PREFETCH_RWOPS_INCLUDE_GUARD
+#define SDLRAII_PREFETCH_RWOPS_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "thread.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+
+/**
+ * Counters for a ~PrefetchRWops~. A stall is a read that found nothing
+ * prefetched and had to wait for the background thread.
+ */
+struct PrefetchStats {
+  std::atomic<Uint64> stalls{0};
+  std::atomic<Uint64> stall_ns{0};
+  std::atomic<Uint64> bytes_fetched{0};
+  std::atomic<Uint64> chunks_discarded{0}; // fetched, then dropped by a seek
+  std::atomic<Uint64> refills{0};          // seeks that restarted the fetch
+};
+
+/**
+ * A read-only stream that reads ahead of its consumer on a background thread,
+ * so sequential reads of a large file (music, replays, video) rarely wait for
+ * the disk.
+ *
+ * The thread keeps up to ~depth~ chunks of ~chunk_size~ bytes read ahead.
+ * Seeking inside a chunk already fetched costs nothing; any other seek
+ * cancels the read-ahead and restarts it at the new position. ~size~ is
+ * measured once, when the stream is created.
+ *
+ * The inner stream belongs to the background thread from then on. Wrap the
+ * whole thing with ~RWFromObject~ to hand it to SDL loaders; keep ~stats()~
+ * first if the counters are wanted afterwards.
+ */
+class PrefetchRWops {
+ public:
+  static constexpr std::size_t default_chunk_size = 256 * 1024;
+  static constexpr std::size_t default_depth      = 4;
+
+  static MayError<PrefetchRWops>
+      Create(UniqueRWops inner,
+             std::size_t const chunk_size = default_chunk_size,
+             std::size_t const depth      = default_depth) {
+    auto state        = std::make_unique<State>();
+    state->chunk_size = std::max<std::size_t>(chunk_size, 1);
+    state->depth      = std::max<std::size_t>(depth, 1);
+    state->size       = SDL_RWsize(inner.get());
+    auto const at     = SDL_RWtell(inner.get());
+    state->fetch_at   = at < 0 ? 0 : at;
+    state->position   = state->fetch_at;
+    state->inner.reset(inner.release());
+    // one more buffer than ~depth~, for the chunk the consumer is reading
+    for(std::size_t i = 0; i <= state->depth; ++i) {
+      state->buffers.emplace_back(new Uint8[state->chunk_size]);
+      state->free.push_back(i);
+    }
+    auto mutex = CreateMutex();
+    SDLRAII_BAIL_ERROR(mutex);
+    state->mutex.reset(mutex.get().release());
+    auto cond    = CreateCond();
+    SDLRAII_BAIL_ERROR(cond);
+    state->cond.reset(cond.get().release());
+
+    auto* const s = state.get();
+    auto thread =
+        CreateThread("sdl2raii prefetch", [s] { return prefetch_loop(*s); });
+    SDLRAII_BAIL_ERROR(thread);
+    state->thread.reset(thread.get().release());
+    return PrefetchRWops{std::move(state)};
+  }
+
+  PrefetchRWops(PrefetchRWops&&) noexcept = default;
+  PrefetchRWops(PrefetchRWops const&) = delete;
+  PrefetchRWops& operator=(PrefetchRWops const&) = delete;
+  ~PrefetchRWops() {
+    if(!state_) return;
+    {
+      LockGuard const lock{state_->mutex.get()};
+      state_->quit = true;
+      static_cast<void>(CondBroadcast(state_->cond.get()));
+    }
+    state_->thread.reset(); // joins
+  }
+
+  Sint64 size() const noexcept { return state_->size; }
+  Sint64 tell() const noexcept { return state_->position; }
+
+  std::size_t
+      read(void* const dst, std::size_t const size, std::size_t const n) {
+    if(size == 0 || n == 0) return 0;
+    auto& s         = *state_;
+    auto const want = size * n;
+    auto* const out = static_cast<Uint8*>(dst);
+    std::size_t got = 0;
+    while(got < want) {
+      if(s.has_current) {
+        auto const& c = s.current;
+        auto const cursor = static_cast<std::size_t>(s.position - c.offset);
+        if(auto const k = std::min(c.size - cursor, want - got); k > 0) {
+          std::memcpy(out + got, s.buffers[c.buffer].get() + cursor, k);
+          got += k;
+          s.position += static_cast<Sint64>(k);
+          continue;
+        }
+      }
+      if(!next_chunk()) break;
+    }
+    return got / size;
+  }
+
+  /** Like ~SDL_RWseek~. Returns the new position, or -1 on error. */
+  Sint64 seek(Sint64 const offset, int const whence) {
+    auto& s = *state_;
+    Sint64 target;
+    switch(whence) {
+      case RW_SEEK_SET: target = offset; break;
+      case RW_SEEK_CUR: target = s.position + offset; break;
+      case RW_SEEK_END:
+        SDLRAII_COLD_IF(s.size < 0)
+          return SDL_SetError("PrefetchRWops: size unknown");
+        target = s.size + offset;
+        break;
+      default: return SDL_SetError("PrefetchRWops: unknown seek origin");
+    }
+    SDLRAII_COLD_IF(target < 0)
+      return SDL_SetError("PrefetchRWops: seek before start");
+    if(s.has_current && s.current.contains(target)) {
+      s.position = target;
+      return target;
+    }
+
+    LockGuard const lock{s.mutex.get()};
+    release_current();
+    auto const hit = std::find_if(s.ready.begin(),
+                                  s.ready.end(),
+                                  [&](Chunk const& c) {
+                                    return c.contains(target);
+                                  });
+    if(hit != s.ready.end()) {
+      // skip forward through what is already fetched
+      for(auto it = s.ready.begin(); it != hit; ++it)
+        s.free.push_back(it->buffer);
+      s.stats->chunks_discarded.fetch_add(hit - s.ready.begin(),
+                                          std::memory_order_relaxed);
+      s.current     = *hit;
+      s.has_current = true;
+      s.ready.erase(s.ready.begin(), hit + 1);
+    } else {
+      for(auto const& c : s.ready) s.free.push_back(c.buffer);
+      s.stats->chunks_discarded.fetch_add(s.ready.size(),
+                                          std::memory_order_relaxed);
+      s.stats->refills.fetch_add(1, std::memory_order_relaxed);
+      s.ready.clear();
+      ++s.generation;
+      s.fetch_at     = target;
+      s.seek_pending = true;
+      s.eof          = false;
+    }
+    s.position = target;
+    static_cast<void>(CondBroadcast(s.cond.get()));
+    return target;
+  }
+
+  std::size_t chunk_size() const noexcept { return state_->chunk_size; }
+  std::size_t depth() const noexcept { return state_->depth; }
+  std::shared_ptr<PrefetchStats const> stats() const noexcept {
+    return state_->stats;
+  }
+
+ private:
+  struct Chunk {
+    std::size_t buffer = 0;
+    Sint64 offset      = 0;
+    std::size_t size   = 0;
+
+    bool contains(Sint64 const at) const noexcept {
+      return at >= offset && at <= offset + static_cast<Sint64>(size);
+    }
+  };
+
+  struct State {
+    UniqueRWops inner;
+    Sint64 size            = -1;
+    std::size_t chunk_size = 0;
+    std::size_t depth      = 0;
+    std::vector<std::unique_ptr<Uint8[]>> buffers;
+    std::shared_ptr<PrefetchStats> stats = std::make_shared<PrefetchStats>();
+
+    // guarded by ~mutex~
+    UniqueMutex mutex;
+    UniqueCond cond;
+    std::vector<std::size_t> free;
+    std::deque<Chunk> ready; // in file order, starting at ~position~
+    Sint64 fetch_at     = 0; // where the next chunk starts
+    Uint64 generation   = 0; // bumped by every cancelling seek
+    bool seek_pending   = false;
+    bool eof            = false;
+    bool quit           = false;
+
+    // consumer only
+    Sint64 position  = 0;
+    Chunk current;
+    bool has_current = false;
+
+    UniqueThread thread; // last, so it is joined before the rest goes
+  };
+
+  explicit PrefetchRWops(std::unique_ptr<State> state) noexcept
+      : state_{std::move(state)} {}
+
+  /** Under the lock: give the consumer's chunk back to the thread. */
+  void release_current() noexcept {
+    auto& s = *state_;
+    if(!s.has_current) return;
+    s.free.push_back(s.current.buffer);
+    s.has_current = false;
+  }
+
+  /** Wait for the chunk at ~position~. ~false~ at end of file. */
+  bool next_chunk() {
+    auto& s = *state_;
+    LockGuard const lock{s.mutex.get()};
+    release_current();
+    static_cast<void>(CondBroadcast(s.cond.get()));
+    if(s.ready.empty() && !s.eof) {
+      auto const start = SDL_GetPerformanceCounter();
+      while(s.ready.empty() && !s.eof)
+        static_cast<void>(CondWait(s.cond.get(), lock));
+      auto const ticks = SDL_GetPerformanceCounter() - start;
+      s.stats->stalls.fetch_add(1, std::memory_order_relaxed);
+      s.stats->stall_ns.fetch_add(
+          static_cast<Uint64>(static_cast<double>(ticks) * 1e9
+                              / static_cast<double>(
+                                  SDL_GetPerformanceFrequency())),
+          std::memory_order_relaxed);
+    }
+    if(s.ready.empty()) return false;
+    s.current     = s.ready.front();
+    s.has_current = true;
+    s.ready.pop_front();
+    return true;
+  }
+
+  static int prefetch_loop(State& s) {
+    for(;;) {
+      std::size_t buffer = 0;
+      Sint64 at;
+      Uint64 generation;
+      bool seek;
+      {
+        LockGuard const lock{s.mutex.get()};
+        while(!s.quit && !s.seek_pending
+              && (s.eof || s.free.empty() || s.ready.size() >= s.depth))
+          static_cast<void>(CondWait(s.cond.get(), lock));
+        if(s.quit) return 0;
+        generation = s.generation;
+        at         = s.fetch_at;
+        seek       = std::exchange(s.seek_pending, false);
+        if(!seek) {
+          buffer = s.free.back();
+          s.free.pop_back();
+        }
+      }
+
+      if(seek) {
+        SDLRAII_COLD_IF(SDL_RWseek(s.inner.get(), at, RW_SEEK_SET) < 0) {
+          LockGuard const lock{s.mutex.get()};
+          if(generation == s.generation) s.eof = true;
+          static_cast<void>(CondBroadcast(s.cond.get()));
+        }
+        continue;
+      }
+
+      auto const n =
+          SDL_RWread(s.inner.get(), s.buffers[buffer].get(), 1, s.chunk_size);
+      LockGuard const lock{s.mutex.get()};
+      if(generation != s.generation || n == 0) {
+        s.free.push_back(buffer);
+        if(generation != s.generation)
+          s.stats->chunks_discarded.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        s.ready.push_back({buffer, at, n});
+        s.fetch_at += static_cast<Sint64>(n);
+        s.stats->bytes_fetched.fetch_add(n, std::memory_order_relaxed);
+      }
+      // a short read is end of file or an error; either way, stop here
+      if(generation == s.generation && n < s.chunk_size) s.eof = true;
+      static_cast<void>(CondBroadcast(s.cond.get()));
+    }
+  }
+
+  std::unique_ptr<State> state_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_PREFETCH_RWOPS_INCLUDE_GUARD
@@ -0,0 +1,175 @@
+#ifndef SDLRAII_RENDER_TARGET_INCLUDE_GUARD
+#define SDLRAII_RENDER_TARGET_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+
+/**
+ * Makes a texture the render target and puts the previous target back when it
+ * goes out of scope, so early returns can't leave rendering redirected.
+ * Nest them freely; each restores exactly what it replaced.
+ */
+class ScopedRenderTarget {
+ public:
+  ScopedRenderTarget(ScopedRenderTarget&& other) noexcept
+      : renderer_{std::exchange(other.renderer_, nullptr)},
+        previous_{other.previous_} {}
+  ScopedRenderTarget(ScopedRenderTarget const&) = delete;
+  ScopedRenderTarget& operator=(ScopedRenderTarget const&) = delete;
+  ~ScopedRenderTarget() {
+    if(renderer_) SDL_SetRenderTarget(renderer_, previous_);
+  }
+
+  Renderer* renderer() const noexcept { return renderer_; }
+  /** The target that will be restored. ~nullptr~ is the window. */
+  Texture* previous() const noexcept { return previous_; }
+
+ private:
+  ScopedRenderTarget(Renderer* const renderer, Texture* const previous) noexcept
+      : renderer_{renderer}, previous_{previous} {}
+
+  friend MayError<ScopedRenderTarget> ScopedSetRenderTarget(Renderer*,
+                                                            Texture*) noexcept;
+
+  Renderer* renderer_;
+  Texture* previous_;
+};
+
+/** Pass ~nullptr~ to render to the window for the guard's lifetime. */
+inline MayError<ScopedRenderTarget>
+    ScopedSetRenderTarget(Renderer* const renderer,
+                          Texture* const target) noexcept {
+  auto* const previous = SDL_GetRenderTarget(renderer);
+  SDLRAII_COLD_IF(SDL_SetRenderTarget(renderer, target) != 0)
+    return sdl::GetError();
+  return ScopedRenderTarget{renderer, previous};
+}
+
+/**
+ * Recycles render-target textures so post effects and cached layers don't
+ * create and destroy textures every frame.
+ *
+ * ~acquire~ hands out an idle texture with the same format, access and size if
+ * there is one, and creates a texture otherwise. ~release~ gives it back.
+ * Contents are not cleared in between. Call ~end_frame~ once per frame: idle
+ * textures unused for ~max_idle_frames~ are destroyed, and the pool never
+ * keeps more than ~max_idle_bytes~ of idle textures, dropping the least
+ * recently released first. Textures on loan don't count toward the cap.
+ *
+ * Pools hold a few dozen textures at most, so idle textures live in one vector
+ * ordered by release time and lookups are a linear scan.
+ */
+class RenderTargetPool {
+ public:
+  static constexpr std::size_t default_max_idle_bytes = 64u << 20;
+  static constexpr Uint64 default_max_idle_frames     = 120;
+
+  struct Key {
+    Uint32 format;
+    int access;
+    int w, h;
+
+    friend bool operator==(Key const&, Key const&) = default;
+  };
+
+  explicit RenderTargetPool(
+      Renderer* const renderer,
+      std::size_t const max_idle_bytes = default_max_idle_bytes,
+      Uint64 const max_idle_frames     = default_max_idle_frames) noexcept
+      : renderer_{renderer},
+        max_idle_bytes_{max_idle_bytes},
+        max_idle_frames_{max_idle_frames} {}
+
+  MayError<UniqueTexture> acquire(Key const key) noexcept {
+    // newest first: the most recently used texture is likeliest to be warm
+    for(auto it = idle_.rbegin(); it != idle_.rend(); ++it) {
+      if(it->key != key) continue;
+      UniqueTexture texture{it->texture.release()};
+      idle_bytes_ -= it->bytes;
+      idle_.erase(std::next(it).base());
+      ++hits_;
+      return texture;
+    }
+    ++misses_;
+    return CreateTexture(renderer_, key.format, key.access, key.w, key.h);
+  }
+  MayError<UniqueTexture>
+      acquire(Uint32 const format, int const w, int const h) noexcept {
+    return acquire(Key{format, texture::access_target, w, h});
+  }
+
+  /** Return a texture. Textures SDL can't describe are just destroyed. */
+  void release(UniqueTexture texture) {
+    if(!texture) return;
+    auto const info = QueryTexture(texture.get());
+    if(!info.ok()) return;
+    auto const& [format, access, w, h] = info.get();
+    auto const bytes = static_cast<std::size_t>(w) * static_cast<std::size_t>(h)
+                     * SDL_BYTESPERPIXEL(format);
+    idle_.push_back(
+        Entry{std::move(texture), Key{format, access, w, h}, bytes, frame_});
+    idle_bytes_ += bytes;
+    trim(max_idle_bytes_);
+  }
+
+  /** Age the pool by one frame and destroy textures idle for too long. */
+  void end_frame() {
+    ++frame_;
+    auto const stale = std::find_if(idle_.begin(), idle_.end(), [&](auto& e) {
+      return frame_ - e.released <= max_idle_frames_;
+    });
+    for(auto it = idle_.begin(); it != stale; ++it) idle_bytes_ -= it->bytes;
+    idle_.erase(idle_.begin(), stale);
+  }
+
+  /** Destroy every idle texture. */
+  void clear() noexcept {
+    idle_.clear();
+    idle_bytes_ = 0;
+  }
+
+  std::size_t idle_count() const noexcept { return idle_.size(); }
+  std::size_t idle_bytes() const noexcept { return idle_bytes_; }
+  std::size_t hits() const noexcept { return hits_; }
+  std::size_t misses() const noexcept { return misses_; }
+
+ private:
+  struct Entry {
+    // the ~unique_ptr~ base, since ~UniqueTexture~ isn't move-assignable
+    UniqueTexture::unique_ptr texture;
+    Key key;
+    std::size_t bytes;
+    Uint64 released;
+  };
+
+  void trim(std::size_t const limit) {
+    auto it = idle_.begin();
+    for(; it != idle_.end() && idle_bytes_ > limit; ++it)
+      idle_bytes_ -= it->bytes;
+    idle_.erase(idle_.begin(), it);
+  }
+
+  Renderer* renderer_;
+  std::vector<Entry> idle_;
+  std::size_t idle_bytes_ = 0;
+  std::size_t max_idle_bytes_;
+  Uint64 max_idle_frames_;
+  Uint64 frame_       = 0;
+  std::size_t hits_   = 0;
+  std::size_t misses_ = 0;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_RENDER_TARGET_INCLUDE_GUARD
@@ -0,0 +1,429 @@
+#ifndef SDLRAII_REPLAY_INCLUDE_GUARD
+#define SDLRAII_REPLAY_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+namespace impl {
+
+/**
+ * The wire format shared by ~InputRecorder~ and ~InputPlayer~.
+ *
+ * A stream is the magic bytes "SDLR", a version byte, then one record per
+ * event: the frame delta since the previous record and the event type as
+ * varints, then a per-type payload. Integers are LEB128 varints, signed ones
+ * zigzagged first. Mouse positions are stored relative to the previous mouse
+ * event, so ordinary motion costs a few bytes per event.
+ */
+namespace replay {
+inline constexpr std::array<Uint8, 4> magic = {'S', 'D', 'L', 'R'};
+inline constexpr Uint8 version              = 1;
+
+constexpr Uint32 zigzag(Sint32 const v) noexcept {
+  return (static_cast<Uint32>(v) << 1) ^ static_cast<Uint32>(v >> 31);
+}
+constexpr Sint32 unzigzag(Uint32 const v) noexcept {
+  return static_cast<Sint32>(v >> 1) ^ -static_cast<Sint32>(v & 1);
+}
+
+/** Which event types are recorded; everything else is dropped. */
+constexpr bool recorded(Uint32 const type) noexcept {
+  switch(type) {
+    case SDL_QUIT:
+    case SDL_WINDOWEVENT:
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+    case SDL_TEXTINPUT:
+    case SDL_MOUSEMOTION:
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+    case SDL_MOUSEWHEEL:
+    case SDL_CONTROLLERAXISMOTION:
+    case SDL_CONTROLLERBUTTONDOWN:
+    case SDL_CONTROLLERBUTTONUP: return true;
+    default: return false;
+  }
+}
+
+class Writer {
+ public:
+  explicit Writer(std::vector<Uint8>& out) noexcept : out_{out} {}
+  void u8(Uint8 const v) { out_.push_back(v); }
+  void u(Uint64 v) {
+    while(v >= 0x80) {
+      out_.push_back(static_cast<Uint8>(v | 0x80));
+      v >>= 7;
+    }
+    out_.push_back(static_cast<Uint8>(v));
+  }
+  void s(Sint32 const v) { u(zigzag(v)); }
+  void f32(float const v) {
+    auto const bits = std::bit_cast<Uint32>(v);
+    for(int i = 0; i < 4; ++i)
+      out_.push_back(static_cast<Uint8>(bits >> 8 * i));
+  }
+  void bytes(void const* const p, std::size_t const n) {
+    auto const* const b = static_cast<Uint8 const*>(p);
+    out_.insert(out_.end(), b, b + n);
+  }
+
+ private:
+  std::vector<Uint8>& out_;
+};
+
+class Reader {
+ public:
+  Reader(Uint8 const* const data, std::size_t const size) noexcept
+      : at_{data}, end_{data + size} {}
+  bool empty() const noexcept { return at_ == end_; }
+  bool failed() const noexcept { return failed_; }
+
+  Uint8 u8() noexcept {
+    SDLRAII_COLD_IF(at_ == end_) {
+      failed_ = true;
+      return 0;
+    }
+    return *at_++;
+  }
+  Uint64 u() noexcept {
+    Uint64 v = 0;
+    for(int shift = 0; shift < 64; shift += 7) {
+      auto const b = u8();
+      v |= Uint64{b & 0x7fu} << shift;
+      if(!(b & 0x80)) return v;
+    }
+    failed_ = true;
+    return v;
+  }
+  Sint32 s() noexcept { return unzigzag(static_cast<Uint32>(u())); }
+  float f32() noexcept {
+    Uint32 bits = 0;
+    for(int i = 0; i < 4; ++i) bits |= Uint32{u8()} << 8 * i;
+    return std::bit_cast<float>(bits);
+  }
+  void bytes(void* const p, std::size_t const n) noexcept {
+    SDLRAII_COLD_IF(static_cast<std::size_t>(end_ - at_) < n) {
+      failed_ = true;
+      at_     = end_;
+      return;
+    }
+    std::memcpy(p, at_, n);
+    at_ += n;
+  }
+
+ private:
+  Uint8 const* at_;
+  Uint8 const* end_;
+  bool failed_ = false;
+};
+
+/** State both sides track to delta-encode mouse positions. */
+struct Context {
+  Sint32 mouse_x = 0, mouse_y = 0;
+
+  void encode_mouse(Writer& w, Sint32 const x, Sint32 const y) {
+    w.s(x - std::exchange(mouse_x, x));
+    w.s(y - std::exchange(mouse_y, y));
+  }
+  void decode_mouse(Reader& r, Sint32& x, Sint32& y) noexcept {
+    x = mouse_x += r.s();
+    y = mouse_y += r.s();
+  }
+
+  void encode(Writer& w, Event const& e) {
+    switch(e.type) {
+      case SDL_QUIT: break;
+      case SDL_WINDOWEVENT:
+        w.u(e.window.windowID);
+        w.u8(e.window.event);
+        w.s(e.window.data1);
+        w.s(e.window.data2);
+        break;
+      case SDL_KEYDOWN:
+      case SDL_KEYUP:
+        w.u(e.key.windowID);
+        w.u(static_cast<Uint32>(e.key.keysym.scancode));
+        w.s(e.key.keysym.sym);
+        w.u(e.key.keysym.mod);
+        w.u8(e.key.repeat);
+        break;
+      case SDL_TEXTINPUT: {
+        auto const* const text = e.text.text;
+        auto const n           = static_cast<std::size_t>(
+            std::find(text, std::end(e.text.text), '\0') - text);
+        w.u(e.text.windowID);
+        w.u8(static_cast<Uint8>(n));
+        w.bytes(e.text.text, n);
+        break;
+      }
+      case SDL_MOUSEMOTION:
+        w.u(e.motion.windowID);
+        w.u(e.motion.which);
+        w.u(e.motion.state);
+        encode_mouse(w, e.motion.x, e.motion.y);
+        w.s(e.motion.xrel);
+        w.s(e.motion.yrel);
+        break;
+      case SDL_MOUSEBUTTONDOWN:
+      case SDL_MOUSEBUTTONUP:
+        w.u(e.button.windowID);
+        w.u(e.button.which);
+        w.u8(e.button.button);
+        w.u8(e.button.clicks);
+        encode_mouse(w, e.button.x, e.button.y);
+        break;
+      case SDL_MOUSEWHEEL:
+        w.u(e.wheel.windowID);
+        w.u(e.wheel.which);
+        w.s(e.wheel.x);
+        w.s(e.wheel.y);
+        w.u(e.wheel.direction);
+        w.f32(e.wheel.preciseX);
+        w.f32(e.wheel.preciseY);
+        break;
+      case SDL_CONTROLLERAXISMOTION:
+        w.s(e.caxis.which);
+        w.u8(e.caxis.axis);
+        w.s(e.caxis.value);
+        break;
+      case SDL_CONTROLLERBUTTONDOWN:
+      case SDL_CONTROLLERBUTTONUP:
+        w.s(e.cbutton.which);
+        w.u8(e.cbutton.button);
+        break;
+    }
+  }
+
+  /** Fills in ~e~, whose type is already set. */
+  void decode(Reader& r, Event& e) noexcept {
+    switch(e.type) {
+      case SDL_QUIT: break;
+      case SDL_WINDOWEVENT:
+        e.window.windowID = static_cast<Uint32>(r.u());
+        e.window.event    = r.u8();
+        e.window.data1    = r.s();
+        e.window.data2    = r.s();
+        break;
+      case SDL_KEYDOWN:
+      case SDL_KEYUP:
+        e.key.windowID        = static_cast<Uint32>(r.u());
+        e.key.keysym.scancode = static_cast<SDL_Scancode>(r.u());
+        e.key.keysym.sym      = r.s();
+        e.key.keysym.mod      = static_cast<Uint16>(r.u());
+        e.key.repeat          = r.u8();
+        e.key.state = e.type == SDL_KEYDOWN ? SDL_PRESSED : SDL_RELEASED;
+        break;
+      case SDL_TEXTINPUT: {
+        e.text.windowID = static_cast<Uint32>(r.u());
+        auto const n    = std::min<std::size_t>(r.u8(),
+                                             sizeof e.text.text - 1);
+        r.bytes(e.text.text, n);
+        e.text.text[n] = '\0';
+        break;
+      }
+      case SDL_MOUSEMOTION:
+        e.motion.windowID = static_cast<Uint32>(r.u());
+        e.motion.which    = static_cast<Uint32>(r.u());
+        e.motion.state    = static_cast<Uint32>(r.u());
+        decode_mouse(r, e.motion.x, e.motion.y);
+        e.motion.xrel = r.s();
+        e.motion.yrel = r.s();
+        break;
+      case SDL_MOUSEBUTTONDOWN:
+      case SDL_MOUSEBUTTONUP:
+        e.button.windowID = static_cast<Uint32>(r.u());
+        e.button.which    = static_cast<Uint32>(r.u());
+        e.button.button   = r.u8();
+        e.button.clicks   = r.u8();
+        e.button.state =
+            e.type == SDL_MOUSEBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED;
+        decode_mouse(r, e.button.x, e.button.y);
+        break;
+      case SDL_MOUSEWHEEL:
+        e.wheel.windowID  = static_cast<Uint32>(r.u());
+        e.wheel.which     = static_cast<Uint32>(r.u());
+        e.wheel.x         = r.s();
+        e.wheel.y         = r.s();
+        e.wheel.direction = static_cast<Uint32>(r.u());
+        e.wheel.preciseX  = r.f32();
+        e.wheel.preciseY  = r.f32();
+        break;
+      case SDL_CONTROLLERAXISMOTION:
+        e.caxis.which = r.s();
+        e.caxis.axis  = r.u8();
+        e.caxis.value = static_cast<Sint16>(r.s());
+        break;
+      case SDL_CONTROLLERBUTTONDOWN:
+      case SDL_CONTROLLERBUTTONUP:
+        e.cbutton.which  = r.s();
+        e.cbutton.button = r.u8();
+        e.cbutton.state =
+            e.type == SDL_CONTROLLERBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED;
+        break;
+    }
+  }
+};
+} // namespace replay
+} // namespace impl
+
+/**
+ * Records the events a game consumes, frame by frame, into a compact binary
+ * stream that ~InputPlayer~ can inject again.
+ *
+ * Use its ~NextEvent~ in place of ~sdl::NextEvent~ (or pass each event to
+ * ~record~) and call ~end_frame~ once per frame. Records are buffered and
+ * written in blocks; ~flush~ (or destruction) writes the rest. Only input,
+ * window and quit events are kept.
+ *
+ * Records are delta-encoded, so a lost block would garble everything after
+ * it. When a write fails, recording stops, and every later ~flush~ returns
+ * an error (while still trying to write what was buffered).
+ */
+class InputRecorder {
+ public:
+  static constexpr std::size_t block_size = 4096;
+
+  explicit InputRecorder(UniqueRWops out) : out_{std::move(out)} {
+    buffer_.reserve(block_size * 2);
+    buffer_.insert(buffer_.end(),
+                   impl::replay::magic.begin(),
+                   impl::replay::magic.end());
+    buffer_.push_back(impl::replay::version);
+  }
+  InputRecorder(InputRecorder&&) = default;
+  ~InputRecorder() {
+    if(out_) flush();
+  }
+
+  std::optional<Event> NextEvent() {
+    auto e = sdl::NextEvent();
+    if(e) record(*e);
+    return e;
+  }
+
+  void record(Event const& e) {
+    if(failed_ || !impl::replay::recorded(e.type)) return;
+    impl::replay::Writer w{buffer_};
+    w.u(frame_ - std::exchange(last_frame_, frame_));
+    w.u(e.type);
+    context_.encode(w, e);
+    // a failed write is latched and reported by the next ~flush~
+    if(buffer_.size() >= block_size) (void)flush();
+  }
+
+  void end_frame() noexcept { ++frame_; }
+  Uint64 frame() const noexcept { return frame_; }
+  /** Whether a write failed and recording stopped. */
+  bool failed() const noexcept { return failed_; }
+
+  MayError<void> flush() noexcept {
+    if(!buffer_.empty()) {
+      auto const written =
+          SDL_RWwrite(out_.get(), buffer_.data(), 1, buffer_.size());
+      // keep what didn't go out, so a later flush can still finish it
+      buffer_.erase(buffer_.begin(),
+                    buffer_.begin() + static_cast<std::ptrdiff_t>(written));
+      SDLRAII_COLD_IF(!buffer_.empty() && !failed_) {
+        failed_ = true;
+        return sdl::GetError();
+      }
+    }
+    SDLRAII_COLD_IF(failed_)
+      return sdl::Error{"InputRecorder: a write failed; recording stopped"};
+    return {};
+  }
+
+ private:
+  UniqueRWops out_;
+  std::vector<Uint8> buffer_;
+  impl::replay::Context context_;
+  Uint64 frame_      = 0;
+  Uint64 last_frame_ = 0;
+  bool failed_       = false;
+};
+
+/**
+ * Plays back a stream from ~InputRecorder~ with ~SDL_PushEvent~.
+ *
+ * Call ~pump~ once per frame, before draining the event queue: it pushes the
+ * events recorded for the current frame and moves to the next one. The whole
+ * stream is read up front so playback does no I/O. For reproducible
+ * benchmarks run under the dummy video driver (~UseDummyVideoDriver~ before
+ * ~Init~) so no real input mixes in.
+ */
+class InputPlayer {
+ public:
+  static MayError<InputPlayer> Load(RWops* const src) noexcept {
+    auto file = LoadFile_RW(src);
+    SDLRAII_BAIL_ERROR(file);
+    auto data       = std::move(file).success();
+    auto const size = data.size;
+    InputPlayer player{static_cast<Uint8*>(data.release()), size};
+    impl::replay::Reader header{player.data_.get(), size};
+    std::array<Uint8, impl::replay::magic.size()> magic{};
+    header.bytes(magic.data(), magic.size());
+    SDLRAII_COLD_IF(magic != impl::replay::magic
+                    || header.u8() != impl::replay::version)
+      return sdl::Error{"InputPlayer: not a replay stream"};
+    player.reader_ = header;
+    player.next_   = player.reader_.u();
+    return player;
+  }
+  static auto Load(UniqueRWops src) SDLRAII_BODY_EXP(Load(src.get()))
+
+  /** Push this frame's events. Returns how many were pushed. */
+  MayError<int> pump() noexcept {
+    int pushed = 0;
+    while(!done() && next_ == 0) {
+      Event e{};
+      e.type = static_cast<Uint32>(reader_.u());
+      context_.decode(reader_, e);
+      SDLRAII_COLD_IF(reader_.failed())
+        return sdl::Error{"InputPlayer: truncated replay stream"};
+      SDLRAII_COLD_IF(SDL_PushEvent(&e) < 0)
+        return sdl::GetError();
+      ++pushed;
+      next_ = reader_.empty() ? 0 : reader_.u();
+    }
+    if(next_ > 0) --next_;
+    ++frame_;
+    return pushed;
+  }
+
+  bool done() const noexcept { return reader_.empty() || reader_.failed(); }
+  Uint64 frame() const noexcept { return frame_; }
+
+ private:
+  struct Free {
+    void operator()(Uint8* const p) const noexcept { SDL_free(p); }
+  };
+
+  InputPlayer(Uint8* const data, std::size_t const size) noexcept
+      : data_{data}, reader_{data, size} {}
+
+  std::unique_ptr<Uint8, Free> data_;
+  impl::replay::Reader reader_;
+  impl::replay::Context context_;
+  Uint64 next_  = 0; // frames until the next record
+  Uint64 frame_ = 0;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_REPLAY_INCLUDE_GUARD
@@ -0,0 +1,378 @@
+#ifndef SDLRAII_SCALE_INCLUDE_GUARD
+#define SDLRAII_SCALE_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "jobs.hpp"
+#include "surface_pool.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)                                       \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SDLRAII_SCALE_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+namespace sdl {
+
+enum class scale_filter : Uint8 {
+  nearest,
+  bilinear,
+  area, // the average of the pixels each one covers; for shrinking
+};
+
+namespace impl {
+/** The source index whose centre is nearest output pixel ~i~'s. */
+inline int nearest_tap(int const i, int const src, int const dst) noexcept {
+  return static_cast<int>((Sint64{i} * 2 + 1) * src / (Sint64{dst} * 2));
+}
+
+/** Two neighbours and the second's weight, in 256ths. */
+struct BilinearTap {
+  int first, second;
+  Uint32 weight;
+};
+
+inline std::vector<BilinearTap> bilinear_taps(int const src, int const dst) {
+  std::vector<BilinearTap> taps(static_cast<std::size_t>(dst));
+  auto const scale = static_cast<double>(src) / dst;
+  for(int i = 0; i < dst; ++i) {
+    // pixel centres line up, and the edges repeat outwards
+    auto const f = std::clamp((i + 0.5) * scale - 0.5, 0.0, src - 1.0);
+    auto const first  = static_cast<int>(f);
+    auto const second = std::min(first + 1, src - 1);
+    auto const weight = static_cast<Uint32>(std::lround((f - first) * 256));
+    auto& tap = taps[static_cast<std::size_t>(i)];
+    tap = weight == 256 ? BilinearTap{second, second, 0}
+                        : BilinearTap{first, second, weight};
+  }
+  return taps;
+}
+
+/** For each output index, the source run it covers and how much of each. */
+struct AreaTaps {
+  std::vector<int> first;
+  std::vector<std::size_t> offset; // into ~weights~, one past the end too
+  std::vector<float> weights;
+};
+
+inline AreaTaps area_taps(int const src, int const dst) {
+  AreaTaps taps;
+  taps.first.reserve(static_cast<std::size_t>(dst));
+  taps.offset.reserve(static_cast<std::size_t>(dst) + 1);
+  auto const scale = static_cast<double>(src) / dst;
+  for(int i = 0; i < dst; ++i) {
+    auto const start = i * scale, end = (i + 1) * scale;
+    auto const first = static_cast<int>(start);
+    auto const last  = std::min(static_cast<int>(std::ceil(end)), src);
+    taps.first.push_back(first);
+    taps.offset.push_back(taps.weights.size());
+    for(auto j = first; j < last; ++j) {
+      auto const covered = std::min(end, j + 1.0) - std::max(start, 1.0 * j);
+      taps.weights.push_back(static_cast<float>(covered / scale));
+    }
+  }
+  taps.offset.push_back(taps.weights.size());
+  return taps;
+}
+
+/** ~out = a * (256 - weight) + b * weight~ for each of ~n~ bytes. */
+inline void lerp_rows(Uint8 const* const a,
+                      Uint8 const* const b,
+                      Uint16* const out,
+                      std::size_t const n,
+                      Uint32 const weight) noexcept {
+  std::size_t i = 0;
+#ifdef SDLRAII_SCALE_SSE2
+  auto const zero = _mm_setzero_si128();
+  auto const wa   = _mm_set1_epi16(static_cast<short>(256 - weight));
+  auto const wb   = _mm_set1_epi16(static_cast<short>(weight));
+  for(; i + 16 <= n; i += 16) {
+    auto const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+    auto const y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + i));
+    // at most 255 * 256, so the sums fit in 16 bits
+    auto const lo =
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(x, zero), wa),
+                      _mm_mullo_epi16(_mm_unpacklo_epi8(y, zero), wb));
+    auto const hi =
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(x, zero), wa),
+                      _mm_mullo_epi16(_mm_unpackhi_epi8(y, zero), wb));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), hi);
+  }
+#endif
+  for(; i < n; ++i)
+    out[i] = static_cast<Uint16>(a[i] * (256 - weight) + b[i] * weight);
+}
+
+/** ~acc += row * weight~ for each of ~n~ bytes. */
+inline void accumulate_row(Uint8 const* const row,
+                           float* const acc,
+                           std::size_t const n,
+                           float const weight) noexcept {
+  std::size_t i = 0;
+#ifdef SDLRAII_SCALE_SSE2
+  auto const zero = _mm_setzero_si128();
+  auto const w    = _mm_set1_ps(weight);
+  // four ints to floats, scaled and added to ~out~
+  auto const add = [&](float* const out, __m128i const ints) {
+    auto const x = _mm_mul_ps(_mm_cvtepi32_ps(ints), w);
+    _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), x));
+  };
+  for(; i + 16 <= n; i += 16) {
+    auto const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + i));
+    auto const lo = _mm_unpacklo_epi8(x, zero);
+    auto const hi = _mm_unpackhi_epi8(x, zero);
+    add(acc + i, _mm_unpacklo_epi16(lo, zero));
+    add(acc + i + 4, _mm_unpackhi_epi16(lo, zero));
+    add(acc + i + 8, _mm_unpacklo_epi16(hi, zero));
+    add(acc + i + 12, _mm_unpackhi_epi16(hi, zero));
+  }
+#endif
+  for(; i < n; ++i) acc[i] += static_cast<float>(row[i]) * weight;
+}
+
+/**
+ * A row of ~n~ output pixels from ~lerp_rows~' result, each blending the
+ * two four-channel pixels its tap picks:
+ * ~(a * (256 - weight) + b * weight + 32768) >> 16~ per channel. The SIMD
+ * path forms the same 32-bit products from 16-bit halves, two pixels at a
+ * time.
+ */
+inline void lerp_columns(Uint16 const* const mixed,
+                         BilinearTap const* const taps,
+                         std::size_t const n,
+                         Uint8* const out) noexcept {
+  std::size_t x = 0;
+#ifdef SDLRAII_SCALE_SSE2
+  auto const pixels = [&](int const first, int const second) {
+    auto const at = [&](int const i) {
+      return _mm_loadl_epi64(reinterpret_cast<__m128i const*>(
+          mixed + static_cast<std::size_t>(i) * 4));
+    };
+    return _mm_unpacklo_epi64(at(first), at(second));
+  };
+  // ~a * w~ as four 32-bit lanes for each of the two pixels
+  auto const products = [](__m128i const a, __m128i const w, __m128i& lo,
+                           __m128i& hi) {
+    auto const low  = _mm_mullo_epi16(a, w);
+    auto const high = _mm_mulhi_epu16(a, w);
+    lo              = _mm_unpacklo_epi16(low, high);
+    hi              = _mm_unpackhi_epi16(low, high);
+  };
+  auto const half = _mm_set1_epi32(32768);
+  for(; x + 2 <= n; x += 2) {
+    auto const& t0 = taps[x];
+    auto const& t1 = taps[x + 1];
+    auto const wb  = _mm_unpacklo_epi64(
+        _mm_set1_epi16(static_cast<short>(t0.weight)),
+        _mm_set1_epi16(static_cast<short>(t1.weight)));
+    auto const wa = _mm_sub_epi16(_mm_set1_epi16(256), wb);
+    __m128i a0, a1, b0, b1;
+    products(pixels(t0.first, t1.first), wa, a0, a1);
+    products(pixels(t0.second, t1.second), wb, b0, b1);
+    auto const round = [&](__m128i const a, __m128i const b) {
+      return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(a, b), half), 16);
+    };
+    auto const r0 = round(a0, b0);
+    auto const r1 = round(a1, b1);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4),
+                     _mm_packus_epi16(_mm_packs_epi32(r0, r1), r0));
+  }
+#endif
+  for(; x < n; ++x) {
+    auto const& t       = taps[x];
+    auto const* const a = mixed + static_cast<std::size_t>(t.first) * 4;
+    auto const* const b = mixed + static_cast<std::size_t>(t.second) * 4;
+    for(int c = 0; c < 4; ++c)
+      out[x * 4 + c] = static_cast<Uint8>(
+          (a[c] * (256 - t.weight) + b[c] * t.weight + 32768) >> 16);
+  }
+}
+
+/**
+ * One output pixel from ~n~ of ~accumulate_row~'s four-channel pixels at
+ * ~in~, weighted by ~weights~, summed in order and rounded.
+ */
+inline void weigh_pixel(float const* in,
+                        float const* const weights,
+                        std::size_t const n,
+                        Uint8* const out) noexcept {
+#ifdef SDLRAII_SCALE_SSE2
+  auto sum = _mm_setzero_ps();
+  for(std::size_t k = 0; k < n; ++k, in += 4)
+    sum = _mm_add_ps(sum,
+                     _mm_mul_ps(_mm_loadu_ps(in), _mm_set1_ps(weights[k])));
+  auto const clamped = _mm_min_ps(
+      _mm_max_ps(_mm_add_ps(sum, _mm_set1_ps(0.5f)), _mm_setzero_ps()),
+      _mm_set1_ps(255.0f));
+  auto const zero  = _mm_setzero_si128();
+  auto const bytes = _mm_packus_epi16(
+      _mm_packs_epi32(_mm_cvttps_epi32(clamped), zero), zero);
+  auto const pixel = static_cast<Uint32>(_mm_cvtsi128_si32(bytes));
+  std::memcpy(out, &pixel, 4);
+#else
+  float sum[4] = {};
+  for(std::size_t k = 0; k < n; ++k, in += 4)
+    for(int c = 0; c < 4; ++c) sum[c] += in[c] * weights[k];
+  for(int c = 0; c < 4; ++c)
+    out[c] = static_cast<Uint8>(std::clamp(sum[c] + 0.5f, 0.0f, 255.0f));
+#endif
+}
+
+inline Uint8* byte_row(Surface* const surface, int const y) noexcept {
+  return static_cast<Uint8*>(surface->pixels) + y * surface->pitch;
+}
+
+inline void scale_nearest(Surface* const src,
+                          Surface* const dst,
+                          std::vector<int> const& xs,
+                          int const first,
+                          int const last) noexcept {
+  for(auto y = first; y < last; ++y) {
+    auto const* const in = reinterpret_cast<Uint32 const*>(
+        byte_row(src, nearest_tap(y, src->h, dst->h)));
+    auto* const out = reinterpret_cast<Uint32*>(byte_row(dst, y));
+    for(std::size_t x = 0; x < xs.size(); ++x) out[x] = in[xs[x]];
+  }
+}
+
+/** Blend two source rows into one, then neighbours along it. */
+inline void scale_bilinear(Surface* const src,
+                           Surface* const dst,
+                           std::vector<BilinearTap> const& xs,
+                           std::vector<BilinearTap> const& ys,
+                           int const first,
+                           int const last) {
+  auto const bytes = static_cast<std::size_t>(src->w) * 4;
+  std::vector<Uint16> mixed(bytes);
+  for(auto y = first; y < last; ++y) {
+    auto const& ty = ys[static_cast<std::size_t>(y)];
+    lerp_rows(byte_row(src, ty.first),
+              byte_row(src, ty.second),
+              mixed.data(),
+              bytes,
+              ty.weight);
+    lerp_columns(mixed.data(), xs.data(), xs.size(), byte_row(dst, y));
+  }
+}
+
+/** Sum the covered source rows, then the covered pixels along the sum. */
+inline void scale_area(Surface* const src,
+                       Surface* const dst,
+                       AreaTaps const& xs,
+                       AreaTaps const& ys,
+                       int const first,
+                       int const last) {
+  auto const bytes = static_cast<std::size_t>(src->w) * 4;
+  std::vector<float> acc(bytes);
+  for(auto y = first; y < last; ++y) {
+    auto const row = static_cast<std::size_t>(y);
+    std::fill(acc.begin(), acc.end(), 0.0f);
+    for(auto k = ys.offset[row]; k < ys.offset[row + 1]; ++k)
+      accumulate_row(
+          byte_row(src, ys.first[row] + static_cast<int>(k - ys.offset[row])),
+          acc.data(),
+          bytes,
+          ys.weights[k]);
+    auto* const out = byte_row(dst, y);
+    for(int x = 0; x < dst->w; ++x) {
+      auto const col = static_cast<std::size_t>(x);
+      weigh_pixel(&acc[static_cast<std::size_t>(xs.first[col]) * 4],
+                  &xs.weights[xs.offset[col]],
+                  xs.offset[col + 1] - xs.offset[col],
+                  out + x * 4);
+    }
+  }
+}
+} // namespace impl
+
+/**
+ * ~src~ resized to ~w~ by ~h~, in a surface from ~pool~ of the same format.
+ *
+ * ~nearest~ picks the source pixel nearest each output pixel's centre.
+ * ~bilinear~ blends the four around it in 8-bit fixed point, for
+ * enlarging and mild shrinking. ~area~ averages every source pixel an output
+ * pixel covers, weighted by how much of it is covered, so shrinking by any
+ * factor doesn't alias; use it for thumbnails. Both filters are separable:
+ * each output row is one SIMD pass down the source rows it needs, then one
+ * pass along the result.
+ *
+ * Every 32-bit format works, its channels treated alike; filtering
+ * straight alpha bleeds the color of clear pixels a little into their
+ * neighbours, as ~SDL_SoftStretchLinear~ does. With ~jobs~, output rows are
+ * split between its threads.
+ */
+inline MayError<UniqueSurface> ScaleSurface(
+    SurfacePool& pool,
+    Surface* const src,
+    int const w,
+    int const h,
+    scale_filter const filter = scale_filter::bilinear,
+    JobSystem* const jobs     = nullptr) {
+  SDLRAII_COLD_IF(src == nullptr || src->format == nullptr
+                  || src->format->BytesPerPixel != 4)
+    return sdl::Error{"ScaleSurface: needs a 32-bit surface"};
+  SDLRAII_COLD_IF(w <= 0 || h <= 0 || src->w <= 0 || src->h <= 0)
+    return sdl::Error{"ScaleSurface: empty size"};
+  auto made = pool.acquire(src->format->format, w, h);
+  SDLRAII_BAIL_ERROR(made);
+  auto out = std::move(made).success();
+  auto const must_lock = SDL_MUSTLOCK(src);
+  if(must_lock) {
+    auto const locked = LockSurface(src);
+    SDLRAII_BAIL_ERROR(locked);
+  }
+  auto* const dst = out.get();
+  auto const run = [&](auto const& rows) {
+    if(jobs != nullptr && h > 1)
+      jobs->parallel_for(0, static_cast<std::size_t>(h), rows);
+    else
+      rows(std::size_t{0}, static_cast<std::size_t>(h));
+  };
+  switch(filter) {
+    case scale_filter::nearest: {
+      std::vector<int> xs(static_cast<std::size_t>(w));
+      for(int x = 0; x < w; ++x)
+        xs[static_cast<std::size_t>(x)] = impl::nearest_tap(x, src->w, w);
+      run([&](std::size_t const first, std::size_t const last) {
+        impl::scale_nearest(
+            src, dst, xs, static_cast<int>(first), static_cast<int>(last));
+      });
+      break;
+    }
+    case scale_filter::bilinear: {
+      auto const xs = impl::bilinear_taps(src->w, w);
+      auto const ys = impl::bilinear_taps(src->h, h);
+      run([&](std::size_t const first, std::size_t const last) {
+        impl::scale_bilinear(
+            src, dst, xs, ys, static_cast<int>(first), static_cast<int>(last));
+      });
+      break;
+    }
+    case scale_filter::area: {
+      auto const xs = impl::area_taps(src->w, w);
+      auto const ys = impl::area_taps(src->h, h);
+      run([&](std::size_t const first, std::size_t const last) {
+        impl::scale_area(
+            src, dst, xs, ys, static_cast<int>(first), static_cast<int>(last));
+      });
+      break;
+    }
+  }
+  if(must_lock) UnlockSurface(src);
+  return out;
+}
+
+} // namespace sdl
+
+#endif // SDLRAII_SCALE_INCLUDE_GUARD
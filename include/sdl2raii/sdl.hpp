@@ -13,6 +13,7 @@
 #include <memory>
 #include <tuple>
 #include <optional>
+#include <span>
 
 namespace sdl {
 
@@ -82,6 +83,14 @@ SDLRAII_WRAP_FN(WriteBE64, );
 SDLRAII_WRAP_TYPE(Surface);
 SDLRAII_DEFUNIQUE(Surface, SDL_FreeSurface);
 SDLRAII_WRAP_MAKER(UniqueSurface, LoadBMP);
+SDLRAII_WRAP_MAKER(UniqueSurface, CreateRGBSurfaceWithFormat);
+SDLRAII_WRAP_MAKER(UniqueSurface, CreateRGBSurfaceWithFormatFrom);
+SDLRAII_WRAP_MAKER(UniqueSurface, ConvertSurfaceFormat);
+SDLRAII_WRAP_FN(SaveBMP, nonzero_error);
+SDLRAII_WRAP_FN(LockSurface, nonzero_error);
+SDLRAII_WRAP_FN(UnlockSurface, );
+SDLRAII_WRAP_FN(BlitSurface, nonzero_error);
+SDLRAII_WRAP_FN(HasColorKey, );
 
 SDLRAII_WRAP_FN(SetSurfaceBlendMode, nonzero_error);
 SDLRAII_WRAP_FN(SetSurfaceAlphaMod, nonzero_error);
@@ -118,7 +127,9 @@ SDLRAII_DEFUNIQUE(Texture, SDL_DestroyTexture);
 
 SDLRAII_WRAP_MAKER(UniqueWindow, CreateWindow);
 SDLRAII_WRAP_MAKER(UniqueRenderer, CreateRenderer);
+SDLRAII_WRAP_MAKER(UniqueRenderer, CreateSoftwareRenderer);
 SDLRAII_WRAP_MAKER(UniqueTexture, CreateTextureFromSurface);
+SDLRAII_WRAP_MAKER(UniqueTexture, CreateTexture);
 
 template<class T>
 inline auto CreateWindowFrom(T* data) SDLRAII_BODY_EXP(
@@ -133,6 +144,33 @@ inline sdl::MayError<UniqueTexture>
   return CreateTextureFromSurface(renderer, surface.get());
 }
 
+namespace texture {
+[[maybe_unused]] constexpr int access_static    = SDL_TEXTUREACCESS_STATIC;
+[[maybe_unused]] constexpr int access_streaming = SDL_TEXTUREACCESS_STREAMING;
+[[maybe_unused]] constexpr int access_target    = SDL_TEXTUREACCESS_TARGET;
+} // namespace texture
+
+struct TextureInfo {
+  Uint32 format;
+  int access;
+  int w, h;
+};
+
+/** Returns the texture's attributes instead of using out parameters. */
+inline MayError<TextureInfo> QueryTexture(Texture* const texture) noexcept {
+  TextureInfo info;
+  SDLRAII_COLD_IF(
+      SDL_QueryTexture(texture, &info.format, &info.access, &info.w, &info.h)
+      != 0)
+    return sdl::GetError();
+  return info;
+}
+
+SDLRAII_WRAP_FN(RenderTargetSupported, );
+SDLRAII_WRAP_FN(SetRenderTarget, nonzero_error);
+SDLRAII_WRAP_FN(GetRenderTarget, );
+SDLRAII_WRAP_FN(RenderReadPixels, nonzero_error);
+
 inline Point GetRendererOutputSize(Renderer * const renderer){
   // i believe GetRendererOutputSize doesn't modify renderer, but isn't marked const
   Point p;
@@ -326,6 +364,8 @@ SDLRAII_WRAP_RGB_SETTER(SetTextureColorMod);
 SDLRAII_WRAP_RGB_GETTER(GetTextureColorMod);
 
 SDLRAII_WRAP_FN(SetWindowIcon, );
+SDLRAII_WRAP_FN(GetWindowSurface, );
+SDLRAII_WRAP_FN(UpdateWindowSurface, nonzero_error);
 
 SDLRAII_WRAP_FN(RenderClear, nonzero_error);
 // couldn't find the error in the doc comment
@@ -389,11 +429,41 @@ inline sdl::FPoint RenderGetScale(sdl::Renderer* renderer) noexcept {
   return {sx, sy};
 }
 
+// geometry, since SDL 2.0.18
+SDLRAII_WRAP_TYPE(Vertex);
+SDLRAII_WRAP_FN(RenderGeometry, nonzero_error);
+/** Draw triangles; without ~indices~, every three vertices are one. */
+inline auto RenderGeometry(Renderer* const renderer,
+                           Texture* const texture,
+                           std::span<Vertex const> const vertices,
+                           std::span<int const> const indices = {})
+    SDLRAII_BODY_EXP(
+        RenderGeometry(renderer,
+                       texture,
+                       vertices.data(),
+                       static_cast<int>(vertices.size()),
+                       indices.empty() ? nullptr : indices.data(),
+                       static_cast<int>(indices.size())));
+
 SDLRAII_WRAP_FN(Init, nonzero_error);
 SDLRAII_WRAP_FN(Quit, );
 
-struct Quitter {
-  ~Quitter() { sdl::Quit(); }
+/**
+ * Quits on destruction. Move-only, and only the last owner quits, so passing
+ * it through a ~MayError~ doesn't quit early.
+ */
+class Quitter {
+ public:
+  Quitter() = default;
+  Quitter(Quitter&& other) noexcept
+      : engaged_{std::exchange(other.engaged_, false)} {}
+  Quitter& operator=(Quitter&&) = delete;
+  ~Quitter() {
+    if(engaged_) sdl::Quit();
+  }
+
+ private:
+  bool engaged_ = true;
 };
 
 namespace init {
@@ -409,7 +479,23 @@ using type                                      = Uint32;
 [[maybe_unused]] constexpr flags everything     = SDL_INIT_EVERYTHING;
 } // namespace init
 
-[[nodiscard]] MayError<Quitter>
+// hints must usually be set before ~Init~
+// https://wiki.libsdl.org/CategoryHints
+SDLRAII_WRAP_FN(SetHint, );
+namespace hint {
+[[maybe_unused]] constexpr auto videodriver   = SDL_HINT_VIDEODRIVER;
+[[maybe_unused]] constexpr auto render_driver = SDL_HINT_RENDER_DRIVER;
+} // namespace hint
+
+/**
+ * Select SDL's dummy video driver, for tests and CI without a display. Call
+ * before ~Init~.
+ */
+inline bool UseDummyVideoDriver() noexcept {
+  return SetHint(hint::videodriver, "dummy");
+}
+
+[[nodiscard]] inline MayError<Quitter>
     ScopedInit(init::flags subsystems = {}) noexcept {
   auto const result = sdl::Init(subsystems);
   SDLRAII_BAIL_ERROR(result);
@@ -417,6 +503,7 @@ using type                                      = Uint32;
 }
 
 SDLRAII_WRAP_TYPE(Event);
+SDLRAII_WRAP_FN(PushEvent, );
 inline bool HasNextEvent() noexcept { return SDL_PollEvent(nullptr); }
 inline std::optional<sdl::Event> NextEvent() noexcept {
   Event e;
@@ -0,0 +1,420 @@
+#ifndef SDLRAII_SHAPES_INCLUDE_GUARD
+#define SDLRAII_SHAPES_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "compositor.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <span>
+#include <vector>
+
+namespace sdl {
+
+enum class line_join : Uint8 { miter, bevel, round };
+enum class line_cap : Uint8 { butt, square, round };
+
+struct LineStyle {
+  float width       = 1;
+  line_join join    = line_join::miter;
+  line_cap cap      = line_cap::butt;
+  float miter_limit = 4; // miters longer than this times the width are beveled
+};
+
+namespace impl {
+inline FPoint operator+(FPoint const a, FPoint const b) noexcept {
+  return {a.x + b.x, a.y + b.y};
+}
+inline FPoint operator-(FPoint const a, FPoint const b) noexcept {
+  return {a.x - b.x, a.y - b.y};
+}
+inline FPoint operator*(FPoint const a, float const k) noexcept {
+  return {a.x * k, a.y * k};
+}
+inline float dot(FPoint const a, FPoint const b) noexcept {
+  return a.x * b.x + a.y * b.y;
+}
+inline float cross(FPoint const a, FPoint const b) noexcept {
+  return a.x * b.y - a.y * b.x;
+}
+inline float length(FPoint const a) noexcept { return std::hypot(a.x, a.y); }
+
+/** Segments for a curve of radius ~r~ that stays within a quarter pixel. */
+inline int curve_segments(float const r, float const radians) noexcept {
+  constexpr float tolerance = 0.25f;
+  if(r <= tolerance) return 3;
+  auto const step = 2 * std::acos(1 - tolerance / r);
+  return std::clamp(static_cast<int>(std::ceil(std::abs(radians) / step)),
+                    3,
+                    256);
+}
+
+/** Does ~p~ lie in the counterclockwise triangle ~a b c~, edges included? */
+inline bool in_triangle(FPoint const p,
+                        FPoint const a,
+                        FPoint const b,
+                        FPoint const c) noexcept {
+  return cross(b - a, p - a) >= 0 && cross(c - b, p - b) >= 0
+      && cross(a - c, p - c) >= 0;
+}
+} // namespace impl
+
+/**
+ * Shapes tessellated into triangles, to be drawn with one ~RenderGeometry~.
+ *
+ * Each shape call appends vertices, in their own colors, to the batch; ~draw~
+ * submits the whole batch and leaves it intact, so a batch of static shapes
+ * can be built once and drawn every frame, or merged into the frame's batch
+ * with ~append~ at an offset. ~clear~ starts over, keeping the storage.
+ *
+ * Curves use as many segments as keep them within a quarter pixel of the
+ * true curve. Thick lines are drawn as overlapping segment quads plus join
+ * geometry, so translucent colors show the overlap at corners.
+ */
+class ShapeBatch {
+ public:
+  void clear() noexcept {
+    vertices_.clear();
+    indices_.clear();
+  }
+  bool empty() const noexcept { return indices_.empty(); }
+  std::span<Vertex const> vertices() const noexcept { return vertices_; }
+  std::span<int const> indices() const noexcept { return indices_; }
+
+  /** Draw the batch, textured if ~texture~ is given. The batch is kept. */
+  MayError<void> draw(Renderer* const renderer,
+                      Texture* const texture = nullptr) const {
+    if(empty()) return {};
+    auto const drawn = RenderGeometry(renderer,
+                                      texture,
+                                      std::span<Vertex const>{vertices_},
+                                      std::span<int const>{indices_});
+    SDLRAII_BAIL_ERROR(drawn);
+    return {};
+  }
+  MayError<void> draw(Compositor& compositor,
+                      Surface* const texture = nullptr) const {
+    if(empty()) return {};
+    auto const drawn = compositor.geometry(texture, vertices_, indices_);
+    SDLRAII_BAIL_ERROR(drawn);
+    return {};
+  }
+
+  /** Copy another batch in, moved by ~offset~. */
+  void append(ShapeBatch const& other, FPoint const offset = {0, 0}) {
+    auto const base = static_cast<int>(vertices_.size());
+    for(auto v : other.vertices_) {
+      v.position.x += offset.x;
+      v.position.y += offset.y;
+      vertices_.push_back(v);
+    }
+    for(auto const i : other.indices_) indices_.push_back(base + i);
+  }
+
+  void triangle(FPoint const a,
+                FPoint const b,
+                FPoint const c,
+                rgba const color) {
+    auto const col = to_color(color);
+    tri(vertex(a, col), vertex(b, col), vertex(c, col));
+  }
+
+  void fill_rect(FRect const r, rgba const color) {
+    auto const col = to_color(color);
+    auto const i = vertex({r.x, r.y}, col);
+    vertex({r.x + r.w, r.y}, col);
+    vertex({r.x, r.y + r.h}, col);
+    vertex({r.x + r.w, r.y + r.h}, col);
+    quad(i, i + 1, i + 2, i + 3);
+  }
+
+  void line(FPoint const a,
+            FPoint const b,
+            rgba const color,
+            LineStyle const& style = {}) {
+    FPoint const points[] = {a, b};
+    polyline(points, color, style);
+  }
+
+  /** Connected line segments, closed back to the start if ~closed~. */
+  void polyline(std::span<FPoint const> const input,
+                rgba const color,
+                LineStyle const& style = {},
+                bool const closed = false) {
+    using namespace impl;
+    // drop repeated points, which have no direction
+    points_.clear();
+    for(auto const p : input)
+      if(points_.empty() || length(p - points_.back()) > 1e-4f)
+        points_.push_back(p);
+    if(closed && points_.size() > 2
+       && length(points_.front() - points_.back()) <= 1e-4f)
+      points_.pop_back();
+    auto const n = points_.size();
+    if(n < 2) return;
+    auto const col      = to_color(color);
+    auto const hw       = style.width / 2;
+    auto const segments = closed ? n : n - 1;
+    for(std::size_t s = 0; s < segments; ++s) {
+      auto a       = points_[s];
+      auto b       = points_[(s + 1) % n];
+      auto const d = (b - a) * (1 / length(b - a));
+      if(!closed && style.cap == line_cap::square) {
+        if(s == 0) a = a - d * hw;
+        if(s == segments - 1) b = b + d * hw;
+      }
+      FPoint const normal{-d.y * hw, d.x * hw};
+      auto const i = vertex(a + normal, col);
+      vertex(a - normal, col);
+      vertex(b + normal, col);
+      vertex(b - normal, col);
+      quad(i, i + 1, i + 2, i + 3);
+    }
+    for(std::size_t k = closed ? 0 : 1; k < (closed ? n : n - 1); ++k)
+      join(points_[(k + n - 1) % n], points_[k], points_[(k + 1) % n], hw,
+           col, style);
+    if(!closed && style.cap == line_cap::round) {
+      round_cap(points_[0], points_[1], hw, col);
+      round_cap(points_[n - 1], points_[n - 2], hw, col);
+    }
+  }
+
+  void polygon(std::span<FPoint const> const points,
+               rgba const color,
+               LineStyle const& style = {}) {
+    polyline(points, color, style, true);
+  }
+
+  /**
+   * Fill a simple polygon, convex or not, by ear clipping. Self-intersecting
+   * polygons are filled as far as clipping gets.
+   */
+  void fill_polygon(std::span<FPoint const> const points, rgba const color) {
+    using namespace impl;
+    auto const n = points.size();
+    if(n < 3) return;
+    auto const col  = to_color(color);
+    auto const base = static_cast<int>(vertices_.size());
+    for(auto const p : points) vertex(p, col);
+
+    float area = 0;
+    for(std::size_t i = 0; i < n; ++i)
+      area += cross(points[i], points[(i + 1) % n]);
+    // orient the ring so that convex corners turn positively
+    ring_.resize(n);
+    for(std::size_t i = 0; i < n; ++i)
+      ring_[i] = static_cast<int>(area >= 0 ? i : n - 1 - i);
+    if(convex()) {
+      for(std::size_t i = 1; i + 1 < n; ++i)
+        tri(base + ring_[0], base + ring_[i], base + ring_[i + 1]);
+      return;
+    }
+    auto const at = [&](std::size_t const i) { return points[ring_[i]]; };
+    std::size_t i = 0, stuck = 0;
+    while(ring_.size() > 3 && stuck < ring_.size()) {
+      auto const m    = ring_.size();
+      auto const prev = (i + m - 1) % m, next = (i + 1) % m;
+      auto const bend = cross(at(i) - at(prev), at(next) - at(i));
+      // a vertex in a straight run encloses nothing and can just go
+      auto const flat = std::abs(bend) <= 1e-6f;
+      if(flat || (bend > 0 && is_ear(prev, i, next, at))) {
+        if(!flat) tri(base + ring_[prev], base + ring_[i], base + ring_[next]);
+        ring_.erase(ring_.begin() + static_cast<std::ptrdiff_t>(i));
+        i     = i % ring_.size();
+        stuck = 0;
+      } else {
+        i = next;
+        ++stuck;
+      }
+    }
+    if(ring_.size() == 3)
+      tri(base + ring_[0], base + ring_[1], base + ring_[2]);
+  }
+
+  void fill_circle(FPoint const center, float const r, rgba const color) {
+    fill_arc(center, r, degrees<float>{0}, degrees<float>{360}, color);
+  }
+
+  /** A pie slice from ~from~ to ~to~, clockwise on screen from +x. */
+  void fill_arc(FPoint const center,
+                float const r,
+                degrees<float> const from,
+                degrees<float> const to,
+                rgba const color) {
+    auto const col   = to_color(color);
+    auto const a0    = radians(from);
+    auto const sweep = radians(to) - a0;
+    auto const n     = impl::curve_segments(r, sweep);
+    auto const c     = vertex(center, col);
+    for(int k = 0; k <= n; ++k) {
+      auto const a = a0 + sweep * static_cast<float>(k) / static_cast<float>(n);
+      vertex({center.x + r * std::cos(a), center.y + r * std::sin(a)}, col);
+      if(k > 0) tri(c, c + k, c + k + 1);
+    }
+  }
+
+  void circle(FPoint const center,
+              float const r,
+              rgba const color,
+              float const width = 1) {
+    arc(center, r, degrees<float>{0}, degrees<float>{360}, color, width);
+  }
+
+  /** An arc of a ring ~width~ wide, centred on radius ~r~. */
+  void arc(FPoint const center,
+           float const r,
+           degrees<float> const from,
+           degrees<float> const to,
+           rgba const color,
+           float const width = 1) {
+    auto const col   = to_color(color);
+    auto const a0    = radians(from);
+    auto const sweep = radians(to) - a0;
+    auto const outer = r + width / 2;
+    auto const inner = std::max(r - width / 2, 0.0f);
+    auto const n     = impl::curve_segments(outer, sweep);
+    auto const first = static_cast<int>(vertices_.size());
+    for(int k = 0; k <= n; ++k) {
+      auto const a = a0 + sweep * static_cast<float>(k) / static_cast<float>(n);
+      auto const x = std::cos(a), y = std::sin(a);
+      vertex({center.x + x * outer, center.y + y * outer}, col);
+      vertex({center.x + x * inner, center.y + y * inner}, col);
+      if(k > 0) {
+        auto const i = first + 2 * (k - 1);
+        quad(i, i + 1, i + 2, i + 3);
+      }
+    }
+  }
+
+ private:
+  static SDL_Color to_color(rgba const c) noexcept {
+    return {c.r, c.g, c.b, c.a};
+  }
+  static float radians(degrees<float> const a) noexcept {
+    return a.number * (std::numbers::pi_v<float> / 180);
+  }
+
+  int vertex(FPoint const p, SDL_Color const color) {
+    vertices_.push_back({p, color, {0, 0}});
+    return static_cast<int>(vertices_.size() - 1);
+  }
+  void tri(int const a, int const b, int const c) {
+    indices_.insert(indices_.end(), {a, b, c});
+  }
+  /** ~a b~ across one end and ~c d~ across the other. */
+  void quad(int const a, int const b, int const c, int const d) {
+    indices_.insert(indices_.end(), {a, b, c, c, b, d});
+  }
+
+  void join(FPoint const before,
+            FPoint const p,
+            FPoint const after,
+            float const hw,
+            SDL_Color const col,
+            LineStyle const& style) {
+    using namespace impl;
+    auto const d0   = (p - before) * (1 / length(p - before));
+    auto const d1   = (after - p) * (1 / length(after - p));
+    auto const turn = cross(d0, d1);
+    if(std::abs(turn) < 1e-6f && dot(d0, d1) > 0) return; // straight on
+    // the corners on the outside of the turn
+    auto const side = turn > 0 ? -hw : hw;
+    FPoint const n0{-d0.y * side, d0.x * side};
+    FPoint const n1{-d1.y * side, d1.x * side};
+    auto const c = vertex(p, col);
+    auto const a = vertex(p + n0, col);
+    if(style.join == line_join::round) {
+      auto const start = std::atan2(n0.y, n0.x);
+      auto sweep       = std::atan2(n1.y, n1.x) - start;
+      auto const pi    = std::numbers::pi_v<float>;
+      if(sweep > pi) sweep -= 2 * pi;
+      if(sweep < -pi) sweep += 2 * pi;
+      auto const steps = curve_segments(hw, sweep);
+      for(int k = 1; k <= steps; ++k) {
+        auto const t = start + sweep * static_cast<float>(k)
+                                 / static_cast<float>(steps);
+        vertex({p.x + hw * std::cos(t), p.y + hw * std::sin(t)}, col);
+        tri(c, a + k - 1, a + k);
+      }
+      return;
+    }
+    auto const b = vertex(p + n1, col);
+    auto const bisector = n0 + n1;
+    auto const along    = length(bisector);
+    if(style.join == line_join::miter && along > 1e-6f) {
+      // the miter tip is hw / cos(half the angle between the normals) out
+      auto const cos_half = along / (2 * hw);
+      if(1 / cos_half <= style.miter_limit) {
+        auto const m = vertex(p + bisector * (hw / cos_half / along), col);
+        tri(c, a, m);
+        tri(c, m, b);
+        return;
+      }
+    }
+    tri(c, a, b);
+  }
+
+  void round_cap(FPoint const end,
+                 FPoint const inward,
+                 float const hw,
+                 SDL_Color const col) {
+    using namespace impl;
+    auto const d     = (end - inward) * (1 / length(end - inward));
+    auto const start = std::atan2(d.x, -d.y); // the normal on one side
+    auto const pi    = std::numbers::pi_v<float>;
+    auto const steps = curve_segments(hw, pi);
+    auto const c     = vertex(end, col);
+    for(int k = 0; k <= steps; ++k) {
+      auto const t =
+          start - pi * static_cast<float>(k) / static_cast<float>(steps);
+      vertex({end.x + hw * std::cos(t), end.y + hw * std::sin(t)}, col);
+      if(k > 0) tri(c, c + k, c + k + 1);
+    }
+  }
+
+  bool convex() const noexcept {
+    using namespace impl;
+    auto const& v = vertices_;
+    auto const n  = ring_.size();
+    auto const base = static_cast<int>(v.size() - n);
+    for(std::size_t i = 0; i < n; ++i) {
+      auto const a = v[base + ring_[i]].position;
+      auto const b = v[base + ring_[(i + 1) % n]].position;
+      auto const c = v[base + ring_[(i + 2) % n]].position;
+      if(cross(b - a, c - b) < 0) return false;
+    }
+    return true;
+  }
+
+  /** Is the convex corner at ~i~ free of the polygon's other vertices? */
+  template<class At>
+  bool is_ear(std::size_t const prev,
+              std::size_t const i,
+              std::size_t const next,
+              At const& at) const noexcept {
+    using namespace impl;
+    auto const a = at(prev), b = at(i), c = at(next);
+    for(std::size_t k = 0; k < ring_.size(); ++k) {
+      if(k == prev || k == i || k == next) continue;
+      if(in_triangle(at(k), a, b, c)) return false;
+    }
+    return true;
+  }
+
+  std::vector<Vertex> vertices_;
+  std::vector<int> indices_;
+  // scratch
+  std::vector<FPoint> points_;
+  std::vector<int> ring_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_SHAPES_INCLUDE_GUARD
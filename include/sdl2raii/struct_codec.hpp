@@ -0,0 +1,423 @@
+#ifndef SDLRAII_STRUCT_CODEC_INCLUDE_GUARD
+#define SDLRAII_STRUCT_CODEC_INCLUDE_GUARD
+
+#include "endian_span.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+
+/**
+ * Wire layouts for plain structs, so records can be read and written without
+ * a hand-written sequence of ~ReadLE32~ calls. A struct describes itself with
+ * a ~wire_layout~ member type listing its fields in wire order:
+ *
+ * #+begin_src c++
+ * struct Level {
+ *   Uint32 magic;
+ *   Uint16 version;
+ *   std::array<Sint32, 2> size;
+ *   float gravity;
+ *
+ *   using wire_layout = sdl::wire::layout<sdl::wire::be<&Level::magic>,
+ *                                         sdl::wire::le<&Level::version>,
+ *                                         sdl::wire::le<&Level::size>,
+ *                                         sdl::wire::le<&Level::gravity>>;
+ * };
+ * #+end_src
+ *
+ * Fields may be integers, enums, ~float~, ~double~, ~bool~ (one byte),
+ * ~std::array~s of those, and other described structs. On the wire fields are
+ * packed with no padding. The byte order of a nested struct field is ignored;
+ * its own layout decides. Types that cannot be edited can specialize
+ * ~layout_of~ instead.
+ */
+namespace wire {
+enum class order : Uint8 { little, big };
+
+namespace impl {
+template<class>
+struct member_pointer;
+template<class C, class V>
+struct member_pointer<V C::*> {
+  using owner = C;
+  using value = V;
+};
+} // namespace impl
+
+template<auto Member, order Order>
+requires std::is_member_object_pointer_v<decltype(Member)>
+struct field {
+  using owner = typename impl::member_pointer<decltype(Member)>::owner;
+  using value = typename impl::member_pointer<decltype(Member)>::value;
+  static constexpr auto member      = Member;
+  static constexpr order byte_order = Order;
+};
+template<auto Member>
+using le = field<Member, order::little>;
+template<auto Member>
+using be = field<Member, order::big>;
+
+template<class... Fields>
+struct layout {};
+
+template<class T>
+struct layout_of {};
+template<class T>
+requires requires { typename T::wire_layout; }
+struct layout_of<T> {
+  using type = typename T::wire_layout;
+};
+
+template<class T>
+concept described = requires { typename layout_of<T>::type; };
+} // namespace wire
+
+namespace impl {
+template<class V>
+struct is_std_array : std::false_type {};
+template<class E, std::size_t N>
+struct is_std_array<std::array<E, N>> : std::true_type {};
+
+template<class V>
+concept wire_scalar = (std::is_arithmetic_v<V> || std::is_enum_v<V>)
+                   && (sizeof(V) == 1 || sizeof(V) == 2 || sizeof(V) == 4
+                       || sizeof(V) == 8);
+
+template<std::size_t N>
+using wire_uint = std::conditional_t<
+    N == 1,
+    Uint8,
+    std::conditional_t<N == 2,
+                       Uint16,
+                       std::conditional_t<N == 4, Uint32, Uint64>>>;
+
+inline Uint8 byteswap(Uint8 const v) noexcept { return v; }
+inline Uint16 byteswap(Uint16 const v) noexcept { return SDL_Swap16(v); }
+inline Uint32 byteswap(Uint32 const v) noexcept { return SDL_Swap32(v); }
+inline Uint64 byteswap(Uint64 const v) noexcept { return SDL_Swap64(v); }
+
+template<wire::order O>
+inline constexpr bool swaps = (O == wire::order::little) != host_little_endian;
+
+template<class T>
+using layout_t = typename wire::layout_of<T>::type;
+
+template<class Layout>
+struct layout_traits;
+
+template<class V>
+constexpr std::size_t wire_size() noexcept {
+  if constexpr(wire_scalar<V>)
+    return sizeof(V);
+  else if constexpr(is_std_array<V>::value)
+    return std::tuple_size_v<V> * wire_size<typename V::value_type>();
+  else {
+    static_assert(wire::described<V>, "not a wire field type");
+    return layout_traits<layout_t<V>>::size;
+  }
+}
+
+template<class... F>
+struct layout_traits<wire::layout<F...>> {
+  static constexpr std::size_t size =
+      (wire_size<typename F::value>() + ... + 0);
+  static constexpr auto offsets = [] {
+    std::array<std::size_t, sizeof...(F)> offsets{};
+    std::size_t at = 0, i = 0;
+    ((offsets[i++] = at, at += wire_size<typename F::value>()), ...);
+    return offsets;
+  }();
+};
+
+template<class T, class... F>
+constexpr bool fields_of(wire::layout<F...>) noexcept {
+  return (std::is_base_of_v<typename F::owner, T> && ...);
+}
+
+template<wire::order O, class V>
+inline void decode_value(Uint8 const* p, V& out) noexcept;
+template<wire::order O, class V>
+inline void encode_value(V const& in, Uint8* p) noexcept;
+
+template<class T, class... F>
+inline void
+    decode_fields(Uint8 const* const p, T& out, wire::layout<F...>) noexcept {
+  using traits = layout_traits<wire::layout<F...>>;
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    (decode_value<F::byte_order>(p + traits::offsets[I], out.*F::member), ...);
+  }(std::index_sequence_for<F...>{});
+}
+template<class T, class... F>
+inline void
+    encode_fields(T const& in, Uint8* const p, wire::layout<F...>) noexcept {
+  using traits = layout_traits<wire::layout<F...>>;
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    (encode_value<F::byte_order>(in.*F::member, p + traits::offsets[I]), ...);
+  }(std::index_sequence_for<F...>{});
+}
+
+template<wire::order O, class V>
+inline void decode_value(Uint8 const* const p, V& out) noexcept {
+  if constexpr(std::is_same_v<V, bool>) {
+    out = *p != 0;
+  } else if constexpr(wire_scalar<V>) {
+    wire_uint<sizeof(V)> u;
+    std::memcpy(&u, p, sizeof u);
+    if constexpr(swaps<O>) u = byteswap(u);
+    out = std::bit_cast<V>(u);
+  } else if constexpr(is_std_array<V>::value) {
+    using E = typename V::value_type;
+    if constexpr(wire_scalar<E> && !std::is_same_v<E, bool>) {
+      auto* const dst = reinterpret_cast<Uint8*>(out.data());
+      if constexpr(swaps<O> && sizeof(E) > 1)
+        bswap_copy<sizeof(E)>(dst, p, out.size());
+      else
+        std::memcpy(dst, p, out.size() * sizeof(E));
+    } else {
+      for(std::size_t i = 0; i < out.size(); ++i)
+        decode_value<O>(p + i * wire_size<E>(), out[i]);
+    }
+  } else {
+    decode_fields(p, out, layout_t<V>{});
+  }
+}
+
+template<wire::order O, class V>
+inline void encode_value(V const& in, Uint8* const p) noexcept {
+  if constexpr(std::is_same_v<V, bool>) {
+    *p = in ? 1 : 0;
+  } else if constexpr(wire_scalar<V>) {
+    auto u = std::bit_cast<wire_uint<sizeof(V)>>(in);
+    if constexpr(swaps<O>) u = byteswap(u);
+    std::memcpy(p, &u, sizeof u);
+  } else if constexpr(is_std_array<V>::value) {
+    using E = typename V::value_type;
+    if constexpr(wire_scalar<E> && !std::is_same_v<E, bool>) {
+      auto const* const src = reinterpret_cast<Uint8 const*>(in.data());
+      if constexpr(swaps<O> && sizeof(E) > 1)
+        bswap_copy<sizeof(E)>(p, src, in.size());
+      else
+        std::memcpy(p, src, in.size() * sizeof(E));
+    } else {
+      for(std::size_t i = 0; i < in.size(); ++i)
+        encode_value<O>(in[i], p + i * wire_size<E>());
+    }
+  } else {
+    encode_fields(in, p, layout_t<V>{});
+  }
+}
+
+/**
+ * Whether a value's wire bytes could be its object bytes: host byte order all
+ * the way down and no padding. Field order is checked separately.
+ */
+template<class T>
+constexpr bool host_shaped_struct() noexcept;
+
+template<wire::order O, class V>
+constexpr bool host_shaped() noexcept {
+  if constexpr(std::is_same_v<V, bool>)
+    return false;
+  else if constexpr(wire_scalar<V>)
+    return sizeof(V) == 1 || !swaps<O>;
+  else if constexpr(is_std_array<V>::value)
+    return sizeof(V) == wire_size<V>()
+        && host_shaped<O, typename V::value_type>();
+  else
+    return host_shaped_struct<V>();
+}
+
+template<class T, class... F>
+constexpr bool host_shaped_fields(wire::layout<F...>) noexcept {
+  return (host_shaped<F::byte_order, typename F::value>() && ...);
+}
+
+template<class T>
+constexpr bool host_shaped_struct() noexcept {
+  return std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>
+      && sizeof(T) == wire_size<T>() && host_shaped_fields<T>(layout_t<T>{});
+}
+
+template<class T>
+bool same_offsets() noexcept;
+
+template<class V>
+bool same_offsets_within() noexcept {
+  if constexpr(is_std_array<V>::value)
+    return same_offsets_within<typename V::value_type>();
+  else if constexpr(wire::described<V>)
+    return same_offsets<V>();
+  else
+    return true;
+}
+
+template<class T, class... F>
+bool same_offsets(wire::layout<F...>) noexcept {
+  using traits = layout_traits<wire::layout<F...>>;
+  T const probe{};
+  auto const* const base = reinterpret_cast<Uint8 const*>(&probe);
+  return [&]<std::size_t... I>(std::index_sequence<I...>) {
+    return ((reinterpret_cast<Uint8 const*>(&(probe.*F::member)) - base
+                 == static_cast<std::ptrdiff_t>(traits::offsets[I])
+             && same_offsets_within<typename F::value>())
+            && ...);
+  }(std::index_sequence_for<F...>{});
+}
+
+template<class T>
+bool same_offsets() noexcept {
+  static bool const same = same_offsets<T>(layout_t<T>{});
+  return same;
+}
+
+/**
+ * Whether ~T~ can be copied to and from the wire with ~memcpy~. The byte order
+ * and padding are known at compile time; whether the layout lists the fields
+ * in declaration order is checked once, on first use.
+ */
+template<class T>
+bool memcpy_layout() noexcept {
+  if constexpr(host_shaped_struct<T>())
+    return same_offsets<T>();
+  else
+    return false;
+}
+
+inline constexpr std::size_t staging_bytes = 4096;
+
+/** A stack buffer, unless one record is bigger than that. */
+template<std::size_t Size>
+using staging_buffer = std::conditional_t<Size <= staging_bytes,
+                                          std::array<Uint8, staging_bytes>,
+                                          std::vector<Uint8>>;
+
+template<class T, class Stream>
+std::size_t read_structs(Stream&& src, std::span<T> const out) {
+  if(memcpy_layout<T>())
+    return stream_read(src, out.data(), sizeof(T), out.size());
+  constexpr auto size      = wire_size<T>();
+  constexpr auto per_chunk = std::max<std::size_t>(staging_bytes / size, 1);
+  staging_buffer<size> chunk;
+  if constexpr(size > staging_bytes) chunk.resize(size);
+  std::size_t done = 0;
+  while(done < out.size()) {
+    auto const want = std::min(per_chunk, out.size() - done);
+    auto const got  = stream_read(src, chunk.data(), size, want);
+    for(std::size_t i = 0; i < got; ++i)
+      decode_value<wire::order::little>(chunk.data() + i * size,
+                                        out[done + i]);
+    done += got;
+    if(got != want) break;
+  }
+  return done;
+}
+
+template<class T, class Stream>
+std::size_t write_structs(Stream&& dst, std::span<T const> const in) {
+  if(memcpy_layout<T>())
+    return stream_write(dst, in.data(), sizeof(T), in.size());
+  constexpr auto size      = wire_size<T>();
+  constexpr auto per_chunk = std::max<std::size_t>(staging_bytes / size, 1);
+  staging_buffer<size> chunk;
+  if constexpr(size > staging_bytes) chunk.resize(size);
+  std::size_t done = 0;
+  while(done < in.size()) {
+    auto const n = std::min(per_chunk, in.size() - done);
+    for(std::size_t i = 0; i < n; ++i)
+      encode_value<wire::order::little>(in[done + i], chunk.data() + i * size);
+    auto const written = stream_write(dst, chunk.data(), size, n);
+    done += written;
+    if(written != n) break;
+  }
+  return done;
+}
+} // namespace impl
+
+/** The number of bytes ~T~ takes on the wire. */
+template<wire::described T>
+inline constexpr std::size_t wire_size_v = impl::wire_size<T>();
+
+/**
+ * Read and write arrays of described structs. Each call stages as many
+ * records as fit in a 4 KiB buffer per stream call and decodes them at offsets
+ * fixed at compile time. When the wire layout is the struct's own
+ * representation, records go straight between the stream and the span.
+ *
+ * Like the ~ReadLE32~ span overloads, these return the number of records
+ * transferred, and streams are ~RWops*~ or ~BufferedRWops&~.
+ */
+template<class Stream, class T>
+requires wire::described<T> && (!std::is_const_v<T>)
+inline std::size_t ReadStructs(Stream&& src, std::span<T> const out) {
+  static_assert(impl::fields_of<T>(impl::layout_t<T>{}),
+                "wire_layout names a member of another type");
+  static_assert(wire_size_v<T> > 0, "empty wire_layout");
+  return impl::read_structs(src, out);
+}
+template<class Stream, class T>
+requires wire::described<std::remove_const_t<T>>
+inline std::size_t WriteStructs(Stream&& dst, std::span<T> const in) {
+  using U = std::remove_const_t<T>;
+  static_assert(impl::fields_of<U>(impl::layout_t<U>{}),
+                "wire_layout names a member of another type");
+  static_assert(wire_size_v<U> > 0, "empty wire_layout");
+  return impl::write_structs(dst, std::span<U const>{in});
+}
+
+/** One record. Returns 1 on success and 0 otherwise. */
+template<class Stream, wire::described T>
+inline std::size_t ReadStruct(Stream&& src, T& out) {
+  return ReadStructs(src, std::span{&out, 1});
+}
+template<class Stream, wire::described T>
+inline std::size_t WriteStruct(Stream&& dst, T const& in) {
+  return WriteStructs(dst, std::span{&in, 1});
+}
+
+/** ~ReadStructs~ and ~WriteStructs~ for memory buffers. */
+template<class T>
+requires wire::described<T> && (!std::is_const_v<T>)
+inline std::size_t DecodeStructs(std::span<Uint8 const> const bytes,
+                                 std::span<T> const out) noexcept {
+  constexpr auto size = wire_size_v<T>;
+  auto const n        = std::min(bytes.size() / size, out.size());
+  if(n == 0) return 0;
+  if(impl::memcpy_layout<T>()) {
+    std::memcpy(out.data(), bytes.data(), n * size);
+  } else {
+    for(std::size_t i = 0; i < n; ++i)
+      impl::decode_value<wire::order::little>(bytes.data() + i * size, out[i]);
+  }
+  return n;
+}
+template<class T>
+requires wire::described<std::remove_const_t<T>>
+inline std::size_t EncodeStructs(std::span<T> const in,
+                                 std::span<Uint8> const bytes) noexcept {
+  using U             = std::remove_const_t<T>;
+  constexpr auto size = wire_size_v<U>;
+  auto const n        = std::min(bytes.size() / size, in.size());
+  if(n == 0) return 0;
+  if(impl::memcpy_layout<U>()) {
+    std::memcpy(bytes.data(), in.data(), n * size);
+  } else {
+    for(std::size_t i = 0; i < n; ++i)
+      impl::encode_value<wire::order::little>(in[i], bytes.data() + i * size);
+  }
+  return n;
+}
+
+} // namespace sdl
+
+#endif // SDLRAII_STRUCT_CODEC_INCLUDE_GUARD
@@ -0,0 +1,309 @@
+#ifndef SDLRAII_SURFACE_POOL_INCLUDE_GUARD
+#define SDLRAII_SURFACE_POOL_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "thread.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+namespace impl {
+
+inline constexpr std::size_t pooled_pitch_alignment = 64;
+
+/** Frees a pooled surface, and its pixels if the pool allocated them. */
+inline void free_pooled_surface(Surface* const surface) noexcept {
+  auto* const pixels = surface->pixels;
+  auto const own     = (surface->flags & SDL_PREALLOC) != 0;
+  SDL_FreeSurface(surface);
+  if(own)
+    ::operator delete(pixels, std::align_val_t{pooled_pitch_alignment});
+}
+struct FreePooledSurface {
+  void operator()(Surface* const surface) const noexcept {
+    free_pooled_surface(surface);
+  }
+};
+
+/**
+ * The part of a ~SurfacePool~ that handles on loan point to, through the
+ * surface's ~userdata~. It outlives the pool until the last one comes back.
+ */
+struct SurfacePoolCore {
+  SpinMutex lock;
+  std::vector<Surface*> returned; // guarded by lock
+  std::size_t outstanding = 0;    // guarded by lock
+  bool alive              = true; // guarded by lock
+};
+
+/** The deleter of pooled ~UniqueSurface~s. Safe from any thread. */
+inline void return_pooled_surface(Surface* const surface) noexcept {
+  auto* const core = static_cast<SurfacePoolCore*>(surface->userdata);
+  bool last        = false;
+  {
+    std::lock_guard const lock{core->lock};
+    --core->outstanding;
+    if(core->alive) {
+      core->returned.push_back(surface);
+      return;
+    }
+    last = core->outstanding == 0;
+  }
+  free_pooled_surface(surface);
+  if(last) delete core;
+}
+
+} // namespace impl
+
+/**
+ * Recycles scratch surfaces so compositing, text and thumbnails don't allocate
+ * pixels every frame.
+ *
+ * ~acquire~ returns a ~UniqueSurface~ whose deleter gives the surface back to
+ * the pool instead of freeing it, so it can go anywhere a ~UniqueSurface~ can
+ * and may be dropped on any thread. Idle surfaces are bucketed by format and
+ * size, and a returned surface has its clip rectangle, color key, RLE and
+ * blend state reset; its pixels are left as they were. Surfaces that were
+ * RLE-encoded while on loan are freed instead. Pooled surfaces use
+ * ~userdata~ for bookkeeping, so don't.
+ *
+ * With ~aligned_pitch~ the pool allocates pixels itself, with rows starting on
+ * 64-byte boundaries, for SIMD and to keep rows off shared cache lines.
+ *
+ * Call ~end_frame~ once per frame. Idle surfaces unused for ~max_idle_frames~
+ * are freed, as are empty buckets, and idle surfaces never take more than
+ * ~max_idle_bytes~, dropping the least recently returned first.
+ * ~last_frame()~ counts the allocations reuse saved during the previous frame.
+ */
+class SurfacePool {
+ public:
+  static constexpr std::size_t default_max_idle_bytes = 64u << 20;
+  static constexpr Uint64 default_max_idle_frames     = 120;
+
+  struct Key {
+    Uint32 format;
+    int w, h;
+
+    friend bool operator==(Key const&, Key const&) = default;
+  };
+
+  struct Stats {
+    std::size_t reused    = 0; // allocations avoided
+    std::size_t allocated = 0;
+  };
+
+  explicit SurfacePool(
+      bool const aligned_pitch         = false,
+      std::size_t const max_idle_bytes = default_max_idle_bytes,
+      Uint64 const max_idle_frames     = default_max_idle_frames)
+      : core_{new impl::SurfacePoolCore},
+        aligned_pitch_{aligned_pitch},
+        max_idle_bytes_{max_idle_bytes},
+        max_idle_frames_{max_idle_frames} {}
+  SurfacePool(SurfacePool const&) = delete;
+  SurfacePool& operator=(SurfacePool const&) = delete;
+  ~SurfacePool() {
+    bool last;
+    {
+      std::lock_guard const lock{core_->lock};
+      core_->alive = false;
+      last         = core_->outstanding == 0;
+    }
+    // nothing is pushed to ~returned~ once ~alive~ is false
+    for(auto* const surface : core_->returned)
+      impl::free_pooled_surface(surface);
+    core_->returned.clear();
+    buckets_.clear();
+    if(last) delete core_;
+  }
+
+  MayError<UniqueSurface>
+      acquire(Uint32 const format, int const w, int const h) {
+    collect();
+    Surface* surface = nullptr;
+    if(auto const bucket = buckets_.find(Key{format, w, h});
+       bucket != buckets_.end() && !bucket->second.empty()) {
+      // newest first: the most recently used pixels are likeliest to be warm
+      auto& entry = bucket->second.back();
+      surface     = entry.surface.release();
+      idle_bytes_ -= entry.bytes;
+      bucket->second.pop_back();
+      ++frame_stats_.reused;
+      ++total_.reused;
+    } else {
+      auto made = create(format, w, h);
+      SDLRAII_BAIL_ERROR(made);
+      surface = made.get();
+      ++frame_stats_.allocated;
+      ++total_.allocated;
+    }
+    surface->userdata = core_;
+    {
+      std::lock_guard const lock{core_->lock};
+      ++core_->outstanding;
+    }
+    return UniqueSurface{surface, &impl::return_pooled_surface};
+  }
+
+  /** Age the pool by one frame and free what has been idle for too long. */
+  void end_frame() {
+    collect();
+    ++frame_;
+    for(auto it = buckets_.begin(); it != buckets_.end();) {
+      auto& idle       = it->second;
+      auto const stale = std::find_if(idle.begin(), idle.end(), [&](auto& e) {
+        return frame_ - e.returned <= max_idle_frames_;
+      });
+      for(auto e = idle.begin(); e != stale; ++e) idle_bytes_ -= e->bytes;
+      idle.erase(idle.begin(), stale);
+      it = idle.empty() ? buckets_.erase(it) : std::next(it);
+    }
+    last_frame_  = frame_stats_;
+    frame_stats_ = {};
+  }
+
+  /** Free every idle surface. */
+  void clear() {
+    collect();
+    buckets_.clear();
+    idle_bytes_ = 0;
+  }
+
+  std::size_t idle_count() const noexcept {
+    std::size_t n = 0;
+    for(auto const& [key, idle] : buckets_) n += idle.size();
+    return n;
+  }
+  std::size_t idle_bytes() const noexcept { return idle_bytes_; }
+  std::size_t bucket_count() const noexcept { return buckets_.size(); }
+  Stats this_frame() const noexcept { return frame_stats_; }
+  Stats last_frame() const noexcept { return last_frame_; }
+  Stats total() const noexcept { return total_; }
+
+ private:
+  struct KeyHash {
+    std::size_t operator()(Key const& k) const noexcept {
+      auto const wh = static_cast<Uint64>(static_cast<Uint32>(k.w)) << 32
+                    | static_cast<Uint32>(k.h);
+      return std::hash<Uint64>{}(wh ^ (static_cast<Uint64>(k.format) << 16));
+    }
+  };
+  struct Entry {
+    std::unique_ptr<Surface, impl::FreePooledSurface> surface;
+    std::size_t bytes;
+    Uint64 returned;
+  };
+
+  MayError<Surface*> create(Uint32 const format, int const w, int const h) {
+    if(!aligned_pitch_ || SDL_ISPIXELFORMAT_FOURCC(format) || w <= 0
+       || h <= 0) {
+      auto* const surface = SDL_CreateRGBSurfaceWithFormat(
+          0, w, h, SDL_BITSPERPIXEL(format), format);
+      SDLRAII_COLD_IF(surface == nullptr)
+        return sdl::GetError();
+      return surface;
+    }
+    constexpr auto align = impl::pooled_pitch_alignment;
+    auto const row   = static_cast<std::size_t>(w) * SDL_BYTESPERPIXEL(format);
+    auto const pitch = (row + align - 1) & ~(align - 1);
+    auto* const pixels =
+        ::operator new(pitch * static_cast<std::size_t>(h),
+                       std::align_val_t{align});
+    auto* const surface =
+        SDL_CreateRGBSurfaceWithFormatFrom(pixels,
+                                           w,
+                                           h,
+                                           SDL_BITSPERPIXEL(format),
+                                           static_cast<int>(pitch),
+                                           format);
+    SDLRAII_COLD_IF(surface == nullptr) {
+      ::operator delete(pixels, std::align_val_t{align});
+      return sdl::GetError();
+    }
+    return surface;
+  }
+
+  /** Move surfaces given back since last time into their buckets. */
+  void collect() {
+    {
+      std::lock_guard const lock{core_->lock};
+      if(core_->returned.empty()) return;
+      std::swap(core_->returned, collected_);
+    }
+    for(auto* const surface : collected_) {
+      // turning RLE off doesn't decode a surface already encoded (and maybe
+      // without pixels), so drop those rather than hand them out again
+      SDLRAII_COLD_IF(surface->flags & SDL_RLEACCEL) {
+        impl::free_pooled_surface(surface);
+        continue;
+      }
+      reset(surface);
+      auto const bytes = static_cast<std::size_t>(surface->pitch)
+                       * static_cast<std::size_t>(surface->h);
+      buckets_[Key{surface->format->format, surface->w, surface->h}]
+          .push_back(Entry{{surface, {}}, bytes, frame_});
+      idle_bytes_ += bytes;
+    }
+    collected_.clear();
+    trim(max_idle_bytes_);
+  }
+
+  static void reset(Surface* const surface) noexcept {
+    surface->userdata = nullptr;
+    SDL_SetSurfaceRLE(surface, 0);
+    SDL_SetColorKey(surface, SDL_FALSE, 0);
+    SDL_SetSurfaceColorMod(surface, 255, 255, 255);
+    SDL_SetSurfaceAlphaMod(surface, 255);
+    SDL_SetSurfaceBlendMode(surface,
+                            surface->format->Amask ? SDL_BLENDMODE_BLEND
+                                                   : SDL_BLENDMODE_NONE);
+    SDL_SetClipRect(surface, nullptr);
+  }
+
+  /** Drop the least recently returned idle surfaces until under ~limit~. */
+  void trim(std::size_t const limit) {
+    while(idle_bytes_ > limit) {
+      // each bucket is in return order, so the oldest is some bucket's front
+      auto oldest = buckets_.end();
+      for(auto it = buckets_.begin(); it != buckets_.end(); ++it)
+        if(!it->second.empty()
+           && (oldest == buckets_.end()
+               || it->second.front().returned
+                      < oldest->second.front().returned))
+          oldest = it;
+      if(oldest == buckets_.end()) break;
+      idle_bytes_ -= oldest->second.front().bytes;
+      oldest->second.erase(oldest->second.begin());
+    }
+  }
+
+  impl::SurfacePoolCore* core_;
+  std::vector<Surface*> collected_;
+  std::unordered_map<Key, std::vector<Entry>, KeyHash> buckets_;
+  bool aligned_pitch_;
+  std::size_t idle_bytes_ = 0;
+  std::size_t max_idle_bytes_;
+  Uint64 max_idle_frames_;
+  Uint64 frame_ = 0;
+  Stats frame_stats_;
+  Stats last_frame_;
+  Stats total_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_SURFACE_POOL_INCLUDE_GUARD
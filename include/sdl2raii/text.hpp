@@ -0,0 +1,558 @@
+#ifndef SDLRAII_TEXT_INCLUDE_GUARD
+#define SDLRAII_TEXT_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "compositor.hpp"
+#include "hash.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+
+/**
+ * One character of a ~BitmapFont~, with BMFont's metrics: ~src~ is where it is
+ * in the atlas, the offsets go from the pen position at the top of the line to
+ * the top left of ~src~, and the pen moves on by ~xadvance~.
+ */
+struct Glyph {
+  Rect src{};
+  int xoffset  = 0;
+  int yoffset  = 0;
+  int xadvance = 0;
+};
+
+namespace impl {
+/** Decode the UTF-8 character at ~i~ and step past it. Bad bytes are U+FFFD. */
+constexpr Uint32 next_codepoint(std::string_view const s,
+                                std::size_t& i) noexcept {
+  auto const lead = static_cast<Uint8>(s[i++]);
+  if(lead < 0x80) return lead;
+  int const extra = lead >= 0xf0 ? 3 : lead >= 0xe0 ? 2 : lead >= 0xc0 ? 1 : -1;
+  SDLRAII_COLD_IF(extra < 0 || lead > 0xf4) return 0xfffd;
+  Uint32 cp = lead & (0x3f >> extra);
+  for(int k = 0; k < extra; ++k) {
+    SDLRAII_COLD_IF(i == s.size() || (static_cast<Uint8>(s[i]) & 0xc0) != 0x80)
+      return 0xfffd;
+    cp = cp << 6 | (static_cast<Uint8>(s[i++]) & 0x3f);
+  }
+  return cp;
+}
+
+/** The ~key=value~ pairs of one line of a BMFont text descriptor. */
+struct BMFontLine {
+  std::string_view tag, rest;
+
+  explicit BMFontLine(std::string_view const line) noexcept {
+    auto const space = line.find(' ');
+    tag  = line.substr(0, space);
+    rest = space == line.npos ? std::string_view{} : line.substr(space);
+  }
+
+  /** The integer value of ~key~, or ~fallback~ if it is missing. */
+  int get(std::string_view const key, int const fallback = 0) const noexcept {
+    for(std::size_t at = 0; (at = rest.find(key, at)) != rest.npos;
+        at += key.size()) {
+      auto const value = at + key.size();
+      if(rest[at - 1] != ' ' || value >= rest.size() || rest[value] != '=')
+        continue;
+      int n      = fallback;
+      auto const* const first = rest.data() + value + 1;
+      std::from_chars(first, rest.data() + rest.size(), n);
+      return n;
+    }
+    return fallback;
+  }
+};
+} // namespace impl
+
+/**
+ * A bitmap font: one atlas texture and the metrics of the glyphs on it.
+ *
+ * Build one from a sheet of equal cells with ~FromGrid~, or from an AngelCode
+ * BMFont text descriptor (~.fnt~) and its page with ~FromBMFont~. The atlas
+ * should be white on transparent so text can be tinted through vertex colors.
+ * Characters with no glyph are drawn as the fallback, ~?~ by default, or
+ * skipped if there is none.
+ */
+class BitmapFont {
+ public:
+  /**
+   * Glyphs from a sheet of ~cell_w~ by ~cell_h~ cells, left to right then top
+   * to bottom, holding consecutive characters from ~first~.
+   */
+  static MayError<BitmapFont> FromGrid(Renderer* const renderer,
+                                       Surface* const sheet,
+                                       int const cell_w,
+                                       int const cell_h,
+                                       Uint32 const first = ' ') {
+    SDLRAII_COLD_IF(cell_w <= 0 || cell_h <= 0 || sheet->w < cell_w
+                    || sheet->h < cell_h)
+      return sdl::Error{"BitmapFont: sheet smaller than a cell"};
+    auto font = upload(renderer, sheet);
+    SDLRAII_BAIL_ERROR(font);
+    auto& f        = font.get();
+    f.line_height_ = cell_h;
+    f.base_        = cell_h;
+    auto const columns = sheet->w / cell_w;
+    auto const count   = columns * (sheet->h / cell_h);
+    for(int i = 0; i < count; ++i)
+      f.add(first + static_cast<Uint32>(i),
+            Glyph{{i % columns * cell_w, i / columns * cell_h, cell_w, cell_h},
+                  0,
+                  0,
+                  cell_w});
+    return font;
+  }
+
+  /**
+   * Glyphs and kerning from a BMFont text descriptor whose only page is
+   * ~page~. Multi-page fonts would need one draw per page, so they are
+   * refused; pack them onto one page instead.
+   */
+  static MayError<BitmapFont> FromBMFont(Renderer* const renderer,
+                                         std::string_view const descriptor,
+                                         Surface* const page) {
+    auto font = upload(renderer, page);
+    SDLRAII_BAIL_ERROR(font);
+    auto& f = font.get();
+    for(auto rest = descriptor; !rest.empty();) {
+      auto const end = std::min(rest.find('\n'), rest.size());
+      impl::BMFontLine const line{rest.substr(0, end)};
+      rest.remove_prefix(std::min(end + 1, rest.size()));
+      if(line.tag == "common") {
+        SDLRAII_COLD_IF(line.get("pages", 1) != 1)
+          return sdl::Error{"BitmapFont: multi-page BMFont"};
+        f.line_height_ = line.get("lineHeight");
+        f.base_        = line.get("base");
+      } else if(line.tag == "char") {
+        SDLRAII_COLD_IF(line.get("page") != 0)
+          return sdl::Error{"BitmapFont: multi-page BMFont"};
+        f.add(static_cast<Uint32>(line.get("id")),
+              Glyph{{line.get("x"),
+                     line.get("y"),
+                     line.get("width"),
+                     line.get("height")},
+                    line.get("xoffset"),
+                    line.get("yoffset"),
+                    line.get("xadvance")});
+      } else if(line.tag == "kerning") {
+        f.kerning_[pair(static_cast<Uint32>(line.get("first")),
+                        static_cast<Uint32>(line.get("second")))] =
+            line.get("amount");
+      }
+    }
+    SDLRAII_COLD_IF(f.line_height_ <= 0)
+      return sdl::Error{"BitmapFont: no common line in BMFont descriptor"};
+    return font;
+  }
+
+  BitmapFont(BitmapFont&&) noexcept = default;
+  BitmapFont(BitmapFont const&) = delete;
+  BitmapFont& operator=(BitmapFont const&) = delete;
+
+  Glyph const* find(Uint32 const cp) const noexcept {
+    if(cp < latin1) return present_[cp] ? &latin1_[cp] : nullptr;
+    auto const it = other_.find(cp);
+    return it == other_.end() ? nullptr : &it->second;
+  }
+  /** ~find~, falling back to the fallback glyph. */
+  Glyph const* glyph(Uint32 const cp) const noexcept {
+    if(auto const* const g = find(cp)) return g;
+    return find(fallback_);
+  }
+  int kerning(Uint32 const first, Uint32 const second) const noexcept {
+    if(kerning_.empty()) return 0;
+    auto const it = kerning_.find(pair(first, second));
+    return it == kerning_.end() ? 0 : it->second;
+  }
+  void set_fallback(Uint32 const cp) noexcept { fallback_ = cp; }
+
+  Texture* texture() const noexcept { return texture_.get(); }
+  int atlas_w() const noexcept { return atlas_w_; }
+  int atlas_h() const noexcept { return atlas_h_; }
+  int line_height() const noexcept { return line_height_; }
+  /** From the top of a line to the baseline. */
+  int base() const noexcept { return base_; }
+
+ private:
+  static constexpr Uint32 latin1 = 256;
+
+  explicit BitmapFont(UniqueTexture texture, int const w, int const h) noexcept
+      : texture_{std::move(texture)}, atlas_w_{w}, atlas_h_{h} {}
+
+  static MayError<BitmapFont> upload(Renderer* const renderer,
+                                     Surface* const atlas) {
+    auto texture = CreateTextureFromSurface(renderer, atlas);
+    SDLRAII_BAIL_ERROR(texture);
+    auto const blend =
+        SetTextureBlendMode(texture.get().get(), BlendMode::blend);
+    SDLRAII_BAIL_ERROR(blend);
+    return BitmapFont{std::move(texture.get()), atlas->w, atlas->h};
+  }
+
+  static constexpr Uint64 pair(Uint32 const first,
+                               Uint32 const second) noexcept {
+    return static_cast<Uint64>(first) << 32 | second;
+  }
+
+  void add(Uint32 const cp, Glyph const& g) {
+    if(cp < latin1) {
+      latin1_[cp]  = g;
+      present_[cp] = true;
+    } else {
+      other_[cp] = g;
+    }
+  }
+
+  UniqueTexture texture_;
+  int atlas_w_;
+  int atlas_h_;
+  int line_height_ = 0;
+  int base_        = 0;
+  Uint32 fallback_ = '?';
+  // a table for the common case, a map for the rest
+  std::vector<Glyph> latin1_ = std::vector<Glyph>(latin1);
+  std::vector<bool> present_ = std::vector<bool>(latin1);
+  std::unordered_map<Uint32, Glyph> other_;
+  std::unordered_map<Uint64, int> kerning_;
+};
+
+enum class text_align : Uint8 { left, center, right };
+
+/** How a string is laid out. The color is not part of it; see ~queue~. */
+struct TextStyle {
+  float scale      = 1;
+  int wrap_width   = 0; // in pixels, breaking at spaces; 0 to not wrap
+  text_align align = text_align::left;
+
+  friend bool operator==(TextStyle const&, TextStyle const&) = default;
+};
+
+/**
+ * A laid-out string: four white vertices per glyph, top left, top right,
+ * bottom left, bottom right, placed relative to the top left of the text.
+ */
+struct TextLayout {
+  std::vector<Vertex> vertices;
+  FPoint size{}; // of the text block, in pixels
+
+  std::size_t glyphs() const noexcept { return vertices.size() / 4; }
+};
+
+/**
+ * Place the glyphs of UTF-8 ~text~, applying kerning, breaking lines at
+ * ~\n~ and, with a ~wrap_width~, at the last space that fits.
+ */
+inline TextLayout LayoutText(BitmapFont const& font,
+                             std::string_view const text,
+                             TextStyle const& style = {}) {
+  struct Line {
+    std::size_t first, last; // quads
+    int width;
+  };
+  constexpr auto none = static_cast<std::size_t>(-1);
+  TextLayout out;
+  out.vertices.reserve(text.size() * 4);
+  std::vector<Line> lines;
+  auto& v = out.vertices;
+  auto const quads = [&] { return v.size() / 4; };
+  auto const shift = [&](std::size_t const first,
+                         std::size_t const last,
+                         float const dx,
+                         float const dy) {
+    for(auto i = first * 4; i < last * 4; ++i) {
+      v[i].position.x += dx;
+      v[i].position.y += dy;
+    }
+  };
+  auto const lh   = font.line_height();
+  auto const wrap = style.wrap_width > 0
+                      ? std::max(1, static_cast<int>(style.wrap_width
+                                                     / style.scale))
+                      : 0;
+  auto const u = 1.0f / static_cast<float>(font.atlas_w());
+  auto const t = 1.0f / static_cast<float>(font.atlas_h());
+
+  int pen = 0, y = 0, width = 0;
+  std::size_t first = 0;
+  // the first glyph after the last space on this line, and where it started
+  std::size_t after_space = none;
+  int space_pen = 0, space_width = 0;
+  Uint32 prev = 0;
+  auto const new_line = [&](std::size_t const last, int const w) {
+    lines.push_back({first, last, w});
+    y += lh;
+    first = last;
+  };
+
+  for(std::size_t i = 0; i < text.size();) {
+    auto const cp = impl::next_codepoint(text, i);
+    if(cp == '\n') {
+      new_line(quads(), width);
+      pen = width = 0;
+      after_space = none;
+      prev        = 0;
+      continue;
+    }
+    auto const* const g = font.glyph(cp);
+    if(g == nullptr) continue;
+    if(prev != 0) pen += font.kerning(prev, cp);
+    prev = cp;
+    if(cp == ' ') {
+      space_width = width;
+      pen += g->xadvance;
+      after_space = quads();
+      space_pen   = pen;
+      continue;
+    }
+    if(wrap > 0 && pen > 0 && pen + g->xadvance > wrap) {
+      if(after_space != none) {
+        // move the word so far down to the start of the next line
+        new_line(after_space, space_width);
+        shift(first, quads(), static_cast<float>(-space_pen),
+              static_cast<float>(lh));
+        pen -= space_pen;
+        width -= space_pen;
+      } else {
+        // one word wider than the line: break it here
+        new_line(quads(), width);
+        pen = width = 0;
+      }
+      after_space = none;
+    }
+    if(g->src.w > 0 && g->src.h > 0) {
+      auto const x0 = static_cast<float>(pen + g->xoffset);
+      auto const y0 = static_cast<float>(y + g->yoffset);
+      auto const x1 = x0 + static_cast<float>(g->src.w);
+      auto const y1 = y0 + static_cast<float>(g->src.h);
+      auto const u0 = static_cast<float>(g->src.x) * u;
+      auto const v0 = static_cast<float>(g->src.y) * t;
+      auto const u1 = static_cast<float>(g->src.x + g->src.w) * u;
+      auto const v1 = static_cast<float>(g->src.y + g->src.h) * t;
+      SDL_Color const white{255, 255, 255, 255};
+      v.push_back({{x0, y0}, white, {u0, v0}});
+      v.push_back({{x1, y0}, white, {u1, v0}});
+      v.push_back({{x0, y1}, white, {u0, v1}});
+      v.push_back({{x1, y1}, white, {u1, v1}});
+    }
+    pen += g->xadvance;
+    width = pen;
+  }
+  new_line(quads(), width);
+
+  int widest = 0;
+  for(auto const& line : lines) widest = std::max(widest, line.width);
+  auto const box = wrap > 0 ? wrap : widest;
+  if(style.align != text_align::left)
+    for(auto const& line : lines) {
+      auto const slack = box - line.width;
+      shift(line.first,
+            line.last,
+            static_cast<float>(style.align == text_align::center ? slack / 2
+                                                                 : slack),
+            0);
+    }
+  if(style.scale != 1)
+    for(auto& vertex : v) {
+      vertex.position.x *= style.scale;
+      vertex.position.y *= style.scale;
+    }
+  out.size = {static_cast<float>(widest) * style.scale,
+              static_cast<float>(y) * style.scale};
+  return out;
+}
+
+/**
+ * Draws text in a ~BitmapFont~ with one ~RenderGeometry~ call per batch.
+ *
+ * Layouts are cached by string and style, so text that repeats from frame to
+ * frame is laid out once; ~end_frame~ drops those unused for
+ * ~max_idle_frames~. ~queue~ copies a cached layout into the batch, moved to
+ * its position and tinted, and ~flush~ draws everything queued with the
+ * atlas at once, so a HUD costs one draw call however many strings it has.
+ * Vertex positions are not rounded; give whole-pixel positions to keep text
+ * crisp.
+ *
+ * To draw into a ~Compositor~ instead, ~flush~ it there with the atlas as an
+ * ARGB8888 surface, e.g. the sheet or page the font was made from.
+ */
+class TextRenderer {
+ public:
+  static constexpr Uint64 default_max_idle_frames = 60;
+
+  struct Stats {
+    std::size_t hits   = 0; // layouts found in the cache
+    std::size_t misses = 0;
+    std::size_t glyphs = 0; // drawn
+    std::size_t draws  = 0; // ~RenderGeometry~ or ~Compositor::geometry~ calls
+  };
+
+  explicit TextRenderer(
+      BitmapFont const& font,
+      Uint64 const max_idle_frames = default_max_idle_frames)
+      : font_{&font}, max_idle_frames_{max_idle_frames} {}
+
+  /** The cached layout of ~text~. The reference lasts until ~end_frame~. */
+  TextLayout const& layout(std::string_view const text,
+                           TextStyle const& style = {}) {
+    auto it = cache_.find(KeyView{text, style});
+    if(it == cache_.end()) {
+      ++stats_.misses;
+      it = cache_
+               .emplace(Key{std::string{text}, style},
+                        Entry{LayoutText(*font_, text, style), frame_})
+               .first;
+    } else {
+      ++stats_.hits;
+      it->second.used = frame_;
+    }
+    return it->second.layout;
+  }
+
+  FPoint measure(std::string_view const text, TextStyle const& style = {}) {
+    return layout(text, style).size;
+  }
+
+  /** Add ~text~ to the batch, its top left at ~at~. */
+  void queue(std::string_view const text,
+             FPoint const at,
+             rgba const color     = {255, 255, 255, 255},
+             TextStyle const& style = {}) {
+    auto const& laid = layout(text, style);
+    SDL_Color const tint{color.r, color.g, color.b, color.a};
+    auto const base = batch_.size();
+    batch_.resize(base + laid.vertices.size());
+    auto* out = batch_.data() + base;
+    for(auto const& vertex : laid.vertices) {
+      *out++ = {{vertex.position.x + at.x, vertex.position.y + at.y},
+                tint,
+                vertex.tex_coord};
+    }
+  }
+
+  /** Draw everything queued since the last flush. */
+  MayError<void> flush(Renderer* const renderer) {
+    if(batch_.empty()) return {};
+    auto const quads = batch_.size() / 4;
+    auto const drawn = RenderGeometry(
+        renderer, font_->texture(), std::span<Vertex const>{batch_}, indices());
+    batch_.clear();
+    SDLRAII_BAIL_ERROR(drawn);
+    stats_.glyphs += quads;
+    ++stats_.draws;
+    return {};
+  }
+  /** As above, into ~compositor~, with ~atlas~ the font's atlas. */
+  MayError<void> flush(Compositor& compositor, Surface* const atlas) {
+    if(batch_.empty()) return {};
+    SDLRAII_COLD_IF(atlas == nullptr || atlas->w != font_->atlas_w()
+                    || atlas->h != font_->atlas_h()) {
+      batch_.clear();
+      return sdl::Error{"TextRenderer: atlas size differs from the font's"};
+    }
+    auto const quads = batch_.size() / 4;
+    auto const drawn = compositor.geometry(
+        atlas, std::span<Vertex const>{batch_}, indices());
+    batch_.clear();
+    SDLRAII_BAIL_ERROR(drawn);
+    stats_.glyphs += quads;
+    ++stats_.draws;
+    return {};
+  }
+
+  MayError<void> draw(Renderer* const renderer,
+                      std::string_view const text,
+                      FPoint const at,
+                      rgba const color     = {255, 255, 255, 255},
+                      TextStyle const& style = {}) {
+    queue(text, at, color, style);
+    return flush(renderer);
+  }
+
+  /** Drop layouts not used for ~max_idle_frames~. */
+  void end_frame() {
+    ++frame_;
+    std::erase_if(cache_, [&](auto const& entry) {
+      return frame_ - entry.second.used > max_idle_frames_;
+    });
+  }
+
+  void clear() noexcept { cache_.clear(); }
+
+  std::size_t cached() const noexcept { return cache_.size(); }
+  Stats stats() const noexcept { return stats_; }
+  BitmapFont const& font() const noexcept { return *font_; }
+
+ private:
+  struct Key {
+    std::string text;
+    TextStyle style;
+  };
+  struct KeyView {
+    std::string_view text;
+    TextStyle style;
+  };
+  struct Hash {
+    using is_transparent = void;
+    std::size_t operator()(KeyView const& k) const noexcept {
+      auto h = impl::fnv1a(k.text);
+      h ^= std::hash<float>{}(k.style.scale) + 0x9e3779b97f4a7c15 + (h << 6);
+      h ^= static_cast<Uint64>(k.style.wrap_width) << 8
+         | static_cast<Uint64>(k.style.align);
+      return static_cast<std::size_t>(h);
+    }
+    std::size_t operator()(Key const& k) const noexcept {
+      return (*this)(KeyView{k.text, k.style});
+    }
+  };
+  struct Equal {
+    using is_transparent = void;
+    static KeyView view(Key const& k) noexcept { return {k.text, k.style}; }
+    static KeyView view(KeyView const& k) noexcept { return k; }
+    template<class A, class B>
+    bool operator()(A const& a, B const& b) const noexcept {
+      return view(a).text == view(b).text && view(a).style == view(b).style;
+    }
+  };
+  struct Entry {
+    TextLayout layout;
+    Uint64 used; // the frame it was last asked for in
+  };
+
+  /** Indices for the quads in ~batch_~. */
+  std::span<int const> indices() {
+    auto const quads = batch_.size() / 4;
+    // two triangles per quad, split from top left to bottom right: SDL's
+    // software renderer only draws a pair split that way as one copy
+    for(auto q = indices_.size() / 6; q < quads; ++q) {
+      auto const i = static_cast<int>(q * 4);
+      indices_.insert(indices_.end(), {i, i + 1, i + 3, i, i + 3, i + 2});
+    }
+    return {indices_.data(), quads * 6};
+  }
+
+  BitmapFont const* font_;
+  Uint64 max_idle_frames_;
+  Uint64 frame_ = 0;
+  std::unordered_map<Key, Entry, Hash, Equal> cache_;
+  std::vector<Vertex> batch_;
+  std::vector<int> indices_;
+  Stats stats_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_TEXT_INCLUDE_GUARD
@@ -0,0 +1,170 @@
+#ifndef SDLRAII_TEXTURE_CACHE_INCLUDE_GUARD
+#define SDLRAII_TEXTURE_CACHE_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace sdl {
+
+/**
+ * Textures keyed by asset name, loaded on demand and evicted least recently
+ * used first once their estimated size passes a budget.
+ *
+ * A miss runs the loader (~LoadBMP~ by default) and uploads the surface with
+ * ~CreateTextureFromSurface~. Cost is ~w * h * bytes-per-pixel~ from
+ * ~QueryTexture~. Anything fetched since the last ~end_frame~ is pinned, so the
+ * pointers handed out stay valid until the frame ends even if that puts the
+ * cache over budget for a while; the excess is evicted at ~end_frame~.
+ */
+class TextureCache {
+ public:
+  using Loader = std::function<MayError<UniqueSurface>(char const*)>;
+
+  TextureCache(Renderer* const renderer,
+               std::size_t const budget_bytes,
+               Loader loader = [](char const* const file) {
+                 return LoadBMP(file);
+               })
+      : renderer_{renderer},
+        budget_{budget_bytes},
+        loader_{std::move(loader)} {}
+  TextureCache(TextureCache const&) = delete;
+  TextureCache& operator=(TextureCache const&) = delete;
+
+  /** The texture for ~key~, loading it from the file of that name on a miss. */
+  MayError<Texture*> get(std::string const& key) {
+    if(auto* const texture = find(key)) return texture;
+    auto surface = loader_(key.c_str());
+    SDLRAII_BAIL_ERROR(surface);
+    return insert(key, surface.get().get());
+  }
+
+  /** The texture for ~key~ if cached, else ~nullptr~. Counts as a use. */
+  Texture* find(std::string_view const key) noexcept {
+    auto const it = index_.find(key);
+    SDLRAII_COLD_IF(it == index_.end()) {
+      ++misses_;
+      return nullptr;
+    }
+    ++hits_;
+    touch(it->second);
+    return it->second->texture.get();
+  }
+
+  /**
+   * Upload ~surface~ under ~key~. Any texture already there is destroyed, even
+   * if it was fetched this frame.
+   */
+  MayError<Texture*> insert(std::string const& key, Surface* const surface) {
+    auto created = CreateTextureFromSurface(renderer_, surface);
+    SDLRAII_BAIL_ERROR(created);
+    auto const info = QueryTexture(created.get().get());
+    SDLRAII_BAIL_ERROR(info);
+    erase(key);
+    auto const& [format, access, w, h] = info.get();
+    auto const bytes = static_cast<std::size_t>(w) * static_cast<std::size_t>(h)
+                     * SDL_BYTESPERPIXEL(format);
+    lru_.emplace_front(key, std::move(created.get()), bytes, frame_);
+    index_.emplace(lru_.front().key, lru_.begin());
+    bytes_ += bytes;
+    evict();
+    return lru_.front().texture.get();
+  }
+
+  bool erase(std::string_view const key) noexcept {
+    auto const it = index_.find(key);
+    if(it == index_.end()) return false;
+    auto const entry = it->second;
+    bytes_ -= entry->bytes;
+    index_.erase(it);
+    lru_.erase(entry);
+    return true;
+  }
+
+  /** Unpin this frame's textures and evict down to the budget. */
+  void end_frame() {
+    ++frame_;
+    evict();
+  }
+
+  void set_budget(std::size_t const budget_bytes) {
+    budget_ = budget_bytes;
+    evict();
+  }
+
+  void clear() noexcept {
+    index_.clear();
+    lru_.clear();
+    bytes_ = 0;
+  }
+
+  std::size_t size() const noexcept { return lru_.size(); }
+  std::size_t bytes() const noexcept { return bytes_; }
+  std::size_t budget() const noexcept { return budget_; }
+  std::size_t hits() const noexcept { return hits_; }
+  std::size_t misses() const noexcept { return misses_; }
+  std::size_t evictions() const noexcept { return evictions_; }
+
+ private:
+  struct Entry {
+    Entry(std::string key,
+          UniqueTexture texture,
+          std::size_t const bytes,
+          Uint64 const used) noexcept
+        : key{std::move(key)},
+          texture{std::move(texture)},
+          bytes{bytes},
+          used{used} {}
+
+    std::string key;
+    UniqueTexture texture;
+    std::size_t bytes;
+    Uint64 used; // the frame it was last fetched in
+  };
+  using List = std::list<Entry>;
+
+  void touch(List::iterator const entry) noexcept {
+    entry->used = frame_;
+    lru_.splice(lru_.begin(), lru_, entry);
+  }
+
+  // the list is in recency order, so the first pinned entry from the back
+  // means everything in front of it is pinned too
+  void evict() noexcept {
+    while(bytes_ > budget_ && !lru_.empty() && lru_.back().used != frame_) {
+      auto& victim = lru_.back();
+      bytes_ -= victim.bytes;
+      index_.erase(victim.key);
+      lru_.pop_back();
+      ++evictions_;
+    }
+  }
+
+  Renderer* renderer_;
+  std::size_t budget_;
+  Loader loader_;
+  List lru_; // most recently used first
+  // keys view into the list entries, whose nodes never move
+  std::unordered_map<std::string_view, List::iterator> index_;
+  std::size_t bytes_     = 0;
+  Uint64 frame_          = 0;
+  std::size_t hits_      = 0;
+  std::size_t misses_    = 0;
+  std::size_t evictions_ = 0;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_TEXTURE_CACHE_INCLUDE_GUARD
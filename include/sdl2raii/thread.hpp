@@ -0,0 +1,254 @@
+#ifndef SDLRAII_THREAD_INCLUDE_GUARD
+#define SDLRAII_THREAD_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+#define SDLRAII_THE_PREFIX SDL
+#include "wrapgen_macros.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sdl {
+
+// https://wiki.libsdl.org/CategoryThread
+SDLRAII_WRAP_TYPE(Thread);
+SDLRAII_WRAP_TYPE(threadID);
+SDLRAII_WRAP_TYPE(ThreadFunction);
+SDLRAII_WRAP_TYPE(ThreadPriority);
+SDLRAII_WRAP_TYPE(mutex);
+SDLRAII_WRAP_TYPE(cond);
+SDLRAII_WRAP_TYPE(sem);
+SDLRAII_WRAP_TYPE(atomic_t);
+SDLRAII_WRAP_TYPE(SpinLock);
+
+namespace impl {
+inline void join_thread(Thread* const thread) noexcept {
+  SDL_WaitThread(thread, nullptr);
+}
+} // namespace impl
+
+/**
+ * A thread that is joined (~SDL_WaitThread~) when it goes out of scope.
+ * Use ~DetachThread~ to let it run on its own instead.
+ */
+SDLRAII_DEFUNIQUE(Thread, impl::join_thread);
+SDLRAII_DEFUNIQUE_(UniqueMutex, SDLRAII_GENSYM(ptr), mutex, SDL_DestroyMutex);
+SDLRAII_DEFUNIQUE_(UniqueCond, SDLRAII_GENSYM(ptr), cond, SDL_DestroyCond);
+SDLRAII_DEFUNIQUE_(UniqueSem, SDLRAII_GENSYM(ptr), sem, SDL_DestroySemaphore);
+
+SDLRAII_WRAP_MAKER(UniqueMutex, CreateMutex);
+SDLRAII_WRAP_MAKER(UniqueCond, CreateCond);
+SDLRAII_WRAP_MAKER(UniqueSem, CreateSemaphore);
+
+// SDL_CreateThread is a macro on Windows, so it can't go through WRAP_MAKER
+inline MayError<UniqueThread> CreateThread(ThreadFunction const fn,
+                                           char const* const name,
+                                           void* const data) noexcept {
+  auto* const thread = SDL_CreateThread(fn, name, data);
+  SDLRAII_COLD_IF(thread == nullptr)
+    return sdl::GetError();
+  return UniqueThread{thread};
+}
+
+/**
+ * Runs ~fn()~ on a new thread. ~fn~ may return an ~int~ status (as
+ * ~SDL_ThreadFunction~ does) or nothing, which reads as 0.
+ */
+template<class Fn>
+requires std::is_invocable_v<Fn&>
+inline MayError<UniqueThread> CreateThread(char const* const name, Fn fn) {
+  auto owned = std::make_unique<Fn>(std::move(fn));
+  auto thread = CreateThread(
+      [](void* const state) -> int {
+        std::unique_ptr<Fn> const fn{static_cast<Fn*>(state)};
+        if constexpr(std::is_void_v<std::invoke_result_t<Fn&>>) {
+          (*fn)();
+          return 0;
+        } else {
+          return static_cast<int>((*fn)());
+        }
+      },
+      name,
+      owned.get());
+  if(thread.ok()) owned.release();
+  return thread;
+}
+
+/** Joins ~thread~ and returns its status instead of using an out parameter. */
+inline int WaitThread(UniqueThread thread) noexcept {
+  int status = 0;
+  SDL_WaitThread(thread.release(), &status);
+  return status;
+}
+inline void DetachThread(UniqueThread thread) noexcept {
+  SDL_DetachThread(thread.release());
+}
+
+SDLRAII_WRAP_FN(ThreadID, );
+SDLRAII_WRAP_FN(GetThreadID, );
+SDLRAII_WRAP_FN(SetThreadPriority, nonzero_error);
+SDLRAII_WRAP_FN(GetCPUCount, );
+SDLRAII_WRAP_FN(GetCPUCacheLineSize, );
+SDLRAII_WRAP_FN(HasSSE2, );
+SDLRAII_WRAP_FN(HasAVX2, );
+
+namespace thread {
+using priority                                  = SDL_ThreadPriority;
+[[maybe_unused]] constexpr auto priority_low    = SDL_THREAD_PRIORITY_LOW;
+[[maybe_unused]] constexpr auto priority_normal = SDL_THREAD_PRIORITY_NORMAL;
+[[maybe_unused]] constexpr auto priority_high   = SDL_THREAD_PRIORITY_HIGH;
+[[maybe_unused]] constexpr auto priority_time_critical =
+    SDL_THREAD_PRIORITY_TIME_CRITICAL;
+} // namespace thread
+
+// mutex
+SDLRAII_WRAP_FN(LockMutex, nonzero_error);
+SDLRAII_WRAP_FN(UnlockMutex, nonzero_error);
+
+/** ~true~ if the lock was taken, ~false~ if another thread holds it. */
+inline MayError<bool> TryLockMutex(mutex* const m) noexcept {
+  auto const result = SDL_TryLockMutex(m);
+  SDLRAII_COLD_IF(result < 0)
+    return sdl::GetError();
+  return result == 0;
+}
+
+/**
+ * Holds ~m~ locked for its lifetime. Locking only fails for a null mutex, so
+ * that is asserted rather than reported.
+ */
+class LockGuard {
+ public:
+  explicit LockGuard(mutex* const m) noexcept : mutex_{m} {
+    [[maybe_unused]] auto const locked = SDL_LockMutex(mutex_);
+    SDL_assert(locked == 0);
+  }
+  LockGuard(LockGuard const&) = delete;
+  LockGuard& operator=(LockGuard const&) = delete;
+  ~LockGuard() { SDL_UnlockMutex(mutex_); }
+
+  mutex* get() const noexcept { return mutex_; }
+
+ private:
+  mutex* mutex_;
+};
+
+// condition variables
+SDLRAII_WRAP_FN(CondSignal, nonzero_error);
+SDLRAII_WRAP_FN(CondBroadcast, nonzero_error);
+SDLRAII_WRAP_FN(CondWait, nonzero_error);
+inline auto CondWait(cond* const c, LockGuard const& lock)
+    SDLRAII_BODY_EXP(CondWait(c, lock.get()))
+
+/** ~true~ if signaled, ~false~ on timeout. */
+inline MayError<bool>
+    CondWaitTimeout(cond* const c, mutex* const m, Uint32 const ms) noexcept {
+  auto const result = SDL_CondWaitTimeout(c, m, ms);
+  SDLRAII_COLD_IF(result < 0)
+    return sdl::GetError();
+  return result == 0;
+}
+inline auto
+    CondWaitTimeout(cond* const c, LockGuard const& lock, Uint32 const ms)
+        SDLRAII_BODY_EXP(CondWaitTimeout(c, lock.get(), ms))
+
+// semaphores
+SDLRAII_WRAP_FN(SemWait, nonzero_error);
+SDLRAII_WRAP_FN(SemPost, nonzero_error);
+SDLRAII_WRAP_FN(SemValue, );
+
+/** ~true~ if the semaphore was decremented, ~false~ if it would block. */
+inline MayError<bool> SemTryWait(sem* const s) noexcept {
+  auto const result = SDL_SemTryWait(s);
+  SDLRAII_COLD_IF(result < 0)
+    return sdl::GetError();
+  return result == 0;
+}
+/** ~true~ if the semaphore was decremented, ~false~ on timeout. */
+inline MayError<bool> SemWaitTimeout(sem* const s, Uint32 const ms) noexcept {
+  auto const result = SDL_SemWaitTimeout(s, ms);
+  SDLRAII_COLD_IF(result < 0)
+    return sdl::GetError();
+  return result == 0;
+}
+
+// atomics
+// https://wiki.libsdl.org/CategoryAtomic
+
+/**
+ * An ~SDL_atomic_t~ with its operations as members. Every operation is a full
+ * memory barrier, as in SDL.
+ */
+class AtomicInt {
+ public:
+  AtomicInt() = default;
+  explicit AtomicInt(int const value) noexcept {
+    SDL_AtomicSet(&value_, value);
+  }
+  AtomicInt(AtomicInt const&) = delete;
+  AtomicInt& operator=(AtomicInt const&) = delete;
+
+  int get() noexcept { return SDL_AtomicGet(&value_); }
+  /** Returns the previous value. */
+  int set(int const value) noexcept { return SDL_AtomicSet(&value_, value); }
+  /** Returns the previous value. */
+  int add(int const value) noexcept { return SDL_AtomicAdd(&value_, value); }
+  bool compare_and_swap(int const expected, int const desired) noexcept {
+    return SDL_AtomicCAS(&value_, expected, desired);
+  }
+
+  atomic_t* get_raw() noexcept { return &value_; }
+
+ private:
+  atomic_t value_{};
+};
+
+/** A pointer updated with ~SDL_AtomicGetPtr~ and friends. */
+template<class T>
+class AtomicPtr {
+ public:
+  AtomicPtr() = default;
+  explicit AtomicPtr(T* const value) noexcept { set(value); }
+  AtomicPtr(AtomicPtr const&) = delete;
+  AtomicPtr& operator=(AtomicPtr const&) = delete;
+
+  T* get() noexcept { return static_cast<T*>(SDL_AtomicGetPtr(&value_)); }
+  T* set(T* const value) noexcept {
+    return static_cast<T*>(SDL_AtomicSetPtr(&value_, value));
+  }
+  bool compare_and_swap(T* const expected, T* const desired) noexcept {
+    return SDL_AtomicCASPtr(&value_, expected, desired);
+  }
+
+ private:
+  void* value_ = nullptr;
+};
+
+/**
+ * An ~SDL_SpinLock~. Models BasicLockable, so ~std::lock_guard~ and
+ * ~std::scoped_lock~ work with it.
+ */
+class SpinMutex {
+ public:
+  SpinMutex() = default;
+  SpinMutex(SpinMutex const&) = delete;
+  SpinMutex& operator=(SpinMutex const&) = delete;
+
+  void lock() noexcept { SDL_AtomicLock(&lock_); }
+  bool try_lock() noexcept { return SDL_AtomicTryLock(&lock_); }
+  void unlock() noexcept { SDL_AtomicUnlock(&lock_); }
+
+ private:
+  SpinLock lock_ = 0;
+};
+
+} // namespace sdl
+#undef SDLRAII_THE_PREFIX
+
+#endif // SDLRAII_THREAD_INCLUDE_GUARD
@@ -0,0 +1,313 @@
+#ifndef SDLRAII_TILEMAP_INCLUDE_GUARD
+#define SDLRAII_TILEMAP_INCLUDE_GUARD
+
+#include "sdl.hpp"
+#include "render_target.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+
+using tile_id = Uint16;
+
+/**
+ * Tiles of one size on a texture, numbered from 1 left to right then top to
+ * bottom, as Tiled does. Tile 0 is empty.
+ */
+struct Tileset {
+  Texture* texture = nullptr;
+  int tile_w       = 0;
+  int tile_h       = 0;
+  int columns      = 1; // tiles per row of the texture
+  int margin       = 0; // around the edge of the texture
+  int spacing      = 0; // between tiles
+
+  Rect src(tile_id const tile) const noexcept {
+    auto const i = tile - 1;
+    return {margin + i % columns * (tile_w + spacing),
+            margin + i / columns * (tile_h + spacing),
+            tile_w,
+            tile_h};
+  }
+};
+
+namespace impl {
+constexpr int floor_div(int const a, int const b) noexcept {
+  return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+} // namespace impl
+
+/**
+ * One layer of a tile map, drawn from cached chunks rather than tile by tile.
+ *
+ * The layer is cut into square chunks of ~chunk_tiles~ tiles. The first time a
+ * chunk is seen it is rendered into a target texture from ~pool~; after that,
+ * drawing it is one ~RenderCopy~ until one of its tiles changes. ~draw~ only
+ * touches the chunks that intersect the view, and chunks with no tiles have no
+ * texture at all. ~end_frame~ gives the textures of chunks not drawn for
+ * ~max_idle_frames~ back to the pool, so scrolling across a huge map keeps
+ * only the neighbourhood of the view in video memory.
+ *
+ * Layers of a map can share one pool, which must outlive them. After
+ * ~SDL_RENDER_TARGETS_RESET~, call ~invalidate~ to re-render every chunk.
+ */
+class TileLayer {
+ public:
+  static constexpr int default_chunk_tiles        = 32;
+  static constexpr Uint64 default_max_idle_frames = 60;
+
+  struct Stats {
+    std::size_t chunks_drawn   = 0;
+    std::size_t chunks_rebuilt = 0;
+    std::size_t tiles_rebuilt  = 0; // ~RenderCopy~s into chunk textures
+  };
+
+  TileLayer(Renderer* const renderer,
+            RenderTargetPool& pool,
+            Tileset const& tileset,
+            int const w,
+            int const h,
+            int const chunk_tiles        = default_chunk_tiles,
+            Uint64 const max_idle_frames = default_max_idle_frames)
+      : renderer_{renderer},
+        pool_{&pool},
+        tileset_{tileset},
+        w_{std::max(w, 0)},
+        h_{std::max(h, 0)},
+        chunk_tiles_{std::max(chunk_tiles, 1)},
+        chunks_w_{(w_ + chunk_tiles_ - 1) / chunk_tiles_},
+        chunks_h_{(h_ + chunk_tiles_ - 1) / chunk_tiles_},
+        max_idle_frames_{max_idle_frames},
+        tiles_(static_cast<std::size_t>(w_) * static_cast<std::size_t>(h_)),
+        chunks_(static_cast<std::size_t>(chunks_w_)
+                * static_cast<std::size_t>(chunks_h_)) {}
+  TileLayer(TileLayer&&) noexcept = default;
+  TileLayer(TileLayer const&) = delete;
+  TileLayer& operator=(TileLayer const&) = delete;
+  ~TileLayer() {
+    for(auto const i : resident_) unload(chunks_[i]);
+  }
+
+  int w() const noexcept { return w_; }
+  int h() const noexcept { return h_; }
+  int chunk_tiles() const noexcept { return chunk_tiles_; }
+  Tileset const& tileset() const noexcept { return tileset_; }
+  /** Row by row. */
+  std::span<tile_id const> tiles() const noexcept { return tiles_; }
+
+  /** Tile 0 outside the layer. */
+  tile_id get(int const x, int const y) const noexcept {
+    if(!inside(x, y)) return 0;
+    return tiles_[index(x, y)];
+  }
+
+  void set(int const x, int const y, tile_id const tile) noexcept {
+    if(!inside(x, y)) return;
+    auto& old = tiles_[index(x, y)];
+    if(old == tile) return;
+    auto& chunk = chunk_at(x / chunk_tiles_, y / chunk_tiles_);
+    chunk.filled += (tile != 0) - (old != 0);
+    chunk.dirty = true;
+    old         = tile;
+  }
+
+  /** Set every tile in ~area~, clipped to the layer. */
+  void fill(Rect const area, tile_id const tile) noexcept {
+    auto const x0 = std::max(area.x, 0), y0 = std::max(area.y, 0);
+    auto const x1 = std::min(area.x + area.w, w_);
+    auto const y1 = std::min(area.y + area.h, h_);
+    for(auto y = y0; y < y1; ++y)
+      for(auto x = x0; x < x1; ++x) set(x, y, tile);
+  }
+
+  /** Render every chunk again the next time it is drawn. */
+  void invalidate() noexcept {
+    for(auto& chunk : chunks_) chunk.dirty = true;
+  }
+
+  /**
+   * Draw the part of the layer inside ~view~, in layer pixels, with the
+   * view's top left at ~at~ on the current target.
+   */
+  MayError<void> draw(Rect const view, Point const at = {0, 0}) {
+    auto const cw = chunk_tiles_ * tileset_.tile_w;
+    auto const ch = chunk_tiles_ * tileset_.tile_h;
+    auto const x0 = std::max(impl::floor_div(view.x, cw), 0);
+    auto const y0 = std::max(impl::floor_div(view.y, ch), 0);
+    auto const x1 =
+        std::min(impl::floor_div(view.x + view.w + cw - 1, cw), chunks_w_);
+    auto const y1 =
+        std::min(impl::floor_div(view.y + view.h + ch - 1, ch), chunks_h_);
+    if(x0 >= x1 || y0 >= y1) return {};
+
+    auto const rebuilt = rebuild(x0, y0, x1, y1);
+    SDLRAII_BAIL_ERROR(rebuilt);
+    for(auto cy = y0; cy < y1; ++cy)
+      for(auto cx = x0; cx < x1; ++cx) {
+        auto& chunk = chunk_at(cx, cy);
+        if(chunk.filled == 0) continue;
+        chunk.drawn = frame_;
+        // clip the chunk to the view, in layer pixels
+        Rect const area{cx * cw, cy * ch, cw, ch};
+        auto const shown = IntersectRect(area, view);
+        if(!shown) continue;
+        Rect const src{
+            shown->x - area.x, shown->y - area.y, shown->w, shown->h};
+        Rect const dst{shown->x - view.x + at.x,
+                       shown->y - view.y + at.y,
+                       shown->w,
+                       shown->h};
+        auto const copied =
+            RenderCopy(renderer_, chunk.texture.get(), &src, &dst);
+        SDLRAII_BAIL_ERROR(copied);
+        ++stats_.chunks_drawn;
+      }
+    return {};
+  }
+
+  /** Give back the textures of chunks not drawn for ~max_idle_frames~. */
+  void end_frame() {
+    ++frame_;
+    std::erase_if(resident_, [&](std::size_t const i) {
+      auto& chunk = chunks_[i];
+      if(chunk.filled != 0 && frame_ - chunk.drawn <= max_idle_frames_)
+        return false;
+      unload(chunk);
+      return true;
+    });
+  }
+
+  /** Chunks holding a texture. */
+  std::size_t resident() const noexcept { return resident_.size(); }
+  Stats stats() const noexcept { return stats_; }
+
+ private:
+  struct Chunk {
+    UniqueTexture texture;
+    int filled   = 0; // non-empty tiles
+    bool dirty   = true;
+    Uint64 drawn = 0;
+  };
+
+  bool inside(int const x, int const y) const noexcept {
+    return x >= 0 && y >= 0 && x < w_ && y < h_;
+  }
+  std::size_t index(int const x, int const y) const noexcept {
+    return static_cast<std::size_t>(y) * static_cast<std::size_t>(w_)
+         + static_cast<std::size_t>(x);
+  }
+  std::size_t chunk_index(int const cx, int const cy) const noexcept {
+    return static_cast<std::size_t>(cy) * static_cast<std::size_t>(chunks_w_)
+         + static_cast<std::size_t>(cx);
+  }
+  Chunk& chunk_at(int const cx, int const cy) noexcept {
+    return chunks_[chunk_index(cx, cy)];
+  }
+
+  void unload(Chunk& chunk) {
+    pool_->release(UniqueTexture{chunk.texture.release()});
+    chunk.dirty = true;
+  }
+
+  /**
+   * Render the stale chunks among those in range. The tileset is copied
+   * without blending, since tiles never overlap, so the chunk keeps the
+   * tileset's alpha rather than having it applied twice.
+   */
+  MayError<void>
+      rebuild(int const x0, int const y0, int const x1, int const y1) {
+    auto const stale = [&](Chunk const& c) {
+      return c.filled != 0 && (c.dirty || !c.texture);
+    };
+    bool any = false;
+    for(auto cy = y0; cy < y1 && !any; ++cy)
+      for(auto cx = x0; cx < x1 && !any; ++cx) any = stale(chunk_at(cx, cy));
+    if(!any) return {};
+
+    auto const color = GetRenderDrawColor(renderer_);
+    auto const blend = GetTextureBlendMode(tileset_.texture);
+    SDLRAII_BAIL_ERROR(blend);
+    auto const copy = SetTextureBlendMode(tileset_.texture, BlendMode::none);
+    SDLRAII_BAIL_ERROR(copy);
+    auto const result = [&]() -> MayError<void> {
+      for(auto cy = y0; cy < y1; ++cy)
+        for(auto cx = x0; cx < x1; ++cx) {
+          if(!stale(chunk_at(cx, cy))) continue;
+          auto const rendered = render_chunk(cx, cy);
+          SDLRAII_BAIL_ERROR(rendered);
+        }
+      return {};
+    }();
+    static_cast<void>(SetTextureBlendMode(tileset_.texture, blend.get()));
+    static_cast<void>(SetRenderDrawColor(renderer_, color));
+    return result;
+  }
+
+  MayError<void> render_chunk(int const cx, int const cy) {
+    auto& chunk = chunk_at(cx, cy);
+    if(!chunk.texture) {
+      auto texture = pool_->acquire(SDL_PIXELFORMAT_ARGB8888,
+                                    chunk_tiles_ * tileset_.tile_w,
+                                    chunk_tiles_ * tileset_.tile_h);
+      SDLRAII_BAIL_ERROR(texture);
+      chunk.texture.reset(texture.get().release());
+      resident_.push_back(chunk_index(cx, cy));
+      auto const blend =
+          SetTextureBlendMode(chunk.texture.get(), BlendMode::blend);
+      SDLRAII_BAIL_ERROR(blend);
+    }
+    auto const target = ScopedSetRenderTarget(renderer_, chunk.texture.get());
+    SDLRAII_BAIL_ERROR(target);
+    auto const cleared = SetRenderDrawColor(renderer_, rgba{0, 0, 0, 0});
+    SDLRAII_BAIL_ERROR(cleared);
+    auto const clear = RenderClear(renderer_);
+    SDLRAII_BAIL_ERROR(clear);
+
+    auto const tx0 = cx * chunk_tiles_, ty0 = cy * chunk_tiles_;
+    auto const tx1 = std::min(tx0 + chunk_tiles_, w_);
+    auto const ty1 = std::min(ty0 + chunk_tiles_, h_);
+    for(auto y = ty0; y < ty1; ++y)
+      for(auto x = tx0; x < tx1; ++x) {
+        auto const tile = tiles_[index(x, y)];
+        if(tile == 0) continue;
+        auto const src = tileset_.src(tile);
+        Rect const dst{(x - tx0) * tileset_.tile_w,
+                       (y - ty0) * tileset_.tile_h,
+                       tileset_.tile_w,
+                       tileset_.tile_h};
+        auto const copied =
+            RenderCopy(renderer_, tileset_.texture, &src, &dst);
+        SDLRAII_BAIL_ERROR(copied);
+        ++stats_.tiles_rebuilt;
+      }
+    chunk.dirty = false;
+    ++stats_.chunks_rebuilt;
+    return {};
+  }
+
+  Renderer* renderer_;
+  RenderTargetPool* pool_;
+  Tileset tileset_;
+  int w_, h_;
+  int chunk_tiles_;
+  int chunks_w_, chunks_h_;
+  Uint64 max_idle_frames_;
+  Uint64 frame_ = 0;
+  std::vector<tile_id> tiles_;
+  std::vector<Chunk> chunks_;
+  std::vector<std::size_t> resident_; // chunks with a texture
+  Stats stats_;
+};
+
+} // namespace sdl
+
+#endif // SDLRAII_TILEMAP_INCLUDE_GUARD
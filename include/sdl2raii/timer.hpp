@@ -0,0 +1,337 @@
+#ifndef SDLRAII_TIMER_INCLUDE_GUARD
+#define SDLRAII_TIMER_INCLUDE_GUARD
+
+#include "sdl.hpp"
+
+#include "compat_macros.hpp"
+#include "MayError.hpp"
+#define SDLRAII_THE_PREFIX SDL
+#include "wrapgen_macros.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace sdl {
+
+// https://wiki.libsdl.org/CategoryTimer
+SDLRAII_WRAP_TYPE(TimerID);
+SDLRAII_WRAP_TYPE(TimerCallback);
+
+SDLRAII_WRAP_FN(GetTicks, );
+SDLRAII_WRAP_FN(GetTicks64, );
+SDLRAII_WRAP_FN(GetPerformanceCounter, );
+SDLRAII_WRAP_FN(GetPerformanceFrequency, );
+SDLRAII_WRAP_FN(Delay, );
+
+/**
+ * Owns a timer from ~SDL_AddTimer~. Removed with ~SDL_RemoveTimer~.
+ * Timer IDs are integers, so this can't be a ~DEFUNIQUE~.
+ *
+ * When made from a C++ callable, the callable lives here too. SDL may still be
+ * running the callback on its timer thread while ~SDL_RemoveTimer~ returns, so
+ * don't destroy a timer whose callback might be mid-flight.
+ */
+class UniqueTimer {
+ public:
+  UniqueTimer() = default;
+  explicit UniqueTimer(TimerID const id) noexcept : id_{id} {}
+  UniqueTimer(TimerID const id, void* const state, void (*destroy)(void*))
+      : id_{id}, state_{state, destroy} {}
+
+  UniqueTimer(UniqueTimer&& other) noexcept
+      : id_{std::exchange(other.id_, 0)}, state_{std::move(other.state_)} {}
+  UniqueTimer& operator=(UniqueTimer other) noexcept {
+    std::swap(id_, other.id_);
+    std::swap(state_, other.state_);
+    return *this;
+  }
+  ~UniqueTimer() { reset(); }
+
+  void reset() noexcept {
+    if(id_ != 0) SDL_RemoveTimer(id_);
+    id_ = 0;
+    state_.reset();
+  }
+
+  TimerID get() const noexcept { return id_; }
+  explicit operator bool() const noexcept { return id_ != 0; }
+
+ private:
+  TimerID id_ = 0;
+  std::unique_ptr<void, void (*)(void*)> state_{nullptr, [](void*) {}};
+};
+
+inline MayError<UniqueTimer> AddTimer(Uint32 const interval,
+                                      TimerCallback const callback,
+                                      void* const param) noexcept {
+  auto const id = SDL_AddTimer(interval, callback, param);
+  SDLRAII_COLD_IF(id == 0)
+    return sdl::GetError();
+  return UniqueTimer{id};
+}
+
+/**
+ * Calls ~fn(interval)~ on SDL's timer thread. As with ~SDL_AddTimer~, the
+ * return value is the next interval, or 0 to stop.
+ */
+template<class Fn>
+requires std::is_invocable_r_v<Uint32, Fn&, Uint32>
+inline MayError<UniqueTimer> AddTimer(Uint32 const interval, Fn fn) {
+  auto owned = std::make_unique<Fn>(std::move(fn));
+  auto const id = SDL_AddTimer(
+      interval,
+      [](Uint32 const current, void* const state) -> Uint32 {
+        return (*static_cast<Fn*>(state))(current);
+      },
+      owned.get());
+  SDLRAII_COLD_IF(id == 0)
+    return sdl::GetError();
+  return UniqueTimer{id, owned.release(), [](void* const state) {
+                       delete static_cast<Fn*>(state);
+                     }};
+}
+
+/**
+ * A hierarchical timing wheel for timers driven from the main loop.
+ *
+ * Meant for many short-lived gameplay timers (cooldowns, scheduled events)
+ * where one SDL timer each would mean one callback per timer on another
+ * thread. Scheduling and cancelling are O(1); ~advance~ costs one step per
+ * occupied tick plus an occasional cascade of a coarser slot, and skips runs
+ * of empty ticks.
+ *
+ * Ticks are whatever unit the caller advances with, typically
+ * ~sdl::GetTicks64()~ milliseconds. The layout follows the classic Linux
+ * kernel wheel: 256 one-tick slots, then four levels of 64 slots, each
+ * 64 times coarser. Timers more than 2^32 ticks out are parked in the last
+ * level and re-filed as it cascades.
+ */
+template<class Callback = std::function<void()>>
+class TimingWheel {
+ public:
+  using tick_type = Uint64;
+
+  struct Handle {
+    Uint32 index      = nil;
+    Uint32 generation = 0;
+  };
+
+  explicit TimingWheel(tick_type const start = 0) noexcept
+      : now_{start}, next_{start} {
+    heads_.fill(nil);
+  }
+
+  /**
+   * The tick passed to the last ~advance~ (or the start tick). Inside a
+   * callback, the tick being fired.
+   */
+  tick_type now() const noexcept { return now_; }
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  /** Run ~callback~ on the first ~advance~ to reach ~when~. */
+  Handle schedule_at(tick_type const when, Callback callback) {
+    Uint32 i;
+    if(free_ != nil) {
+      i     = free_;
+      free_ = nodes_[i].next;
+    } else {
+      i = static_cast<Uint32>(nodes_.size());
+      nodes_.emplace_back();
+    }
+    auto& node    = nodes_[i];
+    node.expires  = when;
+    node.callback = std::move(callback);
+    link(i);
+    ++size_;
+    return {i, node.generation};
+  }
+  /**
+   * Run ~callback~ ~delay~ ticks after ~now()~. Timers due at or before the
+   * tick being fired run on the next one, so a callback re-arming itself with
+   * a ~delay~ of 0 runs once per tick rather than forever.
+   */
+  Handle schedule(tick_type const delay, Callback callback) {
+    return schedule_at(now_ + delay, std::move(callback));
+  }
+
+  bool pending(Handle const h) const noexcept {
+    return h.index < nodes_.size() && nodes_[h.index].generation == h.generation
+        && nodes_[h.index].slot != nil;
+  }
+
+  /** Returns false if the timer already ran or was cancelled. */
+  bool cancel(Handle const h) noexcept {
+    if(!pending(h)) return false;
+    unlink(h.index);
+    release(h.index);
+    return true;
+  }
+
+  /**
+   * Runs every timer due at or before ~now~, in expiry order. Callbacks may
+   * schedule and cancel timers, including themselves.
+   */
+  void advance(tick_type const now) {
+    while(next_ <= now) {
+      SDLRAII_COLD_IF(size_ == 0) {
+        next_ = now + 1;
+        break;
+      }
+      auto const index = static_cast<Uint32>(next_ & level0_mask);
+      if(index == 0) {
+        for(Uint32 level = 0; level < upper_levels; ++level)
+          if(cascade(level) != 0) break;
+      }
+
+      // jump over empty one-tick slots; cascades only happen on index 0, which
+      // a jump never skips past
+      auto const occupied = next_occupied(index);
+      if(occupied != index) {
+        next_ = std::min<tick_type>(next_ + (occupied - index), now + 1);
+        continue;
+      }
+
+      // detach the slot first: callbacks may file new timers into it. They
+      // see ~now()~ as the tick firing, so ~schedule~ counts from there
+      now_ = next_++;
+      auto const first = std::exchange(heads_[index], nil);
+      occupied_[index / 64] &= ~(Uint64{1} << (index % 64));
+      heads_[running] = first;
+      for(auto i = first; i != nil; i = nodes_[i].next) nodes_[i].slot = running;
+      while(heads_[running] != nil) {
+        auto const i = heads_[running];
+        unlink(i);
+        auto callback = std::move(nodes_[i].callback);
+        release(i);
+        callback();
+      }
+    }
+    now_ = std::max(now_, now);
+  }
+
+ private:
+  static constexpr Uint32 nil          = ~Uint32{0};
+  static constexpr Uint32 level0_bits  = 8;
+  static constexpr Uint32 level0_size  = 1u << level0_bits;
+  static constexpr Uint32 level0_mask  = level0_size - 1;
+  static constexpr Uint32 level_bits   = 6;
+  static constexpr Uint32 level_size   = 1u << level_bits;
+  static constexpr Uint32 level_mask   = level_size - 1;
+  static constexpr Uint32 upper_levels = 4;
+  static constexpr Uint32 slot_count   = level0_size + upper_levels * level_size;
+  // holds the timers being fired by ~advance~ so they can still be cancelled
+  static constexpr Uint32 running = slot_count;
+
+  struct Node {
+    tick_type expires = 0;
+    Uint32 prev       = nil;
+    Uint32 next       = nil;
+    Uint32 slot       = nil;
+    Uint32 generation = 0;
+    Callback callback{};
+  };
+
+  static constexpr Uint32 shift(Uint32 const level) noexcept {
+    return level0_bits + level * level_bits;
+  }
+
+  Uint32 slot_for(tick_type const expires) const noexcept {
+    SDLRAII_COLD_IF(expires < next_)
+      return static_cast<Uint32>(next_ & level0_mask);
+    auto delta = expires - next_;
+    if(delta < level0_size) return static_cast<Uint32>(expires & level0_mask);
+    for(Uint32 level = 0; level < upper_levels; ++level) {
+      auto const last = level + 1 == upper_levels;
+      if(last && delta >= (tick_type{1} << shift(level + 1)))
+        delta = (tick_type{1} << shift(level + 1)) - 1;
+      if(last || delta < (tick_type{1} << shift(level + 1))) {
+        auto const at = last ? next_ + delta : expires;
+        return level0_size + level * level_size
+             + static_cast<Uint32>((at >> shift(level)) & level_mask);
+      }
+    }
+    return nil; // unreachable
+  }
+
+  void link(Uint32 const i) noexcept {
+    auto& node = nodes_[i];
+    auto const slot = slot_for(node.expires);
+    node.slot       = slot;
+    node.prev       = nil;
+    node.next       = heads_[slot];
+    if(node.next != nil) nodes_[node.next].prev = i;
+    heads_[slot] = i;
+    if(slot < level0_size) occupied_[slot / 64] |= Uint64{1} << (slot % 64);
+  }
+
+  void unlink(Uint32 const i) noexcept {
+    auto& node = nodes_[i];
+    if(node.prev != nil)
+      nodes_[node.prev].next = node.next;
+    else
+      heads_[node.slot] = node.next;
+    if(node.next != nil) nodes_[node.next].prev = node.prev;
+    if(node.slot < level0_size && heads_[node.slot] == nil)
+      occupied_[node.slot / 64] &= ~(Uint64{1} << (node.slot % 64));
+    node.slot = nil;
+  }
+
+  void release(Uint32 const i) noexcept {
+    auto& node = nodes_[i];
+    node.callback = Callback{};
+    ++node.generation;
+    node.next = free_;
+    free_     = i;
+    --size_;
+  }
+
+  /** Re-file the current slot of an upper level. Returns that slot's index. */
+  Uint32 cascade(Uint32 const level) noexcept {
+    auto const index =
+        static_cast<Uint32>((next_ >> shift(level)) & level_mask);
+    auto const slot = level0_size + level * level_size + index;
+    auto i          = std::exchange(heads_[slot], nil);
+    while(i != nil) {
+      auto const next = nodes_[i].next;
+      link(i);
+      i = next;
+    }
+    return index;
+  }
+
+  /**
+   * The first occupied one-tick slot at or after ~index~, or ~level0_size~ if
+   * the rest of this turn of the wheel is empty.
+   */
+  Uint32 next_occupied(Uint32 const index) const noexcept {
+    for(auto word = index / 64; word < occupied_.size(); ++word) {
+      auto bits = occupied_[word];
+      if(word == index / 64) bits &= ~Uint64{0} << (index % 64);
+      if(bits != 0) return word * 64 + std::countr_zero(bits);
+    }
+    return level0_size;
+  }
+
+  std::vector<Node> nodes_;
+  std::array<Uint32, slot_count + 1> heads_;
+  std::array<Uint64, level0_size / 64> occupied_{};
+  Uint32 free_      = nil;
+  std::size_t size_ = 0;
+  tick_type now_;
+  // the next tick to run; everything before it has fired
+  tick_type next_;
+};
+
+} // namespace sdl
+#undef SDLRAII_THE_PREFIX
+
+#endif // SDLRAII_TIMER_INCLUDE_GUARD
@@ -48,6 +48,9 @@
     unique_name(sdl::name* ptr = nullptr) noexcept                             \
         : std::unique_ptr<sdl::name, decltype(&destructor)>{ptr,               \
                                                             &destructor} {}    \
+    /* for owners that must be given back some other way, e.g. to a pool */   \
+    unique_name(sdl::name* ptr, decltype(&destructor) deleter) noexcept        \
+        : std::unique_ptr<sdl::name, decltype(&destructor)>{ptr, deleter} {}   \
     unique_name(unique_name&&)      = default;                                 \
     unique_name(unique_name const&) = delete;                                  \
   };
@@ -118,7 +121,7 @@
 
 #define SDLRAII_WRAP_RGB_GETTER_(name, sdl_name)                               \
   template<class T>                                                            \
-  SDLRAII_REQUIRES_CALLABLE(sdl_name, T)                                       \
+  SDLRAII_REQUIRES_CALLABLE(sdl_name, T, Uint8*, Uint8*, Uint8*)               \
   inline MayError<rgb> name(T x) noexcept {                                    \
     Uint8 r, g, b;                                                             \
     SDLRAII_COLD_IF(sdl_name(x, &r, &g, &b) != 0)                              \
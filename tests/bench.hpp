@@ -0,0 +1,73 @@
+// Timing helpers shared by the *_bench programs.
+#ifndef SDLRAII_TESTS_BENCH_INCLUDE_GUARD
+#define SDLRAII_TESTS_BENCH_INCLUDE_GUARD
+
+#include <sdl2raii/sdl.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+
+namespace bench {
+
+/** The fastest of ~runs~ calls of ~fn~, in seconds, after one warm-up. */
+template<class Fn>
+double best_seconds(Fn&& fn, int const runs = 10) {
+  using clock = std::chrono::steady_clock;
+  fn();
+  auto best = std::numeric_limits<double>::infinity();
+  for(int i = 0; i < runs; ++i) {
+    auto const start = clock::now();
+    fn();
+    std::chrono::duration<double> const took = clock::now() - start;
+    best = std::min(best, took.count());
+  }
+  return best;
+}
+
+/** Prints one result line: ~amount~ of ~unit~ done in ~seconds~. */
+inline void report(char const* const what,
+                   double const seconds,
+                   double const amount,
+                   char const* const unit) {
+  std::printf("%-48s %9.3f ms %12.1f %s/s\n",
+              what,
+              seconds * 1e3,
+              amount / seconds,
+              unit);
+}
+
+/** The value of ~made~, or else exit saying ~what~ failed. */
+template<class T>
+T or_exit(sdl::MayError<T> made, char const* const what) {
+  if(!made.ok()) {
+    std::fprintf(stderr, "%s: %s\n", what, made.error().message);
+    std::exit(1);
+  }
+  return std::move(made).get();
+}
+
+/**
+ * A ~w~ by ~h~ ARGB8888 surface and SDL's software renderer drawing into it,
+ * to time the batching APIs against. It queues draw calls, so call
+ * ~SDL_RenderFlush~ inside the timed code.
+ */
+struct Canvas {
+  sdl::UniqueSurface surface;
+  sdl::UniqueRenderer renderer;
+};
+inline Canvas software_canvas(int const w, int const h) {
+  auto surface = or_exit(
+      sdl::CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+  auto renderer = or_exit(sdl::CreateSoftwareRenderer(surface.get()),
+                          "CreateSoftwareRenderer");
+  return {std::move(surface), std::move(renderer)};
+}
+
+} // namespace bench
+
+#endif // SDLRAII_TESTS_BENCH_INCLUDE_GUARD
@@ -0,0 +1,114 @@
+// Checks sdl::BlendBlit against SDL_BlitSurface: every blend mode it handles,
+// with and without color and alpha mods, for each pairing of ARGB8888 and
+// ABGR8888, to within one in every channel.
+#define SDL_MAIN_HANDLED
+#include <sdl2raii/blit.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+constexpr int w = 67, h = 13;
+constexpr int tolerance = 1;
+
+int failures = 0;
+
+sdl::UniqueSurface make(Uint32 const format, std::mt19937& rng) {
+  auto made = sdl::CreateRGBSurfaceWithFormat(0, w, h, 32, format);
+  if(!made.ok()) {
+    std::fprintf(stderr, "CreateRGBSurfaceWithFormat: %s\n",
+                 made.error().message);
+    std::exit(1);
+  }
+  auto surface = std::move(made).get();
+  for(int y = 0; y < h; ++y) {
+    auto* const row = sdl::impl::pixel_row(surface.get(), y);
+    for(int x = 0; x < w; ++x) {
+      row[x] = static_cast<Uint32>(rng());
+      // make sure opaque and clear pixels turn up
+      if(x % 7 == 0) row[x] |= 0xff000000;
+      if(x % 11 == 0) row[x] &= 0x00ffffff;
+    }
+  }
+  return surface;
+}
+
+sdl::UniqueSurface copy(sdl::Surface* const surface) {
+  auto copied = sdl::CreateRGBSurfaceWithFormat(
+      0, w, h, 32, surface->format->format);
+  if(!copied.ok()) std::exit(1);
+  auto out = std::move(copied).get();
+  for(int y = 0; y < h; ++y)
+    std::copy_n(sdl::impl::pixel_row(surface, y), w,
+                sdl::impl::pixel_row(out.get(), y));
+  return out;
+}
+
+int max_difference(sdl::Surface* const a, sdl::Surface* const b) {
+  int worst = 0;
+  for(int y = 0; y < h; ++y)
+    for(int x = 0; x < w; ++x) {
+      auto const p = sdl::impl::pixel_row(a, y)[x];
+      auto const q = sdl::impl::pixel_row(b, y)[x];
+      for(int shift = 0; shift < 32; shift += 8) {
+        auto const c = static_cast<int>(p >> shift & 0xff);
+        auto const d = static_cast<int>(q >> shift & 0xff);
+        worst = std::max(worst, std::abs(c - d));
+      }
+    }
+  return worst;
+}
+
+char const* name(Uint32 const format) {
+  return format == SDL_PIXELFORMAT_ARGB8888 ? "ARGB8888" : "ABGR8888";
+}
+
+void run(Uint32 const src_format,
+         Uint32 const dst_format,
+         SDL_BlendMode const mode,
+         bool const color_mod,
+         bool const alpha_mod) {
+  std::mt19937 rng(static_cast<unsigned>(src_format ^ dst_format ^ mode));
+  auto const src = make(src_format, rng);
+  auto const dst = make(dst_format, rng);
+  SDL_SetSurfaceBlendMode(src.get(), mode);
+  if(color_mod) SDL_SetSurfaceColorMod(src.get(), 200, 77, 131);
+  if(alpha_mod) SDL_SetSurfaceAlphaMod(src.get(), 160);
+
+  auto const expected = copy(dst.get());
+  auto const actual   = copy(dst.get());
+  SDL_BlitSurface(src.get(), nullptr, expected.get(), nullptr);
+  auto const blitted = sdl::BlendBlit(src.get(), nullptr, actual.get());
+  auto const worst   = max_difference(expected.get(), actual.get());
+  auto const failed  = !blitted.ok() || worst > tolerance;
+  std::fprintf(failed ? stderr : stdout,
+               "%s %s -> %s, mode %d, color mod %d, alpha mod %d: "
+               "differs by up to %d\n",
+               failed ? "FAIL" : "ok  ",
+               name(src_format),
+               name(dst_format),
+               static_cast<int>(mode),
+               color_mod,
+               alpha_mod,
+               worst);
+  failures += failed;
+}
+
+} // namespace
+
+int main() {
+  Uint32 const formats[] = {SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888};
+  SDL_BlendMode const modes[] = {SDL_BLENDMODE_NONE,
+                                 SDL_BLENDMODE_BLEND,
+                                 SDL_BLENDMODE_ADD,
+                                 SDL_BLENDMODE_MOD};
+  for(auto const src_format : formats)
+    for(auto const dst_format : formats)
+      for(auto const mode : modes)
+        for(int mods = 0; mods < 4; ++mods)
+          run(src_format, dst_format, mode, mods & 1, mods & 2);
+  return failures != 0;
+}
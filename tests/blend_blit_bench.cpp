@@ -0,0 +1,75 @@
+// Times sdl::BlendBlit against SDL_BlitSurface for a 1080p source onto a
+// 1080p destination, per blend mode, with and without mods, for matching and
+// red/blue-swapped formats.
+#define SDL_MAIN_HANDLED
+#include "bench.hpp"
+
+#include <sdl2raii/blit.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+
+constexpr int w = 1920, h = 1080;
+
+sdl::UniqueSurface make(Uint32 const format, std::mt19937& rng) {
+  auto made = sdl::CreateRGBSurfaceWithFormat(0, w, h, 32, format);
+  if(!made.ok()) {
+    std::fprintf(stderr, "CreateRGBSurfaceWithFormat: %s\n",
+                 made.error().message);
+    std::exit(1);
+  }
+  auto surface = std::move(made).get();
+  for(int y = 0; y < h; ++y) {
+    auto* const row = sdl::impl::pixel_row(surface.get(), y);
+    for(int x = 0; x < w; ++x) row[x] = static_cast<Uint32>(rng());
+  }
+  return surface;
+}
+
+char const* name(SDL_BlendMode const mode) {
+  switch(mode) {
+    case SDL_BLENDMODE_NONE: return "none";
+    case SDL_BLENDMODE_BLEND: return "blend";
+    case SDL_BLENDMODE_ADD: return "add";
+    default: return "mod";
+  }
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  auto const src  = make(SDL_PIXELFORMAT_ARGB8888, rng);
+  auto const same = make(SDL_PIXELFORMAT_ARGB8888, rng);
+  auto const swap = make(SDL_PIXELFORMAT_ABGR8888, rng);
+  auto const megapixels = w * h / 1e6;
+
+  SDL_BlendMode const modes[] = {SDL_BLENDMODE_NONE,
+                                 SDL_BLENDMODE_BLEND,
+                                 SDL_BLENDMODE_ADD,
+                                 SDL_BLENDMODE_MOD};
+  for(auto const mode : modes)
+    for(int mods = 0; mods < 2; ++mods)
+      for(auto* const dst : {same.get(), swap.get()}) {
+        SDL_SetSurfaceBlendMode(src.get(), mode);
+        SDL_SetSurfaceColorMod(src.get(), 255, mods ? 180 : 255, 255);
+        SDL_SetSurfaceAlphaMod(src.get(), mods ? 200 : 255);
+        auto const label = std::string{name(mode)} + (mods ? " +mods" : "")
+                         + (dst == swap.get() ? " ARGB->ABGR" : " ARGB->ARGB");
+
+        auto const theirs = bench::best_seconds(
+            [&] { SDL_BlitSurface(src.get(), nullptr, dst, nullptr); });
+        auto const ours = bench::best_seconds(
+            [&] { (void)sdl::BlendBlit(src.get(), nullptr, dst); });
+        bench::report((label + "  SDL_BlitSurface").c_str(),
+                      theirs,
+                      megapixels,
+                      "Mpix");
+        bench::report(
+            (label + "  BlendBlit").c_str(), ours, megapixels, "Mpix");
+      }
+}
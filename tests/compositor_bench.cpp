@@ -0,0 +1,197 @@
+// Times sdl::Compositor against SDL's software renderer drawing the same
+// 1080p frames: blended sprites, scaled sprites, translucent fills, and
+// particle quads and debug lines through the batching APIs. The compositor
+// runs once on a single thread and once on a JobSystem with every core.
+#define SDL_MAIN_HANDLED
+#include "bench.hpp"
+
+#include <sdl2raii/compositor.hpp>
+#include <sdl2raii/debug_draw.hpp>
+#include <sdl2raii/particles.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int w = 1920, h = 1080;
+
+struct Sprite {
+  sdl::Rect dst;
+  sdl::rgba tint;
+};
+
+sdl::UniqueSurface make_sprite(int const size) {
+  auto sprite = bench::or_exit(
+      sdl::CreateRGBSurfaceWithFormat(
+          0, size, size, 32, SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+  // a soft disc, so most pixels are partly transparent
+  for(int y = 0; y < size; ++y) {
+    auto* const row = sdl::impl::pixel_row(sprite.get(), y);
+    for(int x = 0; x < size; ++x) {
+      auto const dx = x - size / 2, dy = y - size / 2;
+      auto const d  = dx * dx + dy * dy;
+      auto const a  = std::max(0, 255 - d * 255 / (size * size / 4));
+      row[x] = sdl::impl::pack_argb(static_cast<Uint32>(a), 255, 200, 80);
+    }
+  }
+  return sprite;
+}
+
+std::vector<Sprite>
+    scatter(int const count, int const size, std::mt19937& rng) {
+  std::vector<Sprite> sprites;
+  for(int i = 0; i < count; ++i)
+    sprites.push_back(
+        {{static_cast<int>(rng() % (w - size)),
+          static_cast<int>(rng() % (h - size)),
+          size,
+          size},
+         {255, 255, 255, static_cast<Uint8>(128 + rng() % 128)}});
+  return sprites;
+}
+
+// One scene drawn both ways: ~sdl_draw(renderer)~ queues SDL draw calls for
+// ~canvas~, ~ours(compositor)~ records compositor commands.
+template<class Sdl, class Ours>
+void run(char const* const scene,
+         bench::Canvas const& canvas,
+         Sdl&& sdl_draw,
+         Ours&& ours) {
+  auto* const renderer = canvas.renderer.get();
+  auto const theirs    = bench::best_seconds([&] {
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    sdl_draw(renderer);
+    SDL_RenderFlush(renderer);
+  });
+  bench::report((std::string{scene} + "  SDL software renderer").c_str(),
+                theirs,
+                1,
+                "frame");
+
+  auto target = bench::or_exit(
+      sdl::CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+  std::vector<int> workers{0};
+  if(sdl::GetCPUCount() > 1) workers.push_back(sdl::GetCPUCount() - 1);
+  for(auto const n : workers) {
+    sdl::JobSystem jobs{n};
+    sdl::Compositor compositor{jobs};
+    auto const took = bench::best_seconds([&] {
+      compositor.fill({0, 0, w, h}, {0, 0, 0, 255}, sdl::BlendMode::none);
+      ours(compositor);
+      (void)compositor.render(target.get());
+    });
+    auto const label = std::string{scene} + "  Compositor, "
+                     + std::to_string(jobs.worker_count() + 1) + " threads";
+    bench::report(label.c_str(), took, 1, "frame");
+  }
+}
+
+sdl::UniqueTexture upload(bench::Canvas const& canvas,
+                          sdl::Surface* const surface) {
+  auto texture = bench::or_exit(
+      sdl::CreateTextureFromSurface(canvas.renderer.get(), surface),
+      "CreateTextureFromSurface");
+  SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+  return texture;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  auto const canvas = bench::software_canvas(w, h);
+
+  auto const sprite  = make_sprite(64);
+  auto const texture = upload(canvas, sprite.get());
+  auto const copies  = [&](std::vector<Sprite> const& sprites) {
+    return [&](sdl::Renderer* const renderer) {
+      for(auto const& s : sprites) {
+        SDL_SetTextureAlphaMod(texture.get(), s.tint.a);
+        SDL_RenderCopy(renderer, texture.get(), nullptr, &s.dst);
+      }
+    };
+  };
+  auto const our_copies = [&](std::vector<Sprite> const& sprites) {
+    return [&](sdl::Compositor& compositor) {
+      for(auto const& s : sprites)
+        (void)compositor.copy(sprite.get(), std::nullopt, s.dst, s.tint);
+    };
+  };
+
+  auto const sprites = scatter(5000, 64, rng);
+  run("5000 sprites, 64x64",
+      canvas,
+      copies(sprites),
+      our_copies(sprites));
+
+  auto const scaled = scatter(2000, 96, rng);
+  run("2000 sprites, 64x64 scaled to 96x96",
+      canvas,
+      copies(scaled),
+      our_copies(scaled));
+
+  auto const fills = scatter(500, 200, rng);
+  run(
+      "500 translucent fills, 200x200",
+      canvas,
+      [&](sdl::Renderer* const renderer) {
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        for(auto const& f : fills) {
+          SDL_SetRenderDrawColor(renderer, 40, 90, 200, f.tint.a);
+          SDL_RenderFillRect(renderer, &f.dst);
+        }
+      },
+      [&](sdl::Compositor& compositor) {
+        for(auto const& f : fills)
+          compositor.fill(f.dst, {40, 90, 200, f.tint.a});
+      });
+
+  sdl::ParticleSystem particles{100000};
+  for(int i = 0; i < 100000; ++i)
+    particles.emit({{static_cast<float>(rng() % w),
+                     static_cast<float>(rng() % h)},
+                    {0, 0},
+                    10,
+                    {255, 160, 60, 255}});
+  auto const dot         = make_sprite(8);
+  auto const dot_texture = upload(canvas, dot.get());
+  run(
+      "100k particles, 8x8 quads",
+      canvas,
+      [&](sdl::Renderer* const renderer) {
+        (void)particles.draw(renderer, dot_texture.get(), 8);
+      },
+      [&](sdl::Compositor& compositor) {
+        (void)particles.draw(compositor, dot.get(), 8);
+      });
+
+  sdl::DebugDraw debug;
+  auto const lines = [&] {
+    std::mt19937 again(2);
+    for(int i = 0; i < 10000; ++i) {
+      sdl::FPoint const a{static_cast<float>(again() % w),
+                          static_cast<float>(again() % h)};
+      sdl::FPoint const b{a.x + static_cast<float>(again() % 200) - 100,
+                          a.y + static_cast<float>(again() % 200) - 100};
+      debug.line(a, b, {static_cast<Uint8>(again()), 255, 0, 255});
+    }
+  };
+  run(
+      "10000 debug lines in 256 colors",
+      canvas,
+      [&](sdl::Renderer* const renderer) {
+        lines();
+        (void)debug.flush(renderer);
+      },
+      [&](sdl::Compositor& compositor) {
+        lines();
+        (void)debug.flush(compositor);
+      });
+}
@@ -0,0 +1,152 @@
+// Times two heavy 1080p debug overlays in 16 translucent colors, each shape
+// in a random order: 1000 filled and 2000 outlined rectangles with 10000
+// lines and 5000 points, and the lines and points alone. One
+// SetRenderDrawColor and draw call per shape is compared with sdl::DebugDraw's
+// plural calls per color, with DebugDraw drawing into a Compositor, and with
+// DebugDraw disabled.
+#define SDL_MAIN_HANDLED
+#include "bench.hpp"
+
+#include <sdl2raii/compositor.hpp>
+#include <sdl2raii/debug_draw.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int w = 1920, h = 1080;
+
+struct Shape {
+  enum kind { fill, rect, line, point } type;
+  sdl::FRect r; // a line runs from ~x, y~ to ~w, h~
+  sdl::rgba color;
+};
+
+struct Counts {
+  int fills, rects, lines, points;
+};
+
+std::vector<Shape> make_overlay(Counts const counts, std::mt19937& rng) {
+  std::vector<Shape> shapes;
+  auto const at = [&](int const range) {
+    return static_cast<float>(rng() % static_cast<unsigned>(range));
+  };
+  auto const add = [&](Shape::kind const type, int const count) {
+    for(int i = 0; i < count; ++i) {
+      auto const x = at(w), y = at(h);
+      auto const a = at(120), b = at(120);
+      sdl::FRect r{x, y, a, b};
+      if(type == Shape::line) r = {x, y, x + a - 60, y + b - 60};
+      auto const c = static_cast<Uint8>(rng() % 16 * 16);
+      shapes.push_back({type, r, {c, static_cast<Uint8>(255 - c), 90, 192}});
+    }
+  };
+  add(Shape::fill, counts.fills);
+  add(Shape::rect, counts.rects);
+  add(Shape::line, counts.lines);
+  add(Shape::point, counts.points);
+  std::shuffle(shapes.begin(), shapes.end(), rng);
+  return shapes;
+}
+
+void run(char const* const scene,
+         std::vector<Shape> const& shapes,
+         bench::Canvas const& canvas) {
+  auto* const renderer = canvas.renderer.get();
+  auto const count     = static_cast<double>(shapes.size()) / 1e3;
+  auto const label     = [&](char const* const how) {
+    return std::string{scene} + "  " + how;
+  };
+  auto const frame = [&](auto&& draw) {
+    return bench::best_seconds([&] {
+      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+      SDL_RenderClear(renderer);
+      draw();
+      SDL_RenderFlush(renderer);
+    });
+  };
+
+  bench::report(label("a draw call per shape").c_str(),
+                frame([&] {
+                  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+                  for(auto const& s : shapes) {
+                    SDL_SetRenderDrawColor(
+                        renderer, s.color.r, s.color.g, s.color.b, s.color.a);
+                    switch(s.type) {
+                      case Shape::fill:
+                        SDL_RenderFillRectF(renderer, &s.r);
+                        break;
+                      case Shape::rect:
+                        SDL_RenderDrawRectF(renderer, &s.r);
+                        break;
+                      case Shape::line:
+                        SDL_RenderDrawLineF(
+                            renderer, s.r.x, s.r.y, s.r.w, s.r.h);
+                        break;
+                      case Shape::point:
+                        SDL_RenderDrawPointF(renderer, s.r.x, s.r.y);
+                        break;
+                    }
+                  }
+                  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+                }),
+                count,
+                "kshape");
+
+  sdl::DebugDraw debug;
+  auto const record = [&] {
+    for(auto const& s : shapes)
+      switch(s.type) {
+        case Shape::fill: debug.fill_rect(s.r, s.color); break;
+        case Shape::rect: debug.rect(s.r, s.color); break;
+        case Shape::line:
+          debug.line({s.r.x, s.r.y}, {s.r.w, s.r.h}, s.color);
+          break;
+        case Shape::point: debug.point({s.r.x, s.r.y}, s.color); break;
+      }
+  };
+  bench::report(label("DebugDraw").c_str(),
+                frame([&] {
+                  record();
+                  (void)debug.flush(renderer);
+                }),
+                count,
+                "kshape");
+
+  auto target = bench::or_exit(
+      sdl::CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+  sdl::JobSystem jobs{0};
+  sdl::Compositor compositor{jobs};
+  bench::report(label("DebugDraw into a Compositor, 1 thread").c_str(),
+                bench::best_seconds([&] {
+                  compositor.fill(
+                      {0, 0, w, h}, {0, 0, 0, 255}, sdl::BlendMode::none);
+                  record();
+                  (void)debug.flush(compositor);
+                  (void)compositor.render(target.get());
+                }),
+                count,
+                "kshape");
+
+  debug.set_enabled(false);
+  bench::report(label("DebugDraw disabled").c_str(),
+                frame([&] {
+                  record();
+                  (void)debug.flush(renderer);
+                }),
+                count,
+                "kshape");
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  auto const canvas = bench::software_canvas(w, h);
+  run("full overlay", make_overlay({1000, 2000, 10000, 5000}, rng), canvas);
+  run("lines and points", make_overlay({0, 0, 10000, 5000}, rng), canvas);
+}
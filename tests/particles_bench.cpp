@@ -0,0 +1,166 @@
+// Times 100k particles on a 1080p canvas. The update is sdl::ParticleSystem
+// against the same step and removal of the dead over an array of structs.
+// Drawing is its single RenderDrawPointsF and RenderGeometry calls against a
+// call per particle, and the same batches drawn into a Compositor.
+#define SDL_MAIN_HANDLED
+#include "bench.hpp"
+
+#include <sdl2raii/compositor.hpp>
+#include <sdl2raii/particles.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int w = 1920, h = 1080;
+constexpr int count = 100000;
+constexpr int size  = 8;
+constexpr float dt  = 1.0f / 60;
+
+sdl::UniqueSurface make_dot() {
+  auto dot = bench::or_exit(
+      sdl::CreateRGBSurfaceWithFormat(
+          0, size, size, 32, SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+  // a soft dot, so most pixels are partly transparent
+  for(int y = 0; y < size; ++y) {
+    auto* const row = reinterpret_cast<Uint32*>(
+        static_cast<Uint8*>(dot->pixels) + y * dot->pitch);
+    for(int x = 0; x < size; ++x) {
+      auto const dx = 2 * x + 1 - size, dy = 2 * y + 1 - size;
+      auto const a  = std::max(0, 255 - (dx * dx + dy * dy) * 4);
+      row[x]        = static_cast<Uint32>(a) << 24 | 0xffffff;
+    }
+  }
+  return dot;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  auto const canvas    = bench::software_canvas(w, h);
+  auto* const renderer = canvas.renderer.get();
+
+  // nothing dies during the run, so every step moves all of them
+  std::vector<sdl::Particle> structs;
+  sdl::ParticleSystem particles{count};
+  particles.set_gravity({0, 98});
+  for(int i = 0; i < count; ++i) {
+    sdl::Particle const p{
+        {static_cast<float>(rng() % w), static_cast<float>(rng() % h)},
+        {static_cast<float>(rng() % 200) - 100,
+         static_cast<float>(rng() % 200) - 100},
+        1e6f,
+        {255, static_cast<Uint8>(rng()), 60, 255}};
+    structs.push_back(p);
+    particles.emit(p);
+  }
+  auto const kparticles = count / 1e3;
+
+  bench::report("update, array of structs",
+                bench::best_seconds([&] {
+                  for(auto& p : structs) {
+                    p.velocity.y += 98 * dt;
+                    p.position.x += p.velocity.x * dt;
+                    p.position.y += p.velocity.y * dt;
+                    p.life -= dt;
+                  }
+                  std::erase_if(structs, [](sdl::Particle const& p) {
+                    return p.life <= 0;
+                  });
+                }),
+                kparticles,
+                "kparticle");
+  std::vector<int> workers{0};
+  if(sdl::GetCPUCount() > 1) workers.push_back(sdl::GetCPUCount() - 1);
+  for(auto const n : workers) {
+    sdl::JobSystem jobs{n};
+    auto const label = "update, ParticleSystem, " + std::to_string(n + 1)
+                     + " threads";
+    bench::report(label.c_str(),
+                  bench::best_seconds([&] {
+                    particles.update(dt, n > 0 ? &jobs : nullptr);
+                  }),
+                  kparticles,
+                  "kparticle");
+  }
+
+  auto const frame = [&](auto&& draw) {
+    return bench::best_seconds([&] {
+      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+      SDL_RenderClear(renderer);
+      draw();
+      SDL_RenderFlush(renderer);
+    });
+  };
+  auto const dot     = make_dot();
+  auto const texture = bench::or_exit(
+      sdl::CreateTextureFromSurface(renderer, dot.get()),
+      "CreateTextureFromSurface");
+  SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+
+  bench::report("points, SDL_RenderDrawPointF each",
+                frame([&] {
+                  SDL_SetRenderDrawColor(renderer, 255, 160, 60, 255);
+                  for(auto const& p : structs)
+                    SDL_RenderDrawPointF(renderer, p.position.x, p.position.y);
+                }),
+                kparticles,
+                "kparticle");
+  bench::report("points, ParticleSystem::draw_points",
+                frame([&] {
+                  SDL_SetRenderDrawColor(renderer, 255, 160, 60, 255);
+                  (void)particles.draw_points(renderer);
+                }),
+                kparticles,
+                "kparticle");
+
+  bench::report("quads, SDL_RenderCopyF each",
+                frame([&] {
+                  for(auto const& p : structs) {
+                    SDL_SetTextureColorMod(
+                        texture.get(), p.color.r, p.color.g, p.color.b);
+                    SDL_FRect const dst{p.position.x - size / 2.0f,
+                                        p.position.y - size / 2.0f,
+                                        size,
+                                        size};
+                    SDL_RenderCopyF(renderer, texture.get(), nullptr, &dst);
+                  }
+                }),
+                kparticles,
+                "kparticle");
+  bench::report("quads, ParticleSystem::draw",
+                frame([&] {
+                  (void)particles.draw(renderer, texture.get(), size);
+                }),
+                kparticles,
+                "kparticle");
+
+  auto target = bench::or_exit(
+      sdl::CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+  sdl::JobSystem jobs{0};
+  sdl::Compositor compositor{jobs};
+  auto const composite = [&](auto&& draw) {
+    return bench::best_seconds([&] {
+      compositor.fill({0, 0, w, h}, {0, 0, 0, 255}, sdl::BlendMode::none);
+      draw();
+      (void)compositor.render(target.get());
+    });
+  };
+  bench::report("points into a Compositor, 1 thread",
+                composite([&] {
+                  (void)particles.draw_points(compositor, {255, 160, 60, 255});
+                }),
+                kparticles,
+                "kparticle");
+  bench::report("quads into a Compositor, 1 thread",
+                composite([&] {
+                  (void)particles.draw(compositor, dot.get(), size);
+                }),
+                kparticles,
+                "kparticle");
+}
@@ -0,0 +1,149 @@
+// Checks properties of sdl::ScaleSurface that hold exactly: every filter
+// keeps a constant image constant at any size, every filter is the identity
+// at 1:1, and splitting rows across a JobSystem changes nothing.
+#define SDL_MAIN_HANDLED
+#include <sdl2raii/scale.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+
+namespace {
+
+int failures = 0;
+
+char const* name(sdl::scale_filter const filter) {
+  switch(filter) {
+    case sdl::scale_filter::nearest: return "nearest";
+    case sdl::scale_filter::bilinear: return "bilinear";
+    default: return "area";
+  }
+}
+
+void check(bool const ok,
+           sdl::scale_filter const filter,
+           char const* const what,
+           int const w,
+           int const h) {
+  if(ok) return;
+  std::fprintf(stderr, "FAIL %s: %s, to %dx%d\n", name(filter), what, w, h);
+  ++failures;
+}
+
+sdl::UniqueSurface make(int const w, int const h) {
+  auto made =
+      sdl::CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+  if(!made.ok()) {
+    std::fprintf(stderr, "CreateRGBSurfaceWithFormat: %s\n",
+                 made.error().message);
+    std::exit(1);
+  }
+  return std::move(made).get();
+}
+
+Uint32& pixel(sdl::Surface* const surface, int const x, int const y) {
+  return reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels)
+                                   + y * surface->pitch)[x];
+}
+
+sdl::UniqueSurface noise(int const w, int const h, std::mt19937& rng) {
+  auto surface = make(w, h);
+  for(int y = 0; y < h; ++y)
+    for(int x = 0; x < w; ++x)
+      pixel(surface.get(), x, y) = static_cast<Uint32>(rng());
+  return surface;
+}
+
+bool same(sdl::Surface* const a, sdl::Surface* const b) {
+  if(a->w != b->w || a->h != b->h) return false;
+  for(int y = 0; y < a->h; ++y)
+    for(int x = 0; x < a->w; ++x)
+      if(pixel(a, x, y) != pixel(b, x, y)) return false;
+  return true;
+}
+
+bool all(sdl::Surface* const surface, Uint32 const value) {
+  for(int y = 0; y < surface->h; ++y)
+    for(int x = 0; x < surface->w; ++x)
+      if(pixel(surface, x, y) != value) return false;
+  return true;
+}
+
+sdl::UniqueSurface scale(sdl::SurfacePool& pool,
+                         sdl::Surface* const src,
+                         int const w,
+                         int const h,
+                         sdl::scale_filter const filter,
+                         sdl::JobSystem* const jobs = nullptr) {
+  auto scaled = sdl::ScaleSurface(pool, src, w, h, filter, jobs);
+  if(!scaled.ok()) {
+    std::fprintf(stderr, "ScaleSurface: %s\n", scaled.error().message);
+    std::exit(1);
+  }
+  return std::move(scaled).get();
+}
+
+constexpr sdl::scale_filter filters[] = {sdl::scale_filter::nearest,
+                                         sdl::scale_filter::bilinear,
+                                         sdl::scale_filter::area};
+
+void constant_stays_constant(sdl::SurfacePool& pool) {
+  struct Case {
+    int sw, sh, dw, dh;
+  };
+  Case const cases[] = {{100, 80, 37, 13},
+                        {64, 64, 7, 3},
+                        {1000, 1, 1, 1},
+                        {33, 17, 33, 17},
+                        {3, 5, 121, 77},
+                        {97, 61, 96, 60}};
+  for(auto const value : {0x00000000u, 0xffffffffu, 0x80c0ff01u, 0x7f3a15e9u})
+    for(auto const& c : cases) {
+      auto const src = make(c.sw, c.sh);
+      SDL_FillRect(src.get(), nullptr, value);
+      for(auto const filter : filters) {
+        auto const out = scale(pool, src.get(), c.dw, c.dh, filter);
+        check(all(out.get(), value), filter, "constant changed", c.dw, c.dh);
+      }
+    }
+}
+
+void identity_at_one_to_one(sdl::SurfacePool& pool, std::mt19937& rng) {
+  for(auto const [w, h] : {std::pair{1, 1}, {67, 13}, {256, 3}, {5, 300}}) {
+    auto const src = noise(w, h, rng);
+    for(auto const filter : filters)
+      check(same(scale(pool, src.get(), w, h, filter).get(), src.get()),
+            filter,
+            "1:1 is not the identity",
+            w,
+            h);
+  }
+}
+
+void rows_split_across_jobs(sdl::SurfacePool& pool, std::mt19937& rng) {
+  sdl::JobSystem jobs{3};
+  auto const src = noise(301, 207, rng);
+  for(auto const filter : filters)
+    for(auto const [w, h] : {std::pair{97, 43}, {640, 480}}) {
+      auto const serial   = scale(pool, src.get(), w, h, filter);
+      auto const parallel = scale(pool, src.get(), w, h, filter, &jobs);
+      check(same(serial.get(), parallel.get()),
+            filter,
+            "a JobSystem changed the result",
+            w,
+            h);
+    }
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(7);
+  sdl::SurfacePool pool;
+  constant_stays_constant(pool);
+  identity_at_one_to_one(pool, rng);
+  rows_split_across_jobs(pool, rng);
+  if(failures != 0) std::fprintf(stderr, "%d failures\n", failures);
+  return failures != 0;
+}
@@ -0,0 +1,97 @@
+// Times sdl::ScaleSurface against SDL's own scalers on a 3840x2160 source:
+// nearest against SDL_BlitScaled, and bilinear and area against
+// SDL_SoftStretchLinear, for a half-size copy, a thumbnail and an upscale of
+// a 1280x720 crop. Throughput counts output pixels.
+#define SDL_MAIN_HANDLED
+#include "bench.hpp"
+
+#include <sdl2raii/scale.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+sdl::UniqueSurface make(int const w, int const h) {
+  return bench::or_exit(
+      sdl::CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+}
+
+sdl::UniqueSurface noise(int const w, int const h, std::mt19937& rng) {
+  auto surface = make(w, h);
+  for(int y = 0; y < h; ++y) {
+    auto* const row = reinterpret_cast<Uint32*>(
+        static_cast<Uint8*>(surface->pixels) + y * surface->pitch);
+    for(int x = 0; x < w; ++x) row[x] = static_cast<Uint32>(rng());
+  }
+  return surface;
+}
+
+char const* name(sdl::scale_filter const filter) {
+  switch(filter) {
+    case sdl::scale_filter::nearest: return "nearest";
+    case sdl::scale_filter::bilinear: return "bilinear";
+    default: return "area";
+  }
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  auto const big   = noise(3840, 2160, rng);
+  auto const small = noise(1280, 720, rng);
+  SDL_SetSurfaceBlendMode(big.get(), SDL_BLENDMODE_NONE);
+  SDL_SetSurfaceBlendMode(small.get(), SDL_BLENDMODE_NONE);
+
+  struct Case {
+    char const* what;
+    sdl::Surface* src;
+    int w, h;
+  };
+  Case const cases[] = {{"3840x2160 -> 1920x1080", big.get(), 1920, 1080},
+                        {"3840x2160 -> 480x270", big.get(), 480, 270},
+                        {"1280x720 -> 1920x1080", small.get(), 1920, 1080}};
+
+  sdl::SurfacePool pool;
+  std::vector<int> workers{0};
+  if(sdl::GetCPUCount() > 1) workers.push_back(sdl::GetCPUCount() - 1);
+
+  for(auto const& c : cases) {
+    auto const dst        = make(c.w, c.h);
+    auto const megapixels = c.w * c.h / 1e6;
+    auto const label      = [&](char const* const how) {
+      return std::string{c.what} + "  " + how;
+    };
+
+    bench::report(label("SDL_BlitScaled").c_str(),
+                  bench::best_seconds([&] {
+                    SDL_BlitScaled(c.src, nullptr, dst.get(), nullptr);
+                  }),
+                  megapixels,
+                  "Mpix");
+    bench::report(label("SDL_SoftStretchLinear").c_str(),
+                  bench::best_seconds([&] {
+                    SDL_SoftStretchLinear(c.src, nullptr, dst.get(), nullptr);
+                  }),
+                  megapixels,
+                  "Mpix");
+
+    for(auto const filter : {sdl::scale_filter::nearest,
+                             sdl::scale_filter::bilinear,
+                             sdl::scale_filter::area})
+      for(auto const n : workers) {
+        sdl::JobSystem jobs{n};
+        auto const took = bench::best_seconds([&] {
+          // the result goes straight back to the pool for the next run
+          (void)sdl::ScaleSurface(
+              pool, c.src, c.w, c.h, filter, n > 0 ? &jobs : nullptr);
+        });
+        auto const how = std::string{"ScaleSurface "} + name(filter) + ", "
+                       + std::to_string(n + 1) + " threads";
+        bench::report(label(how.c_str()).c_str(), took, megapixels, "Mpix");
+      }
+  }
+}
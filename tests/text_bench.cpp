@@ -0,0 +1,126 @@
+// Times a 1080p HUD of 200 lines of 60 characters in an 8x12 bitmap font:
+// one SDL_RenderCopy per glyph, sdl::TextRenderer with warm and with cold
+// layout caches, and TextRenderer flushed into a Compositor. SDL's software
+// renderer draws each quad of a RenderGeometry batch as a copy, so against it
+// the batch saves calls more than pixel work.
+#define SDL_MAIN_HANDLED
+#include "bench.hpp"
+
+#include <sdl2raii/compositor.hpp>
+#include <sdl2raii/text.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int w = 1920, h = 1080;
+constexpr int cell_w = 8, cell_h = 12;
+
+// Printable ASCII on a 16-column grid, each glyph a white block with some
+// transparent pixels, so blending does real work.
+sdl::UniqueSurface make_sheet() {
+  auto sheet = bench::or_exit(
+      sdl::CreateRGBSurfaceWithFormat(
+          0, 16 * cell_w, 6 * cell_h, 32, SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+  for(int y = 0; y < sheet->h; ++y) {
+    auto* const row = sdl::impl::pixel_row(sheet.get(), y);
+    for(int x = 0; x < sheet->w; ++x)
+      row[x] = (x * 7 + y * 3) % 5 < 2 ? 0xffffffffu : 0u;
+  }
+  return sheet;
+}
+
+std::vector<std::string> make_lines(std::mt19937& rng) {
+  std::vector<std::string> lines(200);
+  for(auto& line : lines)
+    for(int i = 0; i < 60; ++i)
+      line += static_cast<char>('!' + rng() % 94);
+  return lines;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  auto const canvas = bench::software_canvas(w, h);
+  auto* const renderer = canvas.renderer.get();
+  auto const sheet = make_sheet();
+  auto const font  = bench::or_exit(
+      sdl::BitmapFont::FromGrid(renderer, sheet.get(), cell_w, cell_h),
+      "BitmapFont::FromGrid");
+  auto const lines = make_lines(rng);
+  auto const kglyphs =
+      static_cast<double>(lines.size() * lines.front().size()) / 1e3;
+  sdl::rgba const tint{120, 255, 160, 255};
+
+  auto const frame = [&](auto&& draw) {
+    return bench::best_seconds([&] {
+      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+      SDL_RenderClear(renderer);
+      draw();
+      SDL_RenderFlush(renderer);
+    });
+  };
+
+  bench::report("SDL_RenderCopy per glyph",
+                frame([&] {
+                  SDL_SetTextureColorMod(
+                      font.texture(), tint.r, tint.g, tint.b);
+                  for(std::size_t i = 0; i < lines.size(); ++i) {
+                    auto x = 0;
+                    for(auto const c : lines[i]) {
+                      auto const* const g = font.glyph(
+                          static_cast<Uint8>(c));
+                      sdl::Rect const dst{
+                          x, static_cast<int>(i) * cell_h, cell_w, cell_h};
+                      SDL_RenderCopy(renderer, font.texture(), &g->src, &dst);
+                      x += g->xadvance;
+                    }
+                  }
+                  SDL_SetTextureColorMod(font.texture(), 255, 255, 255);
+                }),
+                kglyphs,
+                "kglyph");
+
+  sdl::TextRenderer text{font};
+  auto const queue = [&] {
+    for(std::size_t i = 0; i < lines.size(); ++i)
+      text.queue(lines[i],
+                 {0, static_cast<float>(i) * static_cast<float>(cell_h)},
+                 tint);
+  };
+  bench::report("TextRenderer, layouts cached",
+                frame([&] {
+                  queue();
+                  (void)text.flush(renderer);
+                }),
+                kglyphs,
+                "kglyph");
+  bench::report("TextRenderer, layouts uncached",
+                frame([&] {
+                  text.clear();
+                  queue();
+                  (void)text.flush(renderer);
+                }),
+                kglyphs,
+                "kglyph");
+
+  auto target = bench::or_exit(
+      sdl::CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+  sdl::JobSystem jobs{0};
+  sdl::Compositor compositor{jobs};
+  bench::report("TextRenderer into a Compositor, 1 thread",
+                bench::best_seconds([&] {
+                  compositor.fill(
+                      {0, 0, w, h}, {0, 0, 0, 255}, sdl::BlendMode::none);
+                  queue();
+                  (void)text.flush(compositor, sheet.get());
+                  (void)compositor.render(target.get());
+                }),
+                kglyphs,
+                "kglyph");
+}
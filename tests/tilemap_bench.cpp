@@ -0,0 +1,93 @@
+// Times scrolling a 1080p view diagonally across a 4096x4096 map of 16x16
+// tiles: one SDL_RenderCopy per visible tile, against sdl::TileLayer drawing
+// cached chunks and rebuilding those that scroll into view. Each sample is
+// 240 frames further along the map than the last.
+#define SDL_MAIN_HANDLED
+#include "bench.hpp"
+
+#include <sdl2raii/render_target.hpp>
+#include <sdl2raii/tilemap.hpp>
+
+#include <random>
+
+namespace {
+
+constexpr int w = 1920, h = 1080;
+constexpr int tiles = 4096, tile = 16, columns = 16;
+constexpr int frames = 240;
+constexpr sdl::Point step{7, 3};
+
+sdl::UniqueSurface make_tileset(std::mt19937& rng) {
+  auto sheet = bench::or_exit(
+      sdl::CreateRGBSurfaceWithFormat(0,
+                                      columns * tile,
+                                      columns * tile,
+                                      32,
+                                      SDL_PIXELFORMAT_ARGB8888),
+      "CreateRGBSurfaceWithFormat");
+  for(int y = 0; y < sheet->h; ++y) {
+    auto* const row = reinterpret_cast<Uint32*>(
+        static_cast<Uint8*>(sheet->pixels) + y * sheet->pitch);
+    for(int x = 0; x < sheet->w; ++x)
+      row[x] = static_cast<Uint32>(rng()) | 0xff000000u;
+  }
+  return sheet;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(1);
+  auto const canvas    = bench::software_canvas(w, h);
+  auto* const renderer = canvas.renderer.get();
+  auto const sheet     = make_tileset(rng);
+  auto const texture   = bench::or_exit(
+      sdl::CreateTextureFromSurface(renderer, sheet.get()),
+      "CreateTextureFromSurface");
+  SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+  sdl::Tileset const tileset{texture.get(), tile, tile, columns};
+
+  sdl::RenderTargetPool pool{renderer};
+  sdl::TileLayer layer{renderer, pool, tileset, tiles, tiles};
+  for(int y = 0; y < tiles; ++y)
+    for(int x = 0; x < tiles; ++x)
+      layer.set(x, y, static_cast<sdl::tile_id>(1 + rng() % 256));
+
+  auto const scroll = [&](auto&& draw) {
+    sdl::Point at{0, 0};
+    return bench::best_seconds([&] {
+      for(int f = 0; f < frames; ++f) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        draw(sdl::Rect{at.x, at.y, w, h});
+        SDL_RenderFlush(renderer);
+        at = {at.x + step.x, at.y + step.y};
+      }
+    });
+  };
+
+  bench::report("SDL_RenderCopy per tile",
+                scroll([&](sdl::Rect const view) {
+                  auto const x0 = view.x / tile, y0 = view.y / tile;
+                  auto const x1 = (view.x + view.w + tile - 1) / tile;
+                  auto const y1 = (view.y + view.h + tile - 1) / tile;
+                  for(int y = y0; y < y1; ++y)
+                    for(int x = x0; x < x1; ++x) {
+                      auto const src = tileset.src(layer.get(x, y));
+                      sdl::Rect const dst{
+                          x * tile - view.x, y * tile - view.y, tile, tile};
+                      SDL_RenderCopy(renderer, texture.get(), &src, &dst);
+                    }
+                }),
+                frames,
+                "frame");
+
+  bench::report("TileLayer, 32x32-tile chunks",
+                scroll([&](sdl::Rect const view) {
+                  (void)layer.draw(view);
+                  layer.end_frame();
+                  pool.end_frame();
+                }),
+                frames,
+                "frame");
+}
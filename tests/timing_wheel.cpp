@@ -0,0 +1,188 @@
+// Checks sdl::TimingWheel against a brute-force model: a multimap from the
+// tick a timer fires on to its id, driven by the same random schedule,
+// cancel, and advance calls. Callbacks re-arm themselves a few times so the
+// "scheduled while firing" path is covered too.
+#define SDL_MAIN_HANDLED
+#include <sdl2raii/timer.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using tick_type = sdl::TimingWheel<>::tick_type;
+using Log       = std::vector<std::pair<tick_type, int>>;
+
+constexpr int max_rearms = 5;
+
+tick_type rearm_delay(int const id, int const count) {
+  auto h = static_cast<std::uint32_t>(id) * 2654435761u + count * 40503u;
+  return (h >> 7) % 40;
+}
+
+int failures = 0;
+
+void check(bool const ok, char const* const what, int const seed) {
+  if(ok) return;
+  std::fprintf(stderr, "seed %d: %s\n", seed, what);
+  ++failures;
+}
+
+struct Model {
+  std::multimap<tick_type, int> due;
+  // the last tick fired (or advanced past); new timers never fire on it
+  tick_type done;
+  tick_type now;
+  std::vector<int> rearms;
+  Log log;
+
+  explicit Model(tick_type const start) : done{start - 1}, now{start} {}
+
+  void schedule_at(tick_type const when, int const id) {
+    due.emplace(std::max(when, done + 1), id);
+  }
+
+  bool cancel(int const id) {
+    for(auto i = due.begin(); i != due.end(); ++i)
+      if(i->second == id) {
+        due.erase(i);
+        return true;
+      }
+    return false;
+  }
+
+  void advance(tick_type const to) {
+    while(!due.empty() && due.begin()->first <= to) {
+      auto const t = due.begin()->first;
+      std::vector<int> firing;
+      while(!due.empty() && due.begin()->first == t) {
+        firing.push_back(due.begin()->second);
+        due.erase(due.begin());
+      }
+      done = now = t;
+      for(auto const id : firing) {
+        log.emplace_back(t, id);
+        if(rearms[id] < max_rearms)
+          schedule_at(t + rearm_delay(id, rearms[id]++), id);
+      }
+    }
+    done = std::max(done, to);
+    now  = std::max(now, to);
+  }
+};
+
+struct Wheel {
+  sdl::TimingWheel<> wheel;
+  std::vector<sdl::TimingWheel<>::Handle> handles;
+  std::vector<int> rearms;
+  Log log;
+
+  explicit Wheel(tick_type const start) : wheel{start} {}
+
+  std::function<void()> fire(int const id) {
+    return [this, id] {
+      log.emplace_back(wheel.now(), id);
+      if(rearms[id] < max_rearms)
+        handles[id] =
+            wheel.schedule(rearm_delay(id, rearms[id]++), fire(id));
+    };
+  }
+};
+
+tick_type random_delay(std::mt19937_64& rng) {
+  switch(rng() % 8) {
+    case 0: return 0;
+    case 1: return rng() % (tick_type{1} << 20);
+    // far enough out to land in the top level
+    case 2: return rng() % (tick_type{1} << 28);
+    default: return rng() % 300;
+  }
+}
+
+void run(int const seed) {
+  std::mt19937_64 rng(seed);
+  tick_type const start = 1000 + rng() % 100000;
+  Model model{start};
+  Wheel wheel{start};
+
+  for(int step = 0; step < 1000; ++step) {
+    switch(rng() % 10) {
+      case 0:
+      case 1:
+      case 2:
+      case 3: {
+        auto const id = static_cast<int>(wheel.handles.size());
+        model.rearms.push_back(0);
+        wheel.rearms.push_back(0);
+        auto const delay = random_delay(rng);
+        if(rng() % 2) {
+          model.schedule_at(model.now + delay, id);
+          wheel.handles.push_back(wheel.wheel.schedule(delay, wheel.fire(id)));
+        } else {
+          // also covers expiries already in the past
+          auto const when = model.now + delay - std::min(delay, model.now) / 2;
+          model.schedule_at(when, id);
+          wheel.handles.push_back(
+              wheel.wheel.schedule_at(when, wheel.fire(id)));
+        }
+        break;
+      }
+      case 4: {
+        if(wheel.handles.empty()) break;
+        auto const id = static_cast<int>(rng() % wheel.handles.size());
+        check(model.cancel(id) == wheel.wheel.cancel(wheel.handles[id]),
+              "cancel disagrees with the model", seed);
+        break;
+      }
+      default: {
+        auto const to = model.now + (rng() % 16 ? rng() % 200
+                                                : random_delay(rng) * 2);
+        model.advance(to);
+        wheel.wheel.advance(to);
+        check(wheel.wheel.now() == model.now, "now() after advance", seed);
+        check(wheel.wheel.size() == model.due.size(), "size()", seed);
+        break;
+      }
+    }
+  }
+  // re-arming callbacks keep adding timers while this drains
+  while(!model.due.empty()) {
+    auto const end = model.due.rbegin()->first;
+    model.advance(end);
+    wheel.wheel.advance(end);
+  }
+  check(wheel.wheel.empty() && model.due.empty(), "timers left over", seed);
+
+  // timers due on the same tick may run in any order
+  std::sort(model.log.begin(), model.log.end());
+  std::sort(wheel.log.begin(), wheel.log.end());
+  check(model.log == wheel.log, "fired timers differ from the model", seed);
+}
+
+// A timer re-arming itself every 10 ticks fires once per 10 ticks, however
+// far a single ~advance~ goes.
+void rearm_during_advance() {
+  sdl::TimingWheel<> wheel;
+  int fired = 0;
+  std::function<void()> tick = [&] {
+    ++fired;
+    wheel.schedule(10, tick);
+  };
+  wheel.schedule(10, tick);
+  wheel.advance(100);
+  check(fired == 10, "schedule(10) during advance(100)", -1);
+}
+
+} // namespace
+
+int main() {
+  rearm_during_advance();
+  for(int seed = 0; seed < 50; ++seed) run(seed);
+  if(failures != 0) std::fprintf(stderr, "%d failures\n", failures);
+  return failures != 0;
+}
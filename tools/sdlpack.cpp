@@ -0,0 +1,54 @@
+// sdlpack: build a pack archive for sdl2raii/pack.hpp
+//
+//   sdlpack [--no-checksums] [-C dir] out.pak file...
+//
+// Each file is stored under its path as given, relative to ~dir~ if -C is
+// used, with forward slashes.
+#define SDL_MAIN_HANDLED
+#include <sdl2raii/pack.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+int main(int argc, char** argv) {
+  bool checksums = true;
+  std::filesystem::path base;
+  int i = 1;
+  for(; i < argc && argv[i][0] == '-'; ++i) {
+    if(std::strcmp(argv[i], "--no-checksums") == 0)
+      checksums = false;
+    else if(std::strcmp(argv[i], "-C") == 0 && i + 1 < argc)
+      base = argv[++i];
+    else
+      break;
+  }
+  if(argc - i < 2) {
+    std::fprintf(stderr,
+                 "usage: %s [--no-checksums] [-C dir] out.pak file...\n",
+                 argv[0]);
+    return 2;
+  }
+  char const* const out = argv[i++];
+
+  sdl::PackWriter pack;
+  for(; i < argc; ++i) {
+    std::string name = argv[i];
+    std::replace(name.begin(), name.end(), '\\', '/');
+    auto const file = (base / argv[i]).string();
+    auto const added = pack.add_file(std::move(name), file.c_str());
+    if(!added.ok()) {
+      std::fprintf(stderr, "%s: %s\n", file.c_str(), added.error().message);
+      return 1;
+    }
+  }
+  auto const written = pack.write(out, checksums);
+  if(!written.ok()) {
+    std::fprintf(stderr, "%s: %s\n", out, written.error().message);
+    return 1;
+  }
+  std::printf("%s: %zu entries\n", out, pack.size());
+  return 0;
+}